@@ -0,0 +1,280 @@
+//*******************************************************************************
+// altcal.c
+//
+// Multi-point altitude calibration. The ADC drop below refAltADC is turned
+// into altitude through a table of points recorded at known heights, kept
+// in EEPROM. Between points, and beyond the ends, the altitude is
+// interpolated along the segment. Each segment's slope is stored as a Q16
+// reciprocal, so a conversion is a short search from the last segment, one
+// multiply and a shift. Without a stored table the default is the original
+// straight line of ALT_CAL_DEFAULT_SPAN counts per 100%.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "driverlib/eeprom.h"
+#include "utils/ustdlib.h"
+#include "system.h"
+#include "uart.h"
+#include "crc.h"
+#include "altcal.h"
+
+// Table in use, and the Q16 slope (% per count) from each point to the next.
+static int32_t calDrop[ALT_CAL_MAX_POINTS];
+static int32_t calPercent[ALT_CAL_MAX_POINTS];
+static int32_t calSlopeQ16[ALT_CAL_MAX_POINTS];
+static uint8_t calCount = 0;
+static uint8_t calSegment = 0;     // Segment of the last conversion
+static bool calStored = false;     // Table came from EEPROM
+
+static AltCalTable newTable;       // Table being recorded by CAL commands
+
+//*****************************************************************************
+// True if the table has at least two points, each higher and further below
+// the reference than the last by ALT_CAL_MIN_STEP counts.
+//*****************************************************************************
+static bool
+AltCalMonotonic(const AltCalTable* table)
+{
+    uint16_t i;
+
+    if (table->count < 2 || table->count > ALT_CAL_MAX_POINTS)
+    {
+        return false;
+    }
+    for (i = 1; i < table->count; i++)
+    {
+        if (table->points[i].percent <= table->points[i - 1].percent
+            || table->points[i].drop - table->points[i - 1].drop < ALT_CAL_MIN_STEP)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//*****************************************************************************
+// Makes table the one in use, working out each segment's slope. This is the
+// only place the conversion divides.
+//*****************************************************************************
+static void
+AltCalLoad(const AltCalTable* table)
+{
+    uint8_t i;
+
+    for (i = 0; i < table->count; i++)
+    {
+        calDrop[i] = table->points[i].drop;
+        calPercent[i] = table->points[i].percent;
+    }
+    for (i = 0; i + 1 < table->count; i++)
+    {
+        int32_t span = calDrop[i + 1] - calDrop[i];
+        calSlopeQ16[i] = (((calPercent[i + 1] - calPercent[i]) << 16) + span / 2) / span;
+    }
+    calSlopeQ16[table->count - 1] = calSlopeQ16[table->count - 2];
+    calCount = table->count;
+    calSegment = 0;
+}
+
+//*****************************************************************************
+// The straight line the altitude was originally taken from.
+//*****************************************************************************
+static void
+AltCalLoadDefault(void)
+{
+    AltCalTable table = {
+        .count = 2,
+        .points = {{0, 0}, {ALT_CAL_DEFAULT_SPAN, 100}}
+    };
+    AltCalLoad(&table);
+    calStored = false;
+}
+
+//*****************************************************************************
+// Loads the stored table, or the default if there is none or it fails its
+// checks.
+//*****************************************************************************
+void
+initAltCal(void)
+{
+    AltCalTable table;
+
+    AltCalLoadDefault();
+    if (eepromReady)
+    {
+        EEPROMRead((uint32_t*)&table, ALT_CAL_EEPROM_ADDR, sizeof(table));
+        if (table.magic == ALT_CAL_MAGIC && table.version == ALT_CAL_VERSION
+            && table.crc == Crc32(&table, offsetof(AltCalTable, crc))
+            && AltCalMonotonic(&table))
+        {
+            AltCalLoad(&table);
+            calStored = true;
+        }
+    }
+}
+
+//*****************************************************************************
+// Converts an ADC drop below refAltADC to altitude (%). The altitude moves
+// little between ticks, so the search starts from the last segment and
+// normally stops there.
+//*****************************************************************************
+RAMFUNC int32_t
+AltCalPercent(int32_t drop)
+{
+    uint8_t i = calSegment;
+
+    while (i > 0 && drop < calDrop[i])
+    {
+        i--;
+    }
+    while (i + 2 < calCount && drop >= calDrop[i + 1])
+    {
+        i++;
+    }
+    calSegment = i;
+    return calPercent[i] + (((drop - calDrop[i]) * calSlopeQ16[i] + 0x8000) >> 16);
+}
+
+//*****************************************************************************
+// Adds a point at the current ADC drop, replacing any at the same altitude
+// and keeping the table in altitude order.
+//*****************************************************************************
+static void
+AltCalRecord(Helicopter* heli, int32_t percent)
+{
+    int16_t drop = (int16_t)(heli->buffer->refAltADC - heli->buffer->meanVal);
+    char reply[40];
+    uint16_t i, j;
+
+    for (i = 0; i < newTable.count && newTable.points[i].percent < percent; i++)
+    {
+    }
+    if (i >= newTable.count || newTable.points[i].percent != percent)
+    {
+        if (newTable.count >= ALT_CAL_MAX_POINTS)
+        {
+            UARTSend("ERR CAL table full\r\n");
+            return;
+        }
+        for (j = newTable.count; j > i; j--)
+        {
+            newTable.points[j] = newTable.points[j - 1];
+        }
+        newTable.count++;
+    }
+    newTable.points[i].percent = (int16_t)percent;
+    newTable.points[i].drop = drop;
+
+    usnprintf(reply, sizeof(reply), "OK CAL %d%% at %d\r\n", percent, drop);
+    UARTSend(reply);
+}
+
+//*****************************************************************************
+// Checks and stores the recorded table, then uses it.
+//*****************************************************************************
+static void
+AltCalSave(void)
+{
+    if (!AltCalMonotonic(&newTable))
+    {
+        UARTSend("ERR CAL table not monotonic\r\n");
+        return;
+    }
+    if (!eepromReady)
+    {
+        UARTSend("ERR CAL no EEPROM\r\n");
+        return;
+    }
+    newTable.magic = ALT_CAL_MAGIC;
+    newTable.version = ALT_CAL_VERSION;
+    newTable.crc = Crc32(&newTable, offsetof(AltCalTable, crc));
+    if (EEPROMProgram((uint32_t*)&newTable, ALT_CAL_EEPROM_ADDR, sizeof(newTable)) != 0)
+    {
+        UARTSend("ERR CAL EEPROM write\r\n");
+        return;
+    }
+    AltCalLoad(&newTable);
+    calStored = true;
+    UARTSend("OK CAL SAVE\r\n");
+}
+
+//*****************************************************************************
+// Prints the table in use, one point per line.
+//*****************************************************************************
+static void
+AltCalShow(void)
+{
+    char reply[40];
+    uint8_t i;
+
+    usnprintf(reply, sizeof(reply), "OK CAL %s, %d points\r\n",
+              calStored ? "stored" : "default", calCount);
+    UARTSend(reply);
+    for (i = 0; i < calCount; i++)
+    {
+        usnprintf(reply, sizeof(reply), "CAL,%d,%d\r\n", calPercent[i], calDrop[i]);
+        UARTSend(reply);
+    }
+}
+
+//*****************************************************************************
+// Acts on a "CAL ..." command line. Points can only be taken with the rotors
+// stopped, the helicopter being held at each height.
+//*****************************************************************************
+void
+AltCalCommand(Helicopter* heli, const char* args)
+{
+    const char* end;
+    int32_t percent;
+    uint32_t blank = 0;
+
+    while (*args == ' ')
+    {
+        args++;
+    }
+    if (ustrncmp(args, "SHOW", 5) == 0)
+    {
+        AltCalShow();
+        return;
+    }
+    if (heli->submode != LANDED)
+    {
+        UARTSend("ERR CAL needs LANDED\r\n");
+        return;
+    }
+
+    if (ustrncmp(args, "CLEAR", 6) == 0)
+    {
+        newTable.count = 0;
+        UARTSend("OK CAL CLEAR\r\n");
+    }
+    else if (ustrncmp(args, "SAVE", 5) == 0)
+    {
+        AltCalSave();
+    }
+    else if (ustrncmp(args, "DEFAULT", 8) == 0)
+    {
+        if (eepromReady)
+        {
+            EEPROMProgram(&blank, ALT_CAL_EEPROM_ADDR, sizeof(blank));   // Clears the magic
+        }
+        AltCalLoadDefault();
+        UARTSend("OK CAL DEFAULT\r\n");
+    }
+    else
+    {
+        percent = ustrtol(args, &end, 10);
+        if (end == args || percent < 0 || percent > 100)
+        {
+            UARTSend("ERR CAL needs <alt 0-100>\r\n");
+            return;
+        }
+        AltCalRecord(heli, percent);
+    }
+}
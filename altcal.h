@@ -0,0 +1,68 @@
+#ifndef ALTCAL_H_
+#define ALTCAL_H_
+
+//*******************************************************************************
+// altcal.c
+//
+// Multi-point altitude calibration. The ADC drop below refAltADC is turned
+// into altitude through a table of points recorded at known heights, kept
+// in EEPROM. Between points, and beyond the ends, the altitude is
+// interpolated along the segment. Each segment's slope is stored as a Q16
+// reciprocal, so a conversion is a short search from the last segment, one
+// multiply and a shift. Without a stored table the default is the original
+// straight line of ALT_CAL_DEFAULT_SPAN counts per 100%.
+//
+// Commands, one per line, only while landed:
+//   CAL <alt %>      Record the current ADC drop as this altitude
+//   CAL CLEAR        Start a new table
+//   CAL SAVE         Check the new table is monotonic, store and use it
+//   CAL SHOW         Print the table in use
+//   CAL DEFAULT      Erase the stored table and go back to the default
+// Each is answered with an "OK ..." or "ERR ..." line.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rotors.h"
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+#define ALT_CAL_MAX_POINTS    8
+#define ALT_CAL_MIN_STEP      20           // Least ADC drop between points
+#define ALT_CAL_DEFAULT_SPAN  1241         // ADC counts per 100%, 1V
+#define ALT_CAL_MAGIC         0x43414C31   // "CAL1"
+#define ALT_CAL_VERSION       1
+#define ALT_CAL_EEPROM_ADDR   0x000        // Word aligned
+
+typedef struct {
+    int16_t drop;        // refAltADC - ADC mean at this height
+    int16_t percent;     // Altitude (%)
+} AltCalPoint;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    AltCalPoint points[ALT_CAL_MAX_POINTS];
+    uint32_t crc;        // CRC-32 of everything above
+} AltCalTable;
+
+//*****************************************************************************
+// Loads the stored table, or the default if there is none or it fails its
+// checks. Call after initEEPROM.
+void initAltCal(void);
+
+//*****************************************************************************
+// Converts an ADC drop below refAltADC to altitude (%).
+int32_t AltCalPercent(int32_t drop);
+
+//*****************************************************************************
+// Acts on a "CAL ..." command line, args being the text after "CAL".
+void AltCalCommand(Helicopter* heli, const char* args);
+
+#endif /* ALTCAL_H_ */
@@ -27,46 +27,75 @@
 #include "altitude.h"
 #include "rotors.h"
 #include "system.h"
+#include "events.h"
+#include "kernel.h"
+#include "altcal.h"
+
+// Samples and variance (ADC counts squared) the reference was taken from.
+uint32_t altSettleSamples = 0;
+uint32_t altSettleVariance = 0;
 
 //*****************************************************************************
-// Reference Altitude ADC value initialiser. Sets the reference altitude ADC 
-// value (refAltADC) which is used in altitude calculations. It delays this
-// calculation until the buffer is filled (of size 25, by Systick).
+// Reference Altitude ADC value initialiser. Sets the reference altitude ADC
+// value (refAltADC) which is used in altitude calculations. Sampling started
+// at boot, so some of the buffer is usually already filled. Each new sample
+// the mean and variance of the samples so far are taken, and once the mean
+// is known to within ALT_SETTLE_TOLERANCE (two standard errors) it becomes
+// the reference. A noisy rig waits for up to the full buffer. The buffer is
+// then filled with the reference so the altitude reads from it at once.
+// Yaw edges are decoded meanwhile; other events are not wanted yet.
 //*****************************************************************************
 void
 initAlt(Helicopter* heli)
 {
-    uint8_t sysTickCounter = 0;  // Tracks number of SysTick calls
-    uint8_t intialise = 0;   // Tracks whether buffer has been correctly filled.
-    // Circular altitude buffer fills itself (25 values fill entire buffer) via systick
-    while (!intialise) {
-        if (DeltaTFlag)
+    uint32_t lastSamples = 0;
+    uint32_t samples;
+    int32_t mean = 0;
+    uint32_t variance = 0;
+    Event event;
+
+    while (1) {
+        while (EventGet(&event))
         {
-            SysTick(heli);
-            sysTickCounter++;
+            if (event.type == EVENT_YAW_EDGE)
+            {
+                ExecuteYawInt(heli, event.value);   // Keep the decoder state current
+            }
+        }
 
-            // Once buffer full, determine reference altitude value by taking the mean
-            // of the buffer values.
-            if (sysTickCounter >= 25)
+        samples = adcSamples;
+        if (samples > BUF_SIZE)
+        {
+            samples = BUF_SIZE;
+        }
+
+        if (samples != lastSamples && samples >= ALT_SETTLE_MIN_SAMPLES)
+        {
+            lastSamples = samples;
+            BufferStats(samples, &mean, &variance);
+            if (4 * variance <= ALT_SETTLE_TOLERANCE * ALT_SETTLE_TOLERANCE * samples
+                || samples >= BUF_SIZE)
             {
-                BufferCalculate(heli);
-                heli->buffer->refAltADC = heli->buffer->meanVal;  // Sets reference ADC value to current buffer mean value
-                intialise = true;
+                break;
             }
         }
+        KernelIdle();
     }
+
+    heli->buffer->refAltADC = mean;
+    BufferFill(mean);
+    altSettleSamples = samples;
+    altSettleVariance = variance;
 }
 
 //*****************************************************************************
 // Background task: calculate the (approximate) mean of the values in the
-// circular buffer.Converts ADC input to altitude percentage relative to -1V. 
-// It takes the difference between the current reading and the reference ADC 
-// reading. This is divided by 1241 as it relates to a 1V range of the ADC readings.
-// This value is scaled by 100 to output a percentage.
+// circular buffer. Converts ADC input to altitude percentage from the drop
+// below the reference ADC reading, through the calibration table (altcal.h).
 //*****************************************************************************
-void
+RAMFUNC void
 CalculateAltitude(Helicopter* heli)
 {
     BufferCalculate(heli); // Update mean value of buffer.
-    heli->controller->curr_altitude_reading = (-((heli->buffer->meanVal - heli->buffer->refAltADC)* 100)/1241);
+    heli->controller->curr_altitude_reading = AltCalPercent(heli->buffer->refAltADC - heli->buffer->meanVal);
 }
@@ -22,11 +22,17 @@
 //*****************************************************************************
 // Constants
 //*****************************************************************************
-#define BUF_SIZE 25      // Buffer Size
+#define ALT_SETTLE_MIN_SAMPLES  ((BUF_SIZE < 16) ? BUF_SIZE : 16)   // Fewest samples the reference is taken from
+#define ALT_SETTLE_TOLERANCE    3    // Reference known to this many ADC counts (~0.25%)
+
+// Samples and variance (ADC counts squared) the reference was taken from.
+extern uint32_t altSettleSamples;
+extern uint32_t altSettleVariance;
 
 //*****************************************************************************
-// Reference Altitude ADC value initialiser. Sets the reference altitude ADC 
-// value (refAltADC) which is used in altitude calculations.
+// Reference Altitude ADC value initialiser. Sets the reference altitude ADC
+// value (refAltADC) which is used in altitude calculations, once the samples
+// taken since boot are steady enough (see ALT_SETTLE_TOLERANCE).
 //*****************************************************************************
 void initAlt(Helicopter* heli);
 
@@ -0,0 +1,154 @@
+//*******************************************************************************
+// bench.c
+//
+// Micro-benchmarks for the hot-path functions of the helicopter: the PID
+// controller, altitude buffer, yaw decoding, button polling, PWM updates and
+// the UART/OLED formatting. Each function is timed with the DWT cycle counter
+// with interrupts masked and the results are sent over UART as one CSV line
+// per function, ready for tools/benchcheck.py to compare against a baseline.
+// "make -C sitl bench" runs the same benchmarks on the host, timed by the
+// host's clock in nanoseconds (GetCycles, system.h).
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driverlib/cpu.h"
+#include "utils/ustdlib.h"
+#include "buttons4.h"
+#include "rotors.h"
+#include "altitude.h"
+#include "buffer.h"
+#include "yaw.h"
+#include "system.h"
+#include "uart.h"
+#include "bench.h"
+
+typedef struct {
+    const char* name;
+    void (*run)(Helicopter* heli);
+} Benchmark;
+
+static char benchStr[MAX_STR_LEN + 1];   // Scratch for the formatting benchmark
+
+//*****************************************************************************
+// Wrappers giving every benchmarked function the same signature.
+//*****************************************************************************
+static void benchEmpty(Helicopter* heli) { }
+static void benchController(Helicopter* heli) { ControllerImplementation(heli); }
+static void benchMainController(Helicopter* heli) { main_controller(heli); }
+static void benchTailController(Helicopter* heli) { tail_controller(heli); }
+static void benchBufferCalculate(Helicopter* heli) { BufferCalculate(heli); }
+static void benchCalculateAltitude(Helicopter* heli) { CalculateAltitude(heli); }
+static void benchExecuteYawInt(Helicopter* heli) { ExecuteYawInt(heli, ReadQuadrectureDecoder()); }
+static void benchGetYawAngle(Helicopter* heli) { GetYawAngleDegrees(heli); }
+static void benchUpdateButtons(Helicopter* heli) { updateButtons(); }
+static void benchSetPWM(Helicopter* heli) { SetPWM(heli->mainrotor); }
+static void benchUARTFormat(Helicopter* heli) { UARTFormatStatus(benchStr, heli); }
+static void benchDisplayProject(Helicopter* heli) { DisplayProject(heli); }
+
+static const Benchmark benchmarks[] = {
+    {"ControllerImplementation", benchController},
+    {"main_controller", benchMainController},
+    {"tail_controller", benchTailController},
+    {"BufferCalculate", benchBufferCalculate},
+    {"CalculateAltitude", benchCalculateAltitude},
+    {"ExecuteYawInt", benchExecuteYawInt},
+    {"GetYawAngleDegrees", benchGetYawAngle},
+    {"updateButtons", benchUpdateButtons},
+    {"SetPWM", benchSetPWM},
+    {"UARTFormatStatus", benchUARTFormat},
+    {"DisplayProject", benchDisplayProject}
+};
+
+#define NUM_BENCHMARKS  (sizeof(benchmarks) / sizeof(benchmarks[0]))
+
+//*****************************************************************************
+// Times BENCH_ITERATIONS calls of run, storing the min, total and max cycle
+// counts. Interrupts are masked per call so ISRs do not land in the result.
+//*****************************************************************************
+static void
+BenchTime(void (*run)(Helicopter* heli), Helicopter* heli, uint32_t overhead,
+          uint32_t* min, uint32_t* total, uint32_t* max)
+{
+    uint16_t i;
+
+    *min = UINT32_MAX;
+    *total = 0;
+    *max = 0;
+    for (i = 0; i < BENCH_ITERATIONS; i++)
+    {
+        uint32_t masked = CPUcpsid();
+        uint32_t start = GetCycles();
+        run(heli);
+        uint32_t cycles = GetCycles() - start;
+        if (!masked)
+        {
+            CPUcpsie();
+        }
+
+        cycles = (cycles > overhead) ? cycles - overhead : 0;
+        if (cycles < *min)
+        {
+            *min = cycles;
+        }
+        if (cycles > *max)
+        {
+            *max = cycles;
+        }
+        *total += cycles;
+    }
+}
+
+//*****************************************************************************
+// Times every hot-path function and prints a line per function of the form
+// "B,<name>,<iterations>,<min>,<mean>,<max>,<clock Hz>" in GetCycles()
+// counts. The cost of the timing itself, found by timing an empty function,
+// is subtracted. The controller, rotor and altitude state, the learned hover
+// duty and the button repeats are restored afterwards so the benchmarks can
+// run at boot without disturbing the first flight.
+//*****************************************************************************
+void
+RunBenchmarks(Helicopter* heli)
+{
+    char line[80];
+    uint32_t min, total, max, overhead;
+    uint8_t b;
+
+    Controller savedController = *heli->controller;
+    Rotor savedMain = *heli->mainrotor;
+    Rotor savedTail = *heli->tailrotor;
+    Buffer savedBuffer = *heli->buffer;
+    int32_t savedHoverDuty = hoverDuty;
+    uint32_t savedHoverLearns = hoverLearns;
+    ButtonRepeats savedButtons;
+
+    saveButtonRepeats(&savedButtons);
+
+    BenchTime(benchEmpty, heli, 0, &overhead, &total, &max);
+
+    for (b = 0; b < NUM_BENCHMARKS; b++)
+    {
+        BenchTime(benchmarks[b].run, heli, overhead, &min, &total, &max);
+        usnprintf(line, sizeof(line), "B,%s,%u,%u,%u,%u,%u\r\n", benchmarks[b].name,
+                  BENCH_ITERATIONS, min, total / BENCH_ITERATIONS, max, (uint32_t)CYCLES_CLOCK_HZ);
+        while (UARTTxSpace() < sizeof(line))
+        {
+            CPUwfi();   // Until the UART interrupt drains the ring, so no result is dropped
+        }
+        UARTSend(line);
+    }
+
+    *heli->controller = savedController;
+    *heli->mainrotor = savedMain;
+    *heli->tailrotor = savedTail;
+    *heli->buffer = savedBuffer;
+    hoverDuty = savedHoverDuty;
+    hoverLearns = savedHoverLearns;
+    restoreButtonRepeats(&savedButtons);
+    SetPWM(heli->mainrotor);
+    SetPWM(heli->tailrotor);
+}
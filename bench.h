@@ -0,0 +1,38 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+//*******************************************************************************
+// bench.c
+//
+// Micro-benchmarks for the hot-path functions of the helicopter: the PID
+// controller, altitude buffer, yaw decoding, button polling, PWM updates and
+// the UART/OLED formatting. Each function is timed with the DWT cycle counter
+// with interrupts masked and the results are sent over UART as one CSV line
+// per function, ready for tools/benchcheck.py to compare against a baseline.
+// "make -C sitl bench" runs the same benchmarks on the host, timed by the
+// host's clock in nanoseconds (GetCycles, system.h).
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rotors.h"
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+#ifndef BENCHMARK_ENABLED
+#define BENCHMARK_ENABLED   0      // Set to 1 to run the benchmarks at boot; the SITL's bench build does
+#endif
+#define BENCH_ITERATIONS    256    // Timed calls per function
+
+//*****************************************************************************
+// Times every hot-path function and prints a line per function of the form
+// "B,<name>,<iterations>,<min>,<mean>,<max>,<clock Hz>" in GetCycles()
+// counts, then restores the state the benchmarks disturbed.
+void RunBenchmarks(Helicopter* heli);
+
+#endif /* BENCH_H_ */
@@ -17,12 +17,20 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "inc/hw_memmap.h"
+#include "inc/hw_ints.h"
 #include "driverlib/adc.h"
+#include "driverlib/interrupt.h"
 #include "driverlib/sysctl.h"
 #include "driverlib/debug.h"
 #include "utils/ustdlib.h"
 #include "circBufT.h"
 #include "buffer.h"
+#include "system.h"
+#include "recorder.h"
+#include "isrstats.h"
+
+circBuf_t g_inBuffer;
+volatile uint32_t adcSamples = 0;
 
 //*****************************************************************************
 // Circular Buffer Initialiser for ADC altitude inputs.
@@ -45,8 +53,13 @@ initADC (void)
 
     // Enable sample sequence 3 with a processor signal trigger.  Sequence 3
     // will do a single sample when the processor sends a signal to start the
-    // conversion.
+    // conversion. With ADC_PWM_TRIGGER the main rotor's generator (PWM0
+    // generator 3) starts it instead, at a fixed phase of its period.
+#if ADC_PWM_TRIGGER
+    ADCSequenceConfigure(ADC0_BASE, 3, ADC_TRIGGER_PWM3, 0);
+#else
     ADCSequenceConfigure(ADC0_BASE, 3, ADC_TRIGGER_PROCESSOR, 0);
+#endif
 
     //
     // Configure step 0 on sequence 3.  Sample channel 0 (ADC_CTL_CH0) in
@@ -77,27 +90,36 @@ initADC (void)
 // The handler for the ADC conversion complete interrupt.
 // Writes to the circular buffer.
 //*****************************************************************************
-void
+RAMFUNC void
 ADCIntHandler(void)
 {
     uint32_t ulValue;
+    ISR_ENTER(ISR_ADC);
     //
-    // Get the single sample from ADC0.  ADC_BASE is defined in
-    // inc/hw_memmap.h
-    ADCSequenceDataGet(ADC0_BASE, 3, &ulValue);
-    //
-    // Place it in the circular buffer (advancing write index)
-    writeCircBuf (&g_inBuffer , ulValue);
-    //
-    // Clean up, clearing the interrupt
-    ADCIntClear(ADC0_BASE, 3);
+    // A latency probe pends the interrupt with no conversion complete
+    if (ADCIntStatus(ADC0_BASE, 3, true))
+    {
+        //
+        // Get the single sample from ADC0.  ADC_BASE is defined in
+        // inc/hw_memmap.h
+        ADCSequenceDataGet(ADC0_BASE, 3, &ulValue);
+        RECORD(REC_ADC, ulValue);
+        //
+        // Place it in the circular buffer (advancing write index)
+        writeCircBuf (&g_inBuffer , ulValue);
+        adcSamples++;
+        //
+        // Clean up, clearing the interrupt
+        ADCIntClear(ADC0_BASE, 3);
+    }
+    ISR_EXIT(ISR_ADC);
 }
 
 //*****************************************************************************
 // Background task: calculate the (approximate) mean of the values in the
 // circular buffer.
 //*****************************************************************************
-void
+RAMFUNC void
 BufferCalculate(Helicopter* heli)
 {
     // Iterates through the buffer and sums values then calculates the mean
@@ -108,3 +130,48 @@ BufferCalculate(Helicopter* heli)
     }
     heli->buffer->meanVal = (2 * sum + BUF_SIZE) / 2 / BUF_SIZE;
 }
+
+//*****************************************************************************
+// Fills the circular buffer with value. Writing BUF_SIZE entries leaves the
+// write index where it was, so the ADC carries on from the same place. The
+// ADC interrupt is held off meanwhile; a sample that completes is kept
+// pending and written once the fill is done.
+//*****************************************************************************
+void
+BufferFill(int32_t value)
+{
+    uint16_t i;
+    IntDisable(INT_ADC0SS3);
+    for (i = 0; i < BUF_SIZE; i++) {
+        writeCircBuf (&g_inBuffer, value);
+    }
+    IntEnable(INT_ADC0SS3);
+}
+
+//*****************************************************************************
+// Mean and variance of the latest count samples, counting back from the
+// write index. Used while the buffer is still filling at boot.
+//*****************************************************************************
+void
+BufferStats(uint32_t count, int32_t* mean, uint32_t* variance)
+{
+    int32_t index = g_inBuffer.windex;
+    int64_t sum = 0;
+    int64_t sumSquares = 0;
+    uint32_t i;
+
+    if (count == 0)
+    {
+        *mean = 0;
+        *variance = 0;
+        return;
+    }
+    for (i = 0; i < count; i++) {
+        index = (index > 0) ? index - 1 : BUF_SIZE - 1;
+        int32_t value = g_inBuffer.data[index];
+        sum += value;
+        sumSquares += (int64_t)value * value;
+    }
+    *mean = (int32_t)((2 * sum + count) / 2 / count);
+    *variance = (uint32_t)((sumSquares * count - sum * sum) / ((int64_t)count * count));
+}
@@ -17,16 +17,31 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "rotors.h"
+#include "system.h"
 
 //*****************************************************************************
 // Constants
 //*****************************************************************************
-#define BUF_SIZE 25      // Buffer Size
+// Samples synchronised to the PWM miss the switching transients, so fewer
+// of them average to the same noise. 80 ms of PWM samples matched the
+// variance of the mean of 100 ms of SysTick samples with switching spikes
+// in the SITL; the Diag ADC line on a rig is the measure to size this by.
+#if ADC_PWM_TRIGGER
+#define ADC_RATE_HZ      MAIN_PWM_START_RATE_HZ   // One sample per main PWM period
+#define ADC_WINDOW_MS    80
+#else
+#define ADC_RATE_HZ      ADC_SAMPLE_RATE_HZ
+#define ADC_WINDOW_MS    100
+#endif
+#define BUF_SIZE (ADC_RATE_HZ * ADC_WINDOW_MS / 1000)     // Buffer Size, ADC_WINDOW_MS of samples
 
 //*****************************************************************************
-// Initialise the circular buffer that heli will use, see note below far right...
+// The circular buffer the ADC interrupt fills, defined in buffer.c.
 //*****************************************************************************
-static circBuf_t g_inBuffer;                                                                              // are we sure this is globally readable by buffers?
+extern circBuf_t g_inBuffer;
+
+// Conversions completed since boot.
+extern volatile uint32_t adcSamples;
 
 //*****************************************************************************
 // Circular Buffer Initialiser for ADC altitude inputs.
@@ -46,4 +61,13 @@ void initADC (void);
 // circular buffer.
 void BufferCalculate(Helicopter* heli);
 
+//*****************************************************************************
+// Fills the circular buffer with value, so the mean starts there rather than
+// waiting for BUF_SIZE samples.
+void BufferFill(int32_t value);
+
+//*****************************************************************************
+// Mean and variance (ADC counts squared) of the latest count samples.
+void BufferStats(uint32_t count, int32_t* mean, uint32_t* variance);
+
 #endif /* BUFFER_H_ */
@@ -10,8 +10,12 @@
 // Note that pin PF0 (the pin for the RIGHT pushbutton - SW2 on
 //  the Tiva board) needs special treatment - See PhilsNotesOnTiva.rtf.
 //
+// The edge interrupt handler is the only writer of the button states and
+// press counts; the kernel (updateButtons) only writes the repeat counts, so
+// neither side needs to mask interrupts.
+//
 // P.J. Bones UCECE
-// Last modified:  7.2.2018
+// Last modified:  18.10.26
 // 
 // *******************************************************
 
@@ -23,16 +27,33 @@
 #include "driverlib/gpio.h"
 #include "driverlib/sysctl.h"
 #include "driverlib/debug.h"
+#include "driverlib/interrupt.h"
+#include "inc/hw_ints.h"
 #include "inc/tm4c123gh6pm.h"  // Board specific defines (for PF0)
+#include "system.h"
+#include "recorder.h"
+#include "isrstats.h"
 
 
 // *******************************************************
 // Globals to module
 // *******************************************************
-static bool but_state[NUM_BUTS];    // Corresponds to the electrical state
-static uint8_t but_count[NUM_BUTS];
-static bool but_flag[NUM_BUTS];
+static volatile bool but_state[NUM_BUTS];    // Corresponds to the electrical state
+static volatile bool but_flag[NUM_BUTS];
 static bool but_normal[NUM_BUTS];   // Corresponds to the electrical state
+static volatile uint32_t but_change_time[NUM_BUTS];  // sysTickCount of the last accepted change
+static volatile uint8_t but_presses[NUM_BUTS];       // Pushes, counted by the interrupt
+static uint8_t but_presses_taken[NUM_BUTS];
+static uint8_t but_repeats[NUM_BUTS];                // Auto-repeats, counted by updateButtons
+static uint8_t but_repeats_taken[NUM_BUTS];
+static uint32_t but_repeat_time[NUM_BUTS];           // sysTickCount of the next repeat
+static uint32_t but_repeat_interval[NUM_BUTS];
+static uint8_t but_repeat_press[NUM_BUTS];           // but_presses the repeat timing is for
+
+static const uint32_t but_port[NUM_BUTS] = {UP_BUT_PORT_BASE, DOWN_BUT_PORT_BASE,
+                                            LEFT_BUT_PORT_BASE, RIGHT_BUT_PORT_BASE};
+static const uint8_t but_pin[NUM_BUTS] = {UP_BUT_PIN, DOWN_BUT_PIN, LEFT_BUT_PIN, RIGHT_BUT_PIN};
+static const uint32_t but_int[NUM_BUTS] = {INT_GPIOE, INT_GPIOD, INT_GPIOF, INT_GPIOF};
 
 // *******************************************************
 // initButtons: Initialise the variables associated with the set of buttons
@@ -77,46 +98,115 @@ initButtons (void)
     for (i = 0; i < NUM_BUTS; i++)
     {
         but_state[i] = but_normal[i];
-        but_count[i] = 0;
         but_flag[i] = false;
+        but_change_time[i] = sysTickCount - BUT_DEBOUNCE_TICKS;
+    }
+
+    // Interrupt on both edges of every button. Ports E, D and F share the
+    // one handler, which looks at all four buttons.
+    for (i = 0; i < NUM_BUTS; i++)
+    {
+        GPIOIntDisable (but_port[i], but_pin[i]);
+        GPIOIntTypeSet (but_port[i], but_pin[i], GPIO_BOTH_EDGES);
+        GPIOIntClear (but_port[i], but_pin[i]);
+    }
+    GPIOIntRegister (UP_BUT_PORT_BASE, ButtonIntHandler);
+    GPIOIntRegister (DOWN_BUT_PORT_BASE, ButtonIntHandler);
+    GPIOIntRegister (LEFT_BUT_PORT_BASE, ButtonIntHandler);   // Also RIGHT
+    for (i = 0; i < NUM_BUTS; i++)
+    {
+        GPIOIntEnable (but_port[i], but_pin[i]);
+    }
+}
+
+// *******************************************************
+// ButtonIntHandler: Clears the edges and reads all four buttons. A change
+// of level is taken unless the button changed within BUT_DEBOUNCE_TICKS,
+// in which case updateButtons pends this interrupt again to re-sample it
+// once the window has passed. Any number of buttons may change at once.
+RAMFUNC void
+ButtonIntHandler (void)
+{
+    ISR_ENTER(ISR_BUTTONS);
+    uint32_t now = sysTickCount;
+    bool but_value;
+    uint16_t levels = 0;
+    int i;
+
+    for (i = 0; i < NUM_BUTS; i++)
+    {
+        GPIOIntClear (but_port[i], but_pin[i]);
     }
+    for (i = 0; i < NUM_BUTS; i++)
+    {
+        but_value = (GPIOPinRead (but_port[i], but_pin[i]) == but_pin[i]);
+        levels |= but_value << i;
+        if (but_value != but_state[i] && (now - but_change_time[i]) >= BUT_DEBOUNCE_TICKS)
+        {
+            but_state[i] = but_value;
+            but_change_time[i] = now;
+            but_flag[i] = true;    // Reset by call to checkButton()
+            if (but_value != but_normal[i])
+            {
+                but_presses[i]++;
+            }
+        }
+    }
+#if RECORD_ENABLED
+    static uint16_t prev_levels = 0xFFFF;
+    if (levels != prev_levels)
+    {
+        prev_levels = levels;
+        RECORD(REC_BUTTONS, levels);
+    }
+#else
+    (void)levels;
+#endif
+    ISR_EXIT(ISR_BUTTONS);
 }
 
 // *******************************************************
-// updateButtons: Function designed to be called regularly. It polls all
-// buttons once and updates variables associated with the buttons if
-// necessary.  It is efficient enough to be part of an ISR, e.g. from
-// a SysTick interrupt.
-// Debounce algorithm: A state machine is associated with each button.
-// A state change occurs only after NUM_BUT_POLLS consecutive polls have
-// read the pin in the opposite condition, before the state changes and
-// a flag is set.  Set NUM_BUT_POLLS according to the polling rate.
+// updateButtons: Function designed to be called regularly from the kernel.
+// For each held button it counts an auto-repeat when one is due, shortening
+// the interval each time. A button whose pin no longer matches its state
+// (a release or press that fell inside the debounce window) has its
+// interrupt pended so the handler re-samples it.
 void
 updateButtons (void)
 {
-    bool but_value[NUM_BUTS];
+    uint32_t now = sysTickCount;
+    bool but_value;
     int i;
 
-    // Read the pins; true means HIGH, false means LOW
-    but_value[UP] = (GPIOPinRead (UP_BUT_PORT_BASE, UP_BUT_PIN) == UP_BUT_PIN);
-    but_value[DOWN] = (GPIOPinRead (DOWN_BUT_PORT_BASE, DOWN_BUT_PIN) == DOWN_BUT_PIN);
-    but_value[LEFT] = (GPIOPinRead (LEFT_BUT_PORT_BASE, LEFT_BUT_PIN) == LEFT_BUT_PIN);
-    but_value[RIGHT] = (GPIOPinRead (RIGHT_BUT_PORT_BASE, RIGHT_BUT_PIN) == RIGHT_BUT_PIN);
-    // Iterate through the buttons, updating button variables as required
     for (i = 0; i < NUM_BUTS; i++)
     {
-        if (but_value[i] != but_state[i])
+        but_value = (GPIOPinRead (but_port[i], but_pin[i]) == but_pin[i]);
+        if (but_value != but_state[i] && (now - but_change_time[i]) >= BUT_DEBOUNCE_TICKS)
+        {
+            IntPendSet (but_int[i]);
+        }
+
+        if (but_state[i] == but_normal[i])
         {
-            but_count[i]++;
-            if (but_count[i] >= NUM_BUT_POLLS)
+            continue;   // Released
+        }
+        if (but_repeat_press[i] != but_presses[i])
+        {
+            // New press, start the repeat timing from it
+            but_repeat_press[i] = but_presses[i];
+            but_repeat_time[i] = but_change_time[i] + BUT_REPEAT_DELAY_TICKS;
+            but_repeat_interval[i] = BUT_REPEAT_START_TICKS;
+        }
+        if ((int32_t)(now - but_repeat_time[i]) >= 0)
+        {
+            but_repeats[i]++;
+            but_repeat_time[i] = now + but_repeat_interval[i];
+            but_repeat_interval[i] = but_repeat_interval[i] * 3 / 4;
+            if (but_repeat_interval[i] < BUT_REPEAT_MIN_TICKS)
             {
-                but_state[i] = but_value[i];
-                but_flag[i] = true;    // Reset by call to checkButton()
-                but_count[i] = 0;
+                but_repeat_interval[i] = BUT_REPEAT_MIN_TICKS;
             }
         }
-        else
-            but_count[i] = 0;
     }
 }
 
@@ -138,3 +228,51 @@ checkButton (uint8_t butName)
     return NO_CHANGE;
 }
 
+// *******************************************************
+// checkButtonPresses: Returns the presses and auto-repeats of the button
+// since the last call. The counters are free running, so this only takes
+// the difference from what was last returned.
+uint8_t
+checkButtonPresses (uint8_t butName)
+{
+    uint8_t presses = but_presses[butName];
+    uint8_t repeats = but_repeats[butName];
+    uint8_t count = (uint8_t)(presses - but_presses_taken[butName])
+                  + (uint8_t)(repeats - but_repeats_taken[butName]);
+
+    but_presses_taken[butName] = presses;
+    but_repeats_taken[butName] = repeats;
+    return count;
+}
+
+// *******************************************************
+// saveButtonRepeats, restoreButtonRepeats: The repeat counters and timing,
+// the only state updateButtons writes. Both run in kernel context, like
+// updateButtons, so need no masking.
+void
+saveButtonRepeats (ButtonRepeats* saved)
+{
+    int i;
+
+    for (i = 0; i < NUM_BUTS; i++)
+    {
+        saved->repeats[i] = but_repeats[i];
+        saved->repeat_time[i] = but_repeat_time[i];
+        saved->repeat_interval[i] = but_repeat_interval[i];
+        saved->repeat_press[i] = but_repeat_press[i];
+    }
+}
+
+void
+restoreButtonRepeats (const ButtonRepeats* saved)
+{
+    int i;
+
+    for (i = 0; i < NUM_BUTS; i++)
+    {
+        but_repeats[i] = saved->repeats[i];
+        but_repeat_time[i] = saved->repeat_time[i];
+        but_repeat_interval[i] = saved->repeat_interval[i];
+        but_repeat_press[i] = saved->repeat_press[i];
+    }
+}
@@ -8,14 +8,17 @@
 // ENCE361 sample code.
 // The buttons are:  UP and DOWN (on the Orbit daughterboard) plus
 // LEFT and RIGHT on the Tiva.
+// Edges are taken by interrupt; a held button auto-repeats, faster the
+// longer it is held.
 //
 // P.J. Bones UCECE
-// Last modified:  7.2.2018
+// Last modified:  18.10.26
 // 
 // *******************************************************
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "system.h"
 
 //*****************************************************************************
 // Constants
@@ -43,23 +46,47 @@ enum butStates {RELEASED = 0, PUSHED, NO_CHANGE};
 #define RIGHT_BUT_PIN  GPIO_PIN_0
 #define RIGHT_BUT_NORMAL  true
 
-#define NUM_BUT_POLLS 3
-// Debounce algorithm: A state machine is associated with each button.
-// A state change occurs only after NUM_BUT_POLLS consecutive polls have
-// read the pin in the opposite condition, before the state changes and
-// a flag is set.  Set NUM_BUT_POLLS according to the polling rate.
+// Debounce algorithm: Every edge interrupts. The first change of level is
+// taken at once, and further changes are ignored until BUT_DEBOUNCE_MS
+// has passed since it, timed with sysTickCount. updateButtons re-samples
+// any pin left at the other level once the window has passed.
+#define BUT_DEBOUNCE_MS        10
+#define BUT_DEBOUNCE_TICKS     (BUT_DEBOUNCE_MS * SYSTICK_RATE_HZ / 1000)
+
+// Auto-repeat: a button held for BUT_REPEAT_DELAY_MS repeats its press,
+// first every BUT_REPEAT_START_MS, each interval then shortened to 3/4 of
+// the last down to BUT_REPEAT_MIN_MS.
+#define BUT_REPEAT_DELAY_MS    400
+#define BUT_REPEAT_START_MS    250
+#define BUT_REPEAT_MIN_MS      50
+#define BUT_REPEAT_DELAY_TICKS (BUT_REPEAT_DELAY_MS * SYSTICK_RATE_HZ / 1000)
+#define BUT_REPEAT_START_TICKS (BUT_REPEAT_START_MS * SYSTICK_RATE_HZ / 1000)
+#define BUT_REPEAT_MIN_TICKS   (BUT_REPEAT_MIN_MS * SYSTICK_RATE_HZ / 1000)
+
+// The auto-repeat state updateButtons keeps, for saveButtonRepeats
+typedef struct {
+    uint8_t repeats[NUM_BUTS];
+    uint32_t repeat_time[NUM_BUTS];
+    uint32_t repeat_interval[NUM_BUTS];
+    uint8_t repeat_press[NUM_BUTS];
+} ButtonRepeats;
 
 // *******************************************************
 // initButtons: Initialise the variables associated with the set of buttons
-// defined by the constants above.
+// defined by the constants above, and their edge interrupts.
 void
 initButtons (void);
 
 // *******************************************************
-// updateButtons: Function designed to be called regularly. It polls all
-// buttons once and updates variables associated with the buttons if
-// necessary.  It is efficient enough to be part of an ISR, e.g. from
-// a SysTick interrupt.
+// ButtonIntHandler: Edge interrupt handler for all three button ports.
+// Debounces and updates the button states.
+void
+ButtonIntHandler (void);
+
+// *******************************************************
+// updateButtons: Function designed to be called regularly from the kernel.
+// Generates the auto-repeat presses of held buttons and re-samples any
+// button whose level changed inside the debounce window.
 void
 updateButtons (void);
 
@@ -71,4 +98,20 @@ updateButtons (void);
 uint8_t
 checkButton (uint8_t butName);
 
+// *******************************************************
+// checkButtonPresses: Returns the number of presses, auto-repeats included,
+// of the button since the last call. Kernel context only. Each button is
+// counted independently, so simultaneous presses are all seen.
+uint8_t
+checkButtonPresses (uint8_t butName);
+
+// *******************************************************
+// saveButtonRepeats, restoreButtonRepeats: Copy out and back the state
+// updateButtons writes, so it can be called without counting presses
+// (bench.c). Kernel context only.
+void
+saveButtonRepeats (ButtonRepeats* saved);
+void
+restoreButtonRepeats (const ButtonRepeats* saved);
+
 #endif /*BUTTONS_H_*/
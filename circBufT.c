@@ -12,6 +12,7 @@
 #include <stdint.h>
 #include "stdlib.h"
 #include "circBufT.h"
+#include "memstats.h"
 
 // *******************************************************
 // initCircBuf: Initialise the circBuf instance. Reset both indices to
@@ -25,10 +26,10 @@ initCircBuf (circBuf_t *buffer, int32_t size)
     buffer->rindex = 0;
     buffer->size = size;
     buffer->data =
-        (int32_t *) calloc (size, sizeof(int32_t));
+        (int32_t *) MemCalloc (size, sizeof(int32_t));
     return buffer->data;
 }
-   // Note use of calloc() to clear contents.
+   // Note use of calloc() to clear contents, counted by MemCalloc().
 
 // *******************************************************
 // writeCircBuf: insert entry at the current windex location,
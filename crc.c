@@ -0,0 +1,41 @@
+//*******************************************************************************
+// crc.c
+//
+// CRC-32 (IEEE 802.3, reflected, as used by zlib and Python's binascii) for
+// checking stored and transmitted data. The TM4C123 has no CRC peripheral,
+// so it is computed in software a nibble at a time from a 16 entry table.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "crc.h"
+
+// CRC of each nibble value, polynomial 0xEDB88320.
+static const uint32_t crcTable[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+//*****************************************************************************
+// Returns the CRC-32 of length bytes at data.
+//*****************************************************************************
+uint32_t
+Crc32(const void* data, uint32_t length)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    uint32_t crc = 0xFFFFFFFF;
+
+    while (length--)
+    {
+        crc ^= *bytes++;
+        crc = (crc >> 4) ^ crcTable[crc & 0x0F];
+        crc = (crc >> 4) ^ crcTable[crc & 0x0F];
+    }
+    return ~crc;
+}
@@ -0,0 +1,23 @@
+#ifndef CRC_H_
+#define CRC_H_
+
+//*******************************************************************************
+// crc.c
+//
+// CRC-32 (IEEE 802.3, reflected, as used by zlib and Python's binascii) for
+// checking stored and transmitted data. The TM4C123 has no CRC peripheral,
+// so it is computed in software a nibble at a time from a 16 entry table.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+// Returns the CRC-32 of length bytes at data.
+uint32_t Crc32(const void* data, uint32_t length);
+
+#endif /* CRC_H_ */
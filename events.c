@@ -0,0 +1,177 @@
+//*******************************************************************************
+// events.c
+//
+// Lock-free queue of timestamped events from the interrupt handlers to the
+// kernel. Every SysTick, quadrature edge, yaw reference crossing and mode
+// switch edge is queued individually, so repeated events no longer coalesce
+// into one flag. Any ISR may post; only the kernel takes events out. When
+// the queue is full the event is counted per type instead of vanishing.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driverlib/cpu.h"
+#include "rotors.h"
+#include "system.h"
+#include "events.h"
+
+//*****************************************************************************
+// Each slot carries a sequence number. A slot at position pos is free for a
+// producer when its sequence equals pos, and holds a published event for the
+// consumer when it equals pos + 1. Producers claim a position by compare and
+// swap on queueHead; on the Cortex-M4 this is LDREX/STREX, and exception
+// entry clears the exclusive monitor, so an ISR that preempts another
+// mid-claim makes the preempted one retry rather than both taking the slot.
+// A claimed slot is only read once its sequence is published, so the kernel
+// never sees a half written event.
+//*****************************************************************************
+typedef struct {
+    volatile uint32_t sequence;
+    volatile Event event;      // Volatile so it is written before sequence is published
+} EventSlot;
+
+static EventSlot eventQueue[EVENT_QUEUE_SIZE];
+static volatile uint32_t queueHead = 0;    // Next position to claim (producers)
+static volatile uint32_t queueTail = 0;    // Next position to read (kernel)
+
+volatile uint32_t eventOverflows[NUM_EVENT_TYPES];
+volatile uint16_t eventHighWater = 0;
+
+//*****************************************************************************
+// Atomically replaces *target with desired if it still holds expected.
+// TI's armcl has no atomic builtins, so there the swap is done with
+// interrupts briefly masked instead.
+//*****************************************************************************
+static bool
+CompareAndSwap(volatile uint32_t* target, uint32_t expected, uint32_t desired)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __atomic_compare_exchange_n(target, &expected, desired, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+#else
+    bool swapped = false;
+    uint32_t masked = CPUcpsid();
+    if (*target == expected)
+    {
+        *target = desired;
+        swapped = true;
+    }
+    if (!masked)
+    {
+        CPUcpsie();
+    }
+    return swapped;
+#endif
+}
+
+//*****************************************************************************
+// Adds one to *target, atomically against the other ISRs that post, in the
+// same way as CompareAndSwap.
+//*****************************************************************************
+static void
+AtomicIncrement(volatile uint32_t* target)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    __atomic_fetch_add(target, 1, __ATOMIC_RELAXED);
+#else
+    uint32_t masked = CPUcpsid();
+    (*target)++;
+    if (!masked)
+    {
+        CPUcpsie();
+    }
+#endif
+}
+
+//*****************************************************************************
+// Gives every slot its starting sequence. Must run before any interrupt that
+// posts events is enabled.
+//*****************************************************************************
+void
+initEvents(void)
+{
+    uint32_t i;
+
+    for (i = 0; i < EVENT_QUEUE_SIZE; i++)
+    {
+        eventQueue[i].sequence = i;
+    }
+}
+
+//*****************************************************************************
+// Posts an event from interrupt context. Returns false, counting the event
+// in eventOverflows, if the queue is full.
+//*****************************************************************************
+RAMFUNC bool
+EventPost(EventType type, uint8_t value)
+{
+    uint32_t pos = queueHead;
+    EventSlot* slot;
+
+    while (1)
+    {
+        slot = &eventQueue[pos & (EVENT_QUEUE_SIZE - 1)];
+        int32_t diff = (int32_t)(slot->sequence - pos);
+        if (diff == 0)
+        {
+            if (CompareAndSwap(&queueHead, pos, pos + 1))
+            {
+                break;        // Slot claimed
+            }
+            pos = queueHead;
+        }
+        else if (diff < 0)
+        {
+            AtomicIncrement(&eventOverflows[type]);   // Kernel has not read this slot yet: full
+            return false;
+        }
+        else
+        {
+            pos = queueHead;  // Another ISR claimed it first
+        }
+    }
+
+    slot->event.timestamp = GetTimestamp();
+    slot->event.type = type;
+    slot->event.value = value;
+    slot->sequence = pos + 1;         // Publish to the kernel
+
+    uint16_t depth = (uint16_t)(pos + 1 - queueTail);
+    if (depth > eventHighWater)
+    {
+        eventHighWater = depth;
+    }
+    return true;
+}
+
+//*****************************************************************************
+// Takes the oldest event from the queue. Kernel context only. Returns false
+// if no event is waiting.
+//*****************************************************************************
+bool
+EventGet(Event* event)
+{
+    EventSlot* slot = &eventQueue[queueTail & (EVENT_QUEUE_SIZE - 1)];
+
+    if (slot->sequence != queueTail + 1)
+    {
+        return false;
+    }
+    *event = slot->event;
+    slot->sequence = queueTail + EVENT_QUEUE_SIZE;   // Free the slot for the next lap
+    queueTail++;
+    return true;
+}
+
+//*****************************************************************************
+// Returns true if an event is waiting for the kernel.
+//*****************************************************************************
+bool
+EventPending(void)
+{
+    return eventQueue[queueTail & (EVENT_QUEUE_SIZE - 1)].sequence == queueTail + 1;
+}
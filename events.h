@@ -0,0 +1,65 @@
+#ifndef EVENTS_H_
+#define EVENTS_H_
+
+//*******************************************************************************
+// events.c
+//
+// Lock-free queue of timestamped events from the interrupt handlers to the
+// kernel. Every SysTick, quadrature edge, yaw reference crossing and mode
+// switch edge is queued individually, so repeated events no longer coalesce
+// into one flag. Any ISR may post; only the kernel takes events out. When
+// the queue is full the event is counted per type instead of vanishing.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+#define EVENT_QUEUE_SIZE    128      // Must be a power of two
+
+typedef enum {
+    EVENT_TICK = 0,      // SysTick, value unused
+    EVENT_YAW_EDGE,      // Quadrature edge, value is the PB1:PB0 state
+    EVENT_YAW_REF,       // Yaw reference edge, value is the PC4 level
+    EVENT_MODE_SWITCH,   // SW1 edge, value is the SW1 level
+    NUM_EVENT_TYPES
+} EventType;
+
+typedef struct {
+    uint32_t timestamp;  // GetTimestamp() when the ISR posted the event
+    uint8_t type;        // EventType
+    uint8_t value;
+} Event;
+
+// Events lost because the queue was full, per EventType.
+extern volatile uint32_t eventOverflows[NUM_EVENT_TYPES];
+
+// Greatest number of events waiting at once, since cleared.
+extern volatile uint16_t eventHighWater;
+
+//*****************************************************************************
+// Gives every queue slot its starting sequence. Must run before any interrupt
+// that posts events is enabled.
+void initEvents(void);
+
+//*****************************************************************************
+// Posts an event from interrupt context. Returns false, counting the event
+// in eventOverflows, if the queue is full.
+bool EventPost(EventType type, uint8_t value);
+
+//*****************************************************************************
+// Takes the oldest event from the queue. Kernel context only. Returns false
+// if no event is waiting.
+bool EventGet(Event* event);
+
+//*****************************************************************************
+// Returns true if an event is waiting for the kernel.
+bool EventPending(void);
+
+#endif /* EVENTS_H_ */
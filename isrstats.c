@@ -0,0 +1,124 @@
+//*******************************************************************************
+// isrstats.c
+//
+// Measures the entry latency and duration of every interrupt handler. The
+// SysTick latency is read from the SysTick counter itself, which reloaded at
+// the moment the interrupt was raised. The other interrupts have no hardware
+// timestamp, so the SysTick handler periodically pends one of them by
+// software with the time noted; the handler works out its latency on entry
+// and, finding no peripheral status set, does nothing else. Durations are
+// measured on every entry and include any time spent preempted by a higher
+// priority handler.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "inc/hw_ints.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/systick.h"
+#include "system.h"
+#include "isrstats.h"
+#include "trace.h"
+
+volatile IsrStats isrStats[NUM_ISRS];
+
+// NVIC interrupt of each ISR, 0 for those not probed.
+static const uint32_t isrInterrupt[NUM_ISRS] = {
+    INT_GPIOB,       // ISR_YAW
+    INT_GPIOC,       // ISR_YAW_REF
+    0,               // ISR_SYSTICK, latency from the SysTick counter
+    INT_ADC0SS3,     // ISR_ADC
+    INT_GPIOA,       // ISR_MODE_SW
+    INT_UART0,       // ISR_UART
+    INT_GPIOE        // ISR_BUTTONS
+};
+
+static volatile uint32_t probeTime[NUM_ISRS];
+static volatile bool probePending[NUM_ISRS];
+
+//*****************************************************************************
+// Records the entry latency, from the SysTick counter for SysTick or from a
+// pending probe otherwise, and returns the entry timestamp. The entry is
+// also traced, see trace.h.
+//*****************************************************************************
+RAMFUNC uint32_t
+IsrEnter(IsrId id)
+{
+    uint32_t entry = GetTimestamp();
+    uint32_t latency;
+
+#if TRACE_ENABLED
+    TraceWrite(id, false, entry);
+#endif
+    if (id == ISR_SYSTICK)
+    {
+        latency = (SysTickPeriodGet() - 1) - SysTickValueGet();
+    }
+    else if (probePending[id])
+    {
+        probePending[id] = false;
+        latency = entry - probeTime[id];
+    }
+    else
+    {
+        return entry;
+    }
+
+    if (latency > isrStats[id].latencyMax)
+    {
+        isrStats[id].latencyMax = latency;
+    }
+    return entry;
+}
+
+//*****************************************************************************
+// Records the time spent in the handler, and traces the exit.
+//*****************************************************************************
+RAMFUNC void
+IsrExit(IsrId id, uint32_t entry)
+{
+    uint32_t exit = GetTimestamp();
+    uint32_t duration = exit - entry;
+
+#if TRACE_ENABLED
+    TraceWrite(id, true, exit);
+#endif
+    isrStats[id].count++;
+    if (duration > isrStats[id].durationMax)
+    {
+        isrStats[id].durationMax = duration;
+    }
+}
+
+//*****************************************************************************
+// Pends the next probed interrupt every ISR_PROBE_DIVIDER calls. A probe
+// still outstanding is left alone so its latency is not overwritten.
+//*****************************************************************************
+RAMFUNC void
+IsrProbe(void)
+{
+    static uint8_t probeTick = 0;
+    static uint8_t next = 0;
+
+    if (++probeTick < ISR_PROBE_DIVIDER)
+    {
+        return;
+    }
+    probeTick = 0;
+
+    do
+    {
+        next = (next + 1) % NUM_ISRS;
+    } while (isrInterrupt[next] == 0);
+
+    if (!probePending[next])
+    {
+        probeTime[next] = GetTimestamp();
+        probePending[next] = true;
+        IntPendSet(isrInterrupt[next]);
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef ISRSTATS_H_
+#define ISRSTATS_H_
+
+//*******************************************************************************
+// isrstats.c
+//
+// Measures the entry latency and duration of every interrupt handler. The
+// SysTick latency is read from the SysTick counter itself, which reloaded at
+// the moment the interrupt was raised. The other interrupts have no hardware
+// timestamp, so the SysTick handler periodically pends one of them by
+// software with the time noted; the handler works out its latency on entry
+// and, finding no peripheral status set, does nothing else. Durations are
+// measured on every entry and include any time spent preempted by a higher
+// priority handler.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+#define ISR_STATS_ENABLED    1
+#define ISR_PROBE_DIVIDER    10    // SysTicks between probes, each ISR in turn
+
+typedef enum {
+    ISR_YAW = 0,         // GPIOB quadrature edges
+    ISR_YAW_REF,         // GPIOC yaw reference
+    ISR_SYSTICK,
+    ISR_ADC,             // ADC0 sequence 3
+    ISR_MODE_SW,         // GPIOA SW1
+    ISR_UART,            // UART0 transmit
+    ISR_BUTTONS,         // GPIOE/D/F buttons (probed on GPIOE)
+    NUM_ISRS
+} IsrId;
+
+typedef struct {
+    uint32_t latencyMax;     // Worst entry latency seen (cycles)
+    uint32_t durationMax;    // Worst time in the handler (cycles)
+    uint32_t count;          // Entries, probes included
+} IsrStats;
+
+extern volatile IsrStats isrStats[NUM_ISRS];
+
+#if ISR_STATS_ENABLED
+#define ISR_ENTER(id)   uint32_t isrEntry = IsrEnter(id)
+#define ISR_EXIT(id)    IsrExit((id), isrEntry)
+#define ISR_PROBE()     IsrProbe()
+#else
+#define ISR_ENTER(id)
+#define ISR_EXIT(id)
+#define ISR_PROBE()
+#endif
+
+//*****************************************************************************
+// Called first in a handler. Records the entry latency if it is known and
+// returns the entry timestamp for IsrExit.
+uint32_t IsrEnter(IsrId id);
+
+//*****************************************************************************
+// Called last in a handler with the timestamp IsrEnter returned.
+void IsrExit(IsrId id, uint32_t entry);
+
+//*****************************************************************************
+// Called from the SysTick handler. Every ISR_PROBE_DIVIDER calls it pends the
+// next probed interrupt in turn, noting the time.
+void IsrProbe(void);
+
+#endif /* ISRSTATS_H_ */
@@ -24,53 +24,199 @@
 #include "uart.h"
 #include "driverlib/sysctl.h"
 #include "driverlib/gpio.h"
+#include "driverlib/cpu.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/systick.h"
 #include "inc/hw_memmap.h"
 #include "kernel.h"
+#include "recorder.h"
+#include "events.h"
+#include "watchdog.h"
+#include "plan.h"
+#include "retain.h"
+#include "trace.h"
+#include "snapshot.h"
+
+//*****************************************************************************
+// CPU load measurement
+//*****************************************************************************
+static uint32_t idleCycles = 0;        // Cycles asleep this window
+static uint32_t loadWindowStart = 0;   // sysTickCount at the start of the window
+static uint16_t cpuLoad = 0;           // Utilisation of the last window (0.1%)
+
+//*****************************************************************************
+// Sleeps the processor until the next interrupt when no event is queued.
+// Interrupts are masked while the queue is checked so an ISR cannot post
+// between the check and the WFI; a pending interrupt still
+// wakes the core while masked and is serviced once they are re-enabled.
+// The time asleep is taken from the timestamp, which runs on in sleep.
+// Once a second of ticks has passed the idle time is turned into a load.
+//*****************************************************************************
+void
+KernelIdle(void)
+{
+    IntMasterDisable();
+    if (!EventPending())
+    {
+        uint32_t before = GetTimestamp();
+        TRACE_BEGIN(TRACE_IDLE);
+        CPUwfi();
+        TRACE_END(TRACE_IDLE);   // On waking, before the ISR that woke it runs at IntMasterEnable
+        idleCycles += GetTimestamp() - before;
+    }
+    IntMasterEnable();
+
+    if (sysTickCount - loadWindowStart >= SYSTICK_RATE_HZ)
+    {
+        uint32_t windowCycles = (sysTickCount - loadWindowStart) * SysTickPeriodGet();
+        if (idleCycles > windowCycles)
+        {
+            // The window is whole ticks, but a sleep begun before it started
+            // is counted whole, so the idle time can run up to a tick over
+            idleCycles = windowCycles;
+        }
+        cpuLoad = 1000 - (uint16_t)(((uint64_t)idleCycles * 1000) / windowCycles);
+        idleCycles = 0;
+        loadWindowStart = sysTickCount;
+    }
+}
+
+//*****************************************************************************
+// Returns the CPU utilisation over the last second in tenths of a percent.
+//*****************************************************************************
+uint16_t
+GetCPULoad(void)
+{
+    return cpuLoad;
+}
+
+//*****************************************************************************
+// Runs the work due on one SysTick: polls the reset switch, updates the
+// controller (applying the duties if asked) and checks it met its deadline,
+// then publishes the state for reporting (see snapshot.h) and runs the tick
+// based background tasks and the display.
+//*****************************************************************************
+static void
+KernelTick(Helicopter* heli, bool applyPWM, uint32_t tickTimestamp)
+{
+    ResetFlag = (GPIOPinRead(SW_PORT, SW2_PIN));  // Flag to track system reset switch
+#if RECORD_ENABLED
+    static uint8_t prevResetFlag = 0;
+    if (ResetFlag != prevResetFlag)
+    {
+        prevResetFlag = ResetFlag;
+        RECORD(REC_SWITCHES, (GPIOPinRead(SW_PORT, SW1_PIN) != 0) | ((ResetFlag != 0) << 1));
+    }
+#endif
+    if (ResetFlag != 0)
+    {
+        RetainSave(heli);   // Restored after the reset, see retain.c
+        SysCtlReset();
+    }
+
+    TRACE_BEGIN(TRACE_CONTROLLER);
+    PlanStep(heli);   // Setpoints from the flight plan, if one is running
+    ControllerImplementation(heli);
+    if (applyPWM)
+    {
+        SetPWM(heli->mainrotor);   // Apply the new duties once per tick
+        SetPWM(heli->tailrotor);
+    }
+    TRACE_END(TRACE_CONTROLLER);
+    DeadlineCheck(tickTimestamp);   // Services the watchdog if on time
+    SnapshotPublish(heli);   // What the display and telemetry report
+    TRACE_BEGIN(TRACE_TASKS);
+    SysTick(heli);
+    TRACE_END(TRACE_TASKS);
+    if (slowTick)  // Slowtick dictates display update frequency
+    {
+        TRACE_BEGIN(TRACE_DISPLAY);
+        DisplayProject(heli);
+        TRACE_END(TRACE_DISPLAY);
+    }
+}
+
+//*****************************************************************************
+// Drains the event queue in the order the ISRs posted it. Every tick runs the
+// controller once, every quadrature edge is decoded from the pin state the
+// ISR captured, reference edges are paired into the slot centre, and mode
+// switch events latch ChangeMode for the calling loop to act on.
+//*****************************************************************************
+void
+ServiceEvents(Helicopter* heli, bool applyPWM)
+{
+    Event event;
+
+    while (EventGet(&event))
+    {
+        switch (event.type)
+        {
+        case EVENT_TICK:
+            TRACE_BEGIN(TRACE_KERNEL_TICK);
+            KernelTick(heli, applyPWM, event.timestamp);
+            TRACE_END(TRACE_KERNEL_TICK);
+            break;
+        case EVENT_YAW_EDGE:
+            ExecuteYawInt(heli, event.value);
+            break;
+        case EVENT_YAW_REF:
+            YawRefEdge(heli, event.value);   // Raises YawRefFlag once the slot centre is known
+            break;
+        case EVENT_MODE_SWITCH:
+            ChangeMode = 1;
+            break;
+        default:
+            break;
+        }
+    }
+}
 
 //*****************************************************************************
 // The kernel runs the main helicopter embedded system. When a change mode is
 // triggered the Kernel calls a respective Mode function where user
 // inputs are enabled, halting the kernel. Upon returning to normal 'FLY'
-// submode the kernels normal operations continue.
+// submode the kernels normal operations continue. Repeated controller
+// overruns take the helicopter down through ModeSafeDescent. With nothing
+// left to do the kernel sleeps until the next interrupt rather than spinning.
 //*****************************************************************************
 void
 Run_Kernel(Helicopter* heli)
 {
     while (1)
     {
-        ResetFlag = (GPIOPinRead(SW_PORT, SW2_PIN));  // Flag to track system reset switch
+#if RECORD_ENABLED
+        if (heli->submode == LANDED)
+        {
+            RecorderDump();   // Sends the frozen recording, if any, while landed
+        }
+#endif
         if (heli->mode == USER_ENABLED)
         {
             AdjustHeli(heli);  // Allows user to interact with helicopter via buttons.
         }
+        TRACE_BEGIN(TRACE_COMMANDS);
+        PlanService(heli);     // Flight plan commands and reports over UART
+        TRACE_END(TRACE_COMMANDS);
+#if TRACE_ENABLED
+        TraceDump();           // Sends a finished trace capture, if any
+#endif
 
-        if (DeltaTFlag)  // Systick determined flag, relating to time change (delta T) of controller.
+        // Ticks, yaw edges and switch events queued by the ISRs. Duties are only
+        // applied while flying, the rotors stay stopped when landed.
+        ServiceEvents(heli, heli->mode == USER_ENABLED);
+
+        if (deadlineFault && heli->submode != LANDED)   // Controller repeatedly overran
         {
-            DeltaTFlag = 0;
-            ControllerImplementation(heli);
-            SysTick(heli);
-            if (slowTick)  // Slowtick dictates display update frequency
-            {
-                DisplayProject(heli);
-            }
+            ModeSafeDescent(heli);
         }
 
         if (ChangeMode)   // Mode Change detected
         {
             ChangeMode = 0;
-            SysCtlDelay(300);   // Debouncing timer for switch so correct state is Read
+            SysCtlDelay(DELAY_US(SWITCH_SETTLE_US));   // Debouncing timer for switch so correct state is Read
             ExecuteHelicopterMode(heli);
         }
 
-        if (YawIntFlag)   // Yaw Change detected
-        {
-            YawIntFlag = 0;
-            ExecuteYawInt(heli);
-        }
-
-        if (ResetFlag != 0)
-        {
-            SysCtlReset();
-        }
+        KernelIdle();
     }
 }
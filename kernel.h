@@ -25,4 +25,23 @@
 //*****************************************************************************
 void Run_Kernel(Helicopter* heli);
 
+//*****************************************************************************
+// Drains the ISR event queue: runs the controller and tick tasks for every
+// tick (applying the rotor duties if applyPWM), decodes every yaw and
+// reference edge and latches ChangeMode. Used by the kernel and the blocking
+// mode loops alike.
+//*****************************************************************************
+void ServiceEvents(Helicopter* heli, bool applyPWM);
+
+//*****************************************************************************
+// Sleeps the processor (WFI) until the next interrupt when no event is
+// queued, accumulating the time spent asleep for the CPU load figure.
+//*****************************************************************************
+void KernelIdle(void);
+
+//*****************************************************************************
+// Returns the CPU utilisation over the last second in tenths of a percent.
+//*****************************************************************************
+uint16_t GetCPULoad(void);
+
 #endif /* KERNEL_H_ */
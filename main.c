@@ -26,18 +26,27 @@
 #include "driverlib/gpio.h"
 #include "inc/hw_memmap.h"
 #include "kernel.h"
+#include "bench.h"
+#include "watchdog.h"
+#include "memstats.h"
 
 //********************************************************************************
 // Main Function of Helicopter. Creates the helicopter struct and initialises all
 // peripherals, including but not limited to, Clock, ADC and Buffer.
-// Runs the kernel to implement task management.
+// Runs the kernel to implement task management. The watchdog is started last,
+// once the controller is being serviced every tick.
 //********************************************************************************
 int
 main(void)
 {
+    MemPaintStack();   // Before anything deeper than main uses the stack
     Helicopter* heli = NewHeli();
     initHelicopter(heli);
     ChangeMode = 0;
+#if BENCHMARK_ENABLED
+    RunBenchmarks(heli);
+#endif
+    initWatchdog();
 
     while(1)
     {
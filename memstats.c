@@ -0,0 +1,118 @@
+//*******************************************************************************
+// memstats.c
+//
+// SRAM usage. The stack is painted with a pattern at boot and the deepest
+// word overwritten since is found once a second, giving the stack high-water
+// mark. Heap allocations are counted as they are made, and the static data
+// (.data and .bss) and the section sizes are taken from linker symbols.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "memstats.h"
+
+static uint32_t heapUsed = 0;
+
+#if MEM_STATS_ENABLED
+// Bytes from start up to end.
+#define MEM_SPAN(start, end)   ((uint32_t)((const char*)(end) - (const char*)(start)))
+
+#if defined(__TI_COMPILER_VERSION__)
+// The sizes are the addresses of absolute symbols.
+extern uint32_t __stack, __STACK_END, __STACK_SIZE, __SYSMEM_SIZE;
+#define MEM_STACK_BOTTOM   (&__stack)
+#define MEM_STACK_TOP      (&__STACK_END)
+#define MEM_STACK_SIZE     ((uint32_t)(uintptr_t)&__STACK_SIZE)
+#define MEM_HEAP_SIZE      ((uint32_t)(uintptr_t)&__SYSMEM_SIZE)
+#define MEM_STATIC_SIZE    0
+#else
+extern uint32_t __data_start__, __data_end__;
+extern uint32_t __bss_start__, __bss_end__;
+extern uint32_t __HeapBase, __HeapLimit;
+extern uint32_t __StackLimit, __StackTop;
+#define MEM_STACK_BOTTOM   (&__StackLimit)
+#define MEM_STACK_TOP      (&__StackTop)
+#define MEM_STACK_SIZE     MEM_SPAN(&__StackLimit, &__StackTop)
+#define MEM_HEAP_SIZE      MEM_SPAN(&__HeapBase, &__HeapLimit)
+#define MEM_STATIC_SIZE    (MEM_SPAN(&__data_start__, &__data_end__) \
+                            + MEM_SPAN(&__bss_start__, &__bss_end__))
+#endif
+
+//*****************************************************************************
+// Paints from the bottom of the stack to MEM_PAINT_MARGIN words below this
+// function's frame. The stack grows down, so everything painted is unused.
+//*****************************************************************************
+void
+MemPaintStack(void)
+{
+    volatile uint32_t marker;
+    uint32_t* word = MEM_STACK_BOTTOM;
+    uint32_t* end = (uint32_t*)&marker - MEM_PAINT_MARGIN;
+
+    while (word < end)
+    {
+        *word++ = MEM_STACK_PAINT;
+    }
+}
+
+//*****************************************************************************
+// Fills stats. The high-water mark is where the paint first stops, counting
+// up from the bottom of the stack.
+//*****************************************************************************
+void
+MemGetStats(MemStats* stats)
+{
+    uint32_t* word = MEM_STACK_BOTTOM;
+
+    while (word < MEM_STACK_TOP && *word == MEM_STACK_PAINT)
+    {
+        word++;
+    }
+    stats->stackSize = MEM_STACK_SIZE;
+    stats->stackUsed = MEM_SPAN(word, MEM_STACK_TOP);
+    stats->stackOverflow = (*MEM_STACK_BOTTOM != MEM_STACK_PAINT);
+    stats->heapSize = MEM_HEAP_SIZE;
+    stats->heapUsed = heapUsed;
+    stats->staticSize = MEM_STATIC_SIZE;
+}
+#else
+void
+MemPaintStack(void)
+{
+}
+
+//*****************************************************************************
+// Only the heap use is known without the linker symbols.
+//*****************************************************************************
+void
+MemGetStats(MemStats* stats)
+{
+    stats->stackSize = 0;
+    stats->stackUsed = 0;
+    stats->stackOverflow = false;
+    stats->heapSize = 0;
+    stats->heapUsed = heapUsed;
+    stats->staticSize = 0;
+}
+#endif
+
+//*****************************************************************************
+// calloc, counting the bytes allocated. The allocator's own overhead per
+// block is not included.
+//*****************************************************************************
+void*
+MemCalloc(size_t count, size_t size)
+{
+    void* block = calloc(count, size);
+
+    if (block != NULL)
+    {
+        heapUsed += count * size;
+    }
+    return block;
+}
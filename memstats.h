@@ -0,0 +1,65 @@
+#ifndef MEMSTATS_H_
+#define MEMSTATS_H_
+
+//*******************************************************************************
+// memstats.c
+//
+// SRAM usage. The stack is painted with a pattern at boot and the deepest
+// word overwritten since is found once a second, giving the stack high-water
+// mark. Heap allocations are counted as they are made, and the static data
+// (.data and .bss) and the section sizes are taken from linker symbols. All
+// of it is reported on the "Diag Mem" telemetry line. The flash and RAM used
+// by each module are summarised from the map file by tools/mapsummary.py.
+//
+// With the TI compiler the symbols the TI linker always defines are used:
+// __stack and __STACK_END around the stack, and __STACK_SIZE and
+// __SYSMEM_SIZE, the stack and heap sizes. It has none for .data and .bss,
+// so the static size is not known there. Other builds need the symbols of
+// the CMSIS GCC linker script (__StackLimit, __StackTop, __HeapBase,
+// __HeapLimit, __data_start__, __data_end__, __bss_start__, __bss_end__)
+// and set MEM_STATS_ENABLED where the link has them. The SITL's host link
+// has no such sections, so it reports the heap only.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+#if defined(__TI_COMPILER_VERSION__)
+#define MEM_STATS_ENABLED   1             // From the TI linker's own symbols
+#else
+#define MEM_STATS_ENABLED   0             // Set to 1 if linked with the CMSIS symbols
+#endif
+#define MEM_SRAM_SIZE       (32 * 1024)   // TM4C123GH6PM
+#define MEM_STACK_PAINT     0xDEADBEEF
+#define MEM_PAINT_MARGIN    32            // Words left unpainted below the caller
+
+typedef struct {
+    uint32_t stackSize;
+    uint32_t stackUsed;      // High-water mark
+    uint32_t heapSize;
+    uint32_t heapUsed;       // Bytes requested through MemCalloc
+    uint32_t staticSize;     // .data and .bss, 0 if not known
+    bool stackOverflow;      // The lowest stack word has been overwritten
+} MemStats;
+
+//*****************************************************************************
+// Paints the unused stack below the caller. Call first thing in main.
+void MemPaintStack(void);
+
+//*****************************************************************************
+// calloc, counting the bytes allocated for MemGetStats.
+void* MemCalloc(size_t count, size_t size);
+
+//*****************************************************************************
+// Fills stats, scanning the stack for its high-water mark.
+void MemGetStats(MemStats* stats);
+
+#endif /* MEMSTATS_H_ */
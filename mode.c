@@ -34,8 +34,16 @@
 #include "uart.h"
 #include "rotors.h"
 #include "mode.h"
+#include "kernel.h"
+#include "recorder.h"
+#include "events.h"
+#include "watchdog.h"
+#include "isrstats.h"
+#include "plan.h"
+#include "retain.h"
+#include "trace.h"
 
-//Interrupts to drive modes
+//Flags to drive modes, ChangeMode is latched by the kernel from EVENT_MODE_SWITCH
 volatile uint8_t ChangeMode = 0;
 volatile uint8_t EnableLanding = 0;
 
@@ -68,14 +76,23 @@ initSWS(void)
 
 //*****************************************************************************
 // Interrupt to manage helicopter modes
-// The interrupt handler that triggers the 'changemode' flag, which then
-// does 'executehelicopterMode(Helicopter* heli)' to actually change the mode.
+// The interrupt handler posts EVENT_MODE_SWITCH, from which the kernel sets
+// the 'changemode' flag and does 'executehelicopterMode(Helicopter* heli)'
+// to actually change the mode.
 //*****************************************************************************
-void
+RAMFUNC void
 ModeSWTickIntHandler(void) // very short function, to minimise the chance of data problems
 {
-    ChangeMode = 1; // if reset with SW1 in takeoff positon, do not takeoff until switch reswitched into on position
-    GPIOIntClear(SW_PORT, SW1_PIN);
+    ISR_ENTER(ISR_MODE_SW);
+    uint32_t status = GPIOIntStatus(SW_PORT, true);
+    if (status & SW1_PIN)   // Not set for a latency probe
+    {
+        uint8_t level = (GPIOPinRead(SW_PORT, SW1_PIN) != 0);
+        RECORD(REC_SWITCHES, level | ((GPIOPinRead(SW_PORT, SW2_PIN) != 0) << 1));
+        EventPost(EVENT_MODE_SWITCH, level); // if reset with SW1 in takeoff positon, do not takeoff until switch reswitched into on position
+    }
+    GPIOIntClear(SW_PORT, status);
+    ISR_EXIT(ISR_MODE_SW);
 }
 
 //*****************************************************************************
@@ -83,14 +100,15 @@ ModeSWTickIntHandler(void) // very short function, to minimise the chance of dat
 // between TAKEOFF, LANDING and FLY. There was difficulty in initializing two
 // interrupts (SW1 Mode and SW2 Reset) on the same GPIO port base, and SW2 was
 // heavily embedded into the existing program, so SW1 reset was changed to a
-// polling based interrupt.
+// polling based interrupt. Takeoff is refused once a deadline fault has
+// been latched.
 // ****************************************************************************
 void
 ExecuteHelicopterMode(Helicopter* heli)
 {
     // Check if SW1 switch is pressed (high state)
     uint8_t state = GPIOPinRead(SW_PORT, SW1_PIN);
-    if (state) {
+    if (state && !deadlineFault) {
         ModeTakeoff(heli);
         EnableLanding = true;  //enable a landing procedure only after taking off
     } else {
@@ -99,46 +117,62 @@ ExecuteHelicopterMode(Helicopter* heli)
 }
 
 //*****************************************************************************
-// With mode in 'USER_DISABLED' state, this function rotates at a slow constant
-// speed looking for a YawRefFlag to signify the reference position. Depending
-// on if coming from LANDED or FLY states, LocatePivot may take a shortest path
-// if the yawanglesetpoint was initially set.
+// With mode in 'USER_DISABLED' state, this function rotates looking for a
+// YawRefFlag, raised once both edges of the reference slot have been
+// crossed and its centre measured. After a cold start nothing is known, so
+// it creeps one way at LOCATE_CREEP_COUNTS. Once the reference has been
+// seen, it turns the shortest way towards where it was last seen at up to
+// LOCATE_FAST_COUNTS, through the slot and on by YAW_REF_OVERSHOOT, then
+// creeps onwards if the slot was not where expected. The yaw frame is then
+// re-zeroed on the slot centre. Gives up, leaving the yaw reference unset,
+// on a deadline fault.
 // ****************************************************************************
 void LocatePivot(Helicopter* heli)
 {
+    Controller* controller = heli->controller;
+    int32_t direction = 1;
+    int32_t target = 0;
+
+    if (yawRefKnown)
+    {
+        direction = (YawError(yawRefOffset, controller->curr_yawangle_reading) < 0) ? -1 : 1;
+        target = yawRefOffset + direction * YAW_REF_OVERSHOOT;
+    }
+
     YawRefFlag = 0;  // Resets state to locate reference
-    // Increase tail rotor speed to trigger slow rotation to find pivot
-    while(!YawRefFlag) {
-        if (DeltaTFlag)
+    while(!YawRefFlag && !deadlineFault) {
+        int32_t step = LOCATE_CREEP_COUNTS;
+        if (yawRefKnown)
         {
-            ResetFlag = (GPIOPinRead(SW_PORT, SW2_PIN));
-            DeltaTFlag = 0;
-            SysTick(heli);
-            if (slowTick)
+            int32_t remaining = direction * YawError(target, controller->curr_yawangle_reading);
+            if (remaining > LOCATE_FAST_COUNTS)
             {
-                DisplayProject(heli);
+                step = LOCATE_FAST_COUNTS;
+            }
+            else if (remaining > LOCATE_CREEP_COUNTS)
+            {
+                step = remaining;
             }
-
-            heli->controller->yawanglesetpoint = heli->controller->curr_yawangle_reading + 10;       //move the setpoint at a constant rate from the current reading, to trigger controls to converge or move
-                                                                                                     //towards the reference yaw position.
-            ControllerImplementation(heli);
-            SetPWM(heli->mainrotor);   // Updates main rotor PWM
-            SetPWM(heli->tailrotor);   // Updates tail rotor PWM
-        }
-        if (YawIntFlag)
-        {
-            YawIntFlag = 0;
-            ExecuteYawInt(heli);
         }
-        if (ResetFlag != 0)
+        controller->yawanglesetpoint = controller->curr_yawangle_reading + direction * step;   //move the setpoint ahead of the current reading, to trigger controls to converge or move
+                                                                                                //towards the reference yaw position.
+        ServiceEvents(heli, true);   // Controller and rotor updates per tick
+        if (!YawRefFlag)
         {
-            SysCtlReset();
+            KernelIdle();
         }
     }
+    if (deadlineFault)
+    {
+        return;
+    }
     YawRefFlag = 0;
-    heli->controller->yawanglesetpoint = 0;   // Set sets setpoint to be zero at reference
-    heli->controller->curr_yawangle_reading = 0;  //once the reference position is found, trigger current reading and yaw set point to 0 so that controls maintain this value.
-
+    ShiftYawFrame(heli, yawRefCentre);   // The slot centre becomes zero
+    yawRefOffset = 0;
+    yawRefKnown = true;
+    RetainSave(heli);
+    controller->yawanglesetpoint = 0;   // Set sets setpoint to be zero at reference
+    controller->yaw_increment = 0;
 }
 
 //*****************************************************************************
@@ -151,6 +185,7 @@ void LocatePivot(Helicopter* heli)
 //*****************************************************************************
 void ModeLand(Helicopter* heli)
 {
+    PlanAbort();
     heli->submode = LANDED;
     if (EnableLanding) // go through landing procedure
     {
@@ -158,34 +193,18 @@ void ModeLand(Helicopter* heli)
         heli->controller->altitudesetpoint = 5;
         while (heli->controller->curr_altitude_reading > heli->controller->altitudesetpoint) // Check landing altitude has been achieved
         {
-            ResetFlag = (GPIOPinRead(SW_PORT, SW2_PIN));
-            if (DeltaTFlag)
-            {
-                DeltaTFlag = 0;
-                ControllerImplementation(heli);
-                SysTick(heli);
-                if (slowTick)
-                {
-                    DisplayProject(heli);
-                }
-            }
-            if (YawIntFlag)
-            {
-                YawIntFlag = 0;
-                ExecuteYawInt(heli);
-            }
-            if (ResetFlag != 0)
-            {
-                SysCtlReset();
-            }
-            SetPWM(heli->mainrotor);
-            SetPWM(heli->tailrotor);
+            ServiceEvents(heli, true);   // Controller and rotor updates per tick
+            KernelIdle();
         }
         LocatePivot(heli);
         EnableLanding = false;  // cannot undergo landing procedure when landed.
+#if RECORD_ENABLED
+        RecorderFreeze();       // Dump the flight just completed while landed
+#endif
     }
 
     StopRotors(heli);           //already landed, so stay in reset state
+    HoverDutySave();            // Keep what was learned in flight
 }
 
 //*****************************************************************************
@@ -196,42 +215,44 @@ void ModeLand(Helicopter* heli)
 // ModeTakeoff is only enabled from a 'LANDED' mode state. The helicopter is
 // risen to 5% altitude and goes through 'locatepivot' to find the reference
 // yaw position. It then rises to 10% altitude and user buttons are enabled
-// via 'USER_ENABLED'.
+// via 'USER_ENABLED'. The time to FLY, and the part spent finding the
+// reference, are reported over UART. A deadline fault abandons the takeoff,
+// leaving the kernel to run ModeSafeDescent.
 //*****************************************************************************
 void ModeTakeoff(Helicopter* heli)
 {
+    uint32_t startTick = sysTickCount;
+    uint32_t pivotTick;
+    char report[48];
+
     heli->submode = TAKEOFF;
+#if TRACE_ENABLED
+    TraceStart();   // Capture the takeoff, sent once the buffer fills
+#endif
 
     heli->controller->altitudesetpoint = 5;
 
-    while (heli->controller->curr_altitude_reading < heli->controller->altitudesetpoint) // Check takeoff altitude has been achieved
+    while (heli->controller->curr_altitude_reading < heli->controller->altitudesetpoint && !deadlineFault) // Check takeoff altitude has been achieved
     {
-        ResetFlag = (GPIOPinRead(SW_PORT, SW2_PIN));
-        if (DeltaTFlag)
-        {
-            DeltaTFlag = 0;
-            ControllerImplementation(heli);
-            SysTick(heli);
-            if (slowTick)
-            {
-                DisplayProject(heli);
-            }
-        }
-        if (YawIntFlag)
-        {
-            YawIntFlag = 0;
-            ExecuteYawInt(heli);
-        }
-        if (ResetFlag != 0)
-        {
-            SysCtlReset();
-        }
-        SetPWM(heli->mainrotor);
-        SetPWM(heli->tailrotor);
+        ServiceEvents(heli, true);   // Controller and rotor updates per tick
+        KernelIdle();
+    }
+    pivotTick = sysTickCount;
+    if (!deadlineFault)
+    {
+        LocatePivot(heli);
+    }
+    if (deadlineFault)
+    {
+        return;
     }
-    LocatePivot(heli);
     ModeFly(heli);    //then initiate ModeFly to enable push buttons
     heli->controller->altitudesetpoint = 10;
+
+    usnprintf(report, sizeof(report), "Takeoff (ms): %d, pivot (ms): %d\r\n",
+              (sysTickCount - startTick) * 1000 / SYSTICK_RATE_HZ,
+              (sysTickCount - pivotTick) * 1000 / SYSTICK_RATE_HZ);
+    UARTSend(report);
 }
 
 //*****************************************************************************
@@ -245,6 +266,63 @@ void ModeFly(Helicopter* heli)
     heli->submode = FLY;   // Track user mode as 'FLY'
 }
 
+//*****************************************************************************
+// Entered from the kernel when deadlineFault is raised while off the ground.
+// User input is disabled, the heading is held and the altitude setpoint is
+// walked down at SAFE_DESCENT_RATE (%/s) from wherever the helicopter is.
+// Once at 0% the rotors are stopped when the altitude reads ground level, or
+// after SAFE_DESCENT_SETTLE_MS regardless. The controller still runs every
+// tick, so if it can no longer meet any deadline the watchdog resets the
+// processor instead, which also stops the rotors.
+//*****************************************************************************
+void ModeSafeDescent(Helicopter* heli)
+{
+    Controller* controller = heli->controller;
+    uint32_t stepTick = sysTickCount;
+    uint32_t zeroTick = sysTickCount;
+
+    PlanAbort();
+    heli->mode = USER_DISABLED;
+    controller->yawanglesetpoint = controller->curr_yawangle_reading;   // Hold heading
+    controller->yaw_increment = YawCountsToDegrees(YawWrap(controller->curr_yawangle_reading));
+    if (controller->altitudesetpoint > controller->curr_altitude_reading)
+    {
+        controller->altitudesetpoint = controller->curr_altitude_reading;   // Never climb
+    }
+    if (controller->altitudesetpoint < 0)
+    {
+        controller->altitudesetpoint = 0;
+    }
+
+    while (1)
+    {
+        ServiceEvents(heli, true);   // Controller and rotor updates per tick
+
+        if (sysTickCount - stepTick >= SAFE_DESCENT_STEP_TICKS && controller->altitudesetpoint > 0)
+        {
+            stepTick += SAFE_DESCENT_STEP_TICKS;
+            controller->altitudesetpoint--;
+            if (controller->altitudesetpoint == 0)
+            {
+                zeroTick = sysTickCount;
+            }
+        }
+        if (controller->altitudesetpoint == 0)
+        {
+            if (controller->curr_altitude_reading <= SAFE_DESCENT_GROUND
+                || sysTickCount - zeroTick >= SAFE_DESCENT_SETTLE_TICKS)
+            {
+                break;
+            }
+        }
+        KernelIdle();
+    }
+
+    heli->submode = LANDED;
+    EnableLanding = false;
+    StopRotors(heli);
+}
+
 //*****************************************************************************
 // Sets the main rotor and tail rotor duty cycles to be 0%. It then uses
 // setPWM to transfer these duty's to the periherals.
@@ -17,7 +17,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-//Interrupts to drive modes
+//Flags to drive modes, ChangeMode is latched by the kernel from EVENT_MODE_SWITCH
 extern volatile uint8_t ChangeMode;
 extern volatile uint8_t EnableLanding;
 
@@ -27,13 +27,28 @@ extern volatile uint8_t EnableLanding;
 #define SW2_PIN    GPIO_PIN_6
 #define SW_PORT   GPIO_PORTA_BASE
 
+// Reference search speeds (counts the setpoint is kept ahead of the reading)
+// before the reference has been seen and when heading for where it was, and
+// how far past its expected centre the fast search carries on.
+#define LOCATE_CREEP_COUNTS        10
+#define LOCATE_FAST_COUNTS         40
+#define YAW_REF_OVERSHOOT          (YAW_REF_MAX_WIDTH / 2 + 4)
+
+// Safe descent after a deadline fault: setpoint rate (%/s), the altitude (%)
+// taken as on the ground, and the longest wait at a 0% setpoint.
+#define SAFE_DESCENT_RATE          10
+#define SAFE_DESCENT_GROUND        2
+#define SAFE_DESCENT_SETTLE_MS     3000
+#define SAFE_DESCENT_STEP_TICKS    (SYSTICK_RATE_HZ / SAFE_DESCENT_RATE)
+#define SAFE_DESCENT_SETTLE_TICKS  (SYSTICK_RATE_HZ * SAFE_DESCENT_SETTLE_MS / 1000)
+
 //*****************************************************************************
 // Initialize peripherals SW1 & SW2 & interrupt on switch 1
 void initSWS(void);
 
 //*****************************************************************************
-// The interrupt handler that triggers the 'changemode' flag, which then
-// does 'executehelicopterMode(Helicopter* heli)'
+// The interrupt handler that posts EVENT_MODE_SWITCH, from which the kernel
+// raises the 'changemode' flag and does 'executehelicopterMode(Helicopter* heli)'
 void ModeSWTickIntHandler(void);
 
 //*****************************************************************************
@@ -42,10 +57,9 @@ void ModeSWTickIntHandler(void);
 void ExecuteHelicopterMode(Helicopter* heli);
 
 //*****************************************************************************
-// With mode in 'USER_DISABLED' state, this function rotates at a slow constant
-// speed looking for a YawRefFlag to signify the reference position. Depending
-// on if coming from LANDED or FLY states, LocatePivot may take a shortest path
-// if the yawanglesetpoint was initially set
+// With mode in 'USER_DISABLED' state, this function rotates looking for the
+// centre of the reference slot, the shortest way at LOCATE_FAST_COUNTS when
+// it has been seen before, and re-zeroes the yaw frame on it
 void LocatePivot(Helicopter* heli);
 
 //*****************************************************************************
@@ -67,6 +81,11 @@ void ModeTakeoff(Helicopter* heli);
 // yaw in 15degree steps with no limitations on rotation.
 void ModeFly(Helicopter* heli);
 
+//*****************************************************************************
+// Entered when deadlineFault is raised off the ground. Holds heading and
+// lowers the altitude setpoint at SAFE_DESCENT_RATE, then stops the rotors.
+void ModeSafeDescent(Helicopter* heli);
+
 //*****************************************************************************
 // Sets the main rotor and tail rotor duty cycles to be 0%. It then uses
 // setPWM to transfer these duty's to the periherals.
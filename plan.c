@@ -0,0 +1,416 @@
+//*******************************************************************************
+// plan.c
+//
+// Scripted flight plans. A plan is a list of waypoints (altitude, yaw, hold
+// time, ramp rate) uploaded over UART and kept in RAM. While flying, PLAN RUN
+// enters the PLAN submode, in which the setpoints are driven from the plan
+// once per tick instead of from the buttons, so every run of a plan is the
+// same. For each waypoint the time to arrive and the error while holding are
+// reported over UART.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "utils/ustdlib.h"
+#include "rotors.h"
+#include "system.h"
+#include "uart.h"
+#include "yaw.h"
+#include "plan.h"
+#include "altcal.h"
+#include "trace.h"
+
+//*****************************************************************************
+// Setpoints are ramped in millionths of a % and of a yaw state so slow rates
+// still move a little every tick.
+//*****************************************************************************
+#define PLAN_MICRO              1000000
+#define PLAN_ALT_STEP(rate)     ((rate) * (PLAN_MICRO / SYSTICK_RATE_HZ))
+#define PLAN_YAW_STEP(rate)     ((rate) * ((PLAN_MICRO / SYSTICK_RATE_HZ) * TOTAL_STATES / TOTAL_DEG))
+#define PLAN_TICKS(ms)          ((uint32_t)(ms) * SYSTICK_RATE_HZ / 1000)
+#define PLAN_MS(ticks)          ((int32_t)((ticks) * 1000 / SYSTICK_RATE_HZ))
+
+typedef struct {
+    int32_t arriveMs;        // -1 if the waypoint was not reached in time
+    int16_t altErr;          // Error at the end of the hold (%)
+    int16_t yawErr;          // Error at the end of the hold (degrees)
+    int16_t altErrMax;       // Largest error during the hold
+    int16_t yawErrMax;
+} PlanResult;
+
+typedef enum {
+    PLAN_REPORT_NONE = 0,
+    PLAN_REPORT_END,
+    PLAN_REPORT_ABORT
+} PlanReport;
+
+static Waypoint plan[PLAN_MAX_WAYPOINTS];
+static uint8_t planLength = 0;
+static PlanResult results[PLAN_MAX_WAYPOINTS];
+static uint8_t resultsDone = 0;      // Waypoints flown
+static uint8_t resultsSent = 0;      // Waypoint reports sent
+
+static bool planRunning = false;
+static uint8_t planIndex = 0;        // Waypoint being flown
+static uint32_t planTicks = 0;       // Ticks since PLAN RUN
+static uint32_t wpTicks = 0;         // Ticks since this waypoint started
+static uint32_t arriveTicks = 0;
+static bool arrived = false;
+static int32_t altMicro = 0;         // Ramped setpoints
+static int32_t yawMicro = 0;
+static int32_t yawTargetCounts = 0;  // Waypoint yaw, the nearest way round
+static PlanReport planReport = PLAN_REPORT_NONE;
+
+//*****************************************************************************
+// Moves value towards target by at most step, or straight to it if step is 0.
+//*****************************************************************************
+static int32_t
+Approach(int32_t value, int32_t target, int32_t step)
+{
+    if (step == 0)
+    {
+        return target;
+    }
+    if (value < target)
+    {
+        return (target - value > step) ? value + step : target;
+    }
+    return (value - target > step) ? value - step : target;
+}
+
+//*****************************************************************************
+// Divides by PLAN_MICRO, rounding to the nearest.
+//*****************************************************************************
+static int32_t
+FromMicro(int32_t value)
+{
+    return (value >= 0) ? (value + PLAN_MICRO / 2) / PLAN_MICRO
+                        : -((-value + PLAN_MICRO / 2) / PLAN_MICRO);
+}
+
+static int16_t
+Magnitude(int32_t value)
+{
+    return (int16_t)((value < 0) ? -value : value);
+}
+
+//*****************************************************************************
+// Starts flying plan[planIndex], ramping from the setpoints as they are.
+// The yaw target is placed the shortest way round from the setpoint, so the
+// ramp never turns more than half a revolution. The setpoint is wrapped to
+// within half a turn first, as the controller takes the error the shortest
+// way round anyway, so however far a plan has wound the ramp stays within a
+// turn either side of zero and its millionths well inside an int32_t.
+//*****************************************************************************
+static void
+StartWaypoint(Helicopter* heli)
+{
+    int32_t yawSetpoint = YawWrap(heli->controller->yawanglesetpoint);
+
+    altMicro = heli->controller->altitudesetpoint * PLAN_MICRO;
+    yawMicro = yawSetpoint * PLAN_MICRO;
+    yawTargetCounts = yawSetpoint + YawError(YawDegreesToCounts(plan[planIndex].yaw), yawSetpoint);
+    wpTicks = 0;
+    arrived = false;
+    results[planIndex].altErrMax = 0;
+    results[planIndex].yawErrMax = 0;
+}
+
+//*****************************************************************************
+// Reads a signed decimal number, skipping leading spaces. Returns false if
+// there is no number at *text or it does not end at a space or the end of the
+// line.
+//*****************************************************************************
+static bool
+ParseInt(const char** text, int32_t* value)
+{
+    const char* p = *text;
+    bool negative = false;
+    int32_t result = 0;
+
+    while (*p == ' ')
+    {
+        p++;
+    }
+    if (*p == '-')
+    {
+        negative = true;
+        p++;
+    }
+    if (*p < '0' || *p > '9')
+    {
+        return false;
+    }
+    while (*p >= '0' && *p <= '9' && result < 1000000)
+    {
+        result = result * 10 + (*p - '0');
+        p++;
+    }
+    if (*p != ' ' && *p != '\0')
+    {
+        return false;
+    }
+    *value = negative ? -result : result;
+    *text = p;
+    return true;
+}
+
+//*****************************************************************************
+// Returns true if only spaces are left at text.
+//*****************************************************************************
+static bool
+ParseEnd(const char* text)
+{
+    while (*text == ' ')
+    {
+        text++;
+    }
+    return *text == '\0';
+}
+
+//*****************************************************************************
+// Parses "WP <alt> <yaw> <hold> <rate>" and appends the waypoint.
+//*****************************************************************************
+static void
+PlanAddWaypoint(const char* args)
+{
+    int32_t alt, yaw, hold, rate;
+    char reply[32];
+
+    if (!ParseInt(&args, &alt) || !ParseInt(&args, &yaw) || !ParseInt(&args, &hold)
+        || !ParseInt(&args, &rate) || !ParseEnd(args))
+    {
+        UARTSend("ERR WP needs <alt> <yaw> <hold ms> <rate>\r\n");
+        return;
+    }
+    if (alt < 0 || alt > 100 || yaw < -180 || yaw > 180 || hold < 0 || hold > PLAN_MAX_HOLD_MS
+        || rate < 0 || rate > PLAN_MAX_RATE)
+    {
+        UARTSend("ERR WP out of range\r\n");
+        return;
+    }
+    if (planLength >= PLAN_MAX_WAYPOINTS)
+    {
+        UARTSend("ERR plan full\r\n");
+        return;
+    }
+
+    plan[planLength].altitude = (int16_t)alt;
+    plan[planLength].yaw = (int16_t)yaw;
+    plan[planLength].holdMs = (uint16_t)hold;
+    plan[planLength].rate = (uint16_t)rate;
+    planLength++;
+    usnprintf(reply, sizeof(reply), "OK WP %d\r\n", planLength - 1);
+    UARTSend(reply);
+}
+
+//*****************************************************************************
+// Acts on one command line.
+//*****************************************************************************
+static void
+PlanCommand(Helicopter* heli, const char* line)
+{
+    if (ustrncmp(line, "WP ", 3) == 0)
+    {
+        if (planRunning)
+        {
+            UARTSend("ERR plan running\r\n");
+            return;
+        }
+        PlanAddWaypoint(line + 3);
+    }
+    else if (ustrncmp(line, "PLAN CLEAR", 11) == 0)
+    {
+        if (planRunning)
+        {
+            UARTSend("ERR plan running\r\n");
+            return;
+        }
+        planLength = 0;
+        UARTSend("OK CLEAR\r\n");
+    }
+    else if (ustrncmp(line, "PLAN RUN", 9) == 0)
+    {
+        if (planLength == 0 || heli->submode != FLY || planRunning)
+        {
+            UARTSend("ERR RUN needs waypoints and FLY\r\n");
+            return;
+        }
+        planRunning = true;
+        planIndex = 0;
+        planTicks = 0;
+        resultsDone = 0;
+        resultsSent = 0;
+        planReport = PLAN_REPORT_NONE;
+        StartWaypoint(heli);
+        heli->submode = PLAN;   // Buttons are ignored until the plan ends
+        UARTSend("OK RUN\r\n");
+    }
+    else if (ustrncmp(line, "CAL", 3) == 0 && (line[3] == ' ' || line[3] == '\0'))
+    {
+        AltCalCommand(heli, line + 3);   // Altitude calibration, see altcal.h
+    }
+    else if (ustrncmp(line, "TRACE ", 6) == 0)
+    {
+        TraceCommand(line + 6);   // Execution trace capture, see trace.h
+    }
+    else if (ustrncmp(line, "PLAN ABORT", 11) == 0)
+    {
+        if (planRunning)
+        {
+            PlanAbort();
+            heli->submode = FLY;   // Setpoints held where the plan left them
+        }
+        UARTSend("OK ABORT\r\n");
+    }
+    else
+    {
+        UARTSend("ERR unknown command\r\n");
+    }
+}
+
+//*****************************************************************************
+// Takes any received command lines, then sends finished waypoint reports
+// and the closing line, each only when the transmit ring has room, so none
+// is lost to a busy link.
+//*****************************************************************************
+void
+PlanService(Helicopter* heli)
+{
+    static char line[UART_LINE_LEN + 1];
+    char report[48];
+
+    while (UARTReadLine(line))
+    {
+        PlanCommand(heli, line);
+    }
+
+    while (resultsSent < resultsDone)
+    {
+        PlanResult* result = &results[resultsSent];
+        usnprintf(report, sizeof(report), "P,%d,%d,%d,%d,%d,%d\r\n", resultsSent,
+                  result->arriveMs, result->altErr, result->yawErr,
+                  result->altErrMax, result->yawErrMax);
+        if (ustrlen(report) > UARTTxSpace())
+        {
+            return;
+        }
+        UARTSend(report);
+        resultsSent++;
+    }
+
+    if (planReport != PLAN_REPORT_NONE)
+    {
+        if (planReport == PLAN_REPORT_END)
+        {
+            usnprintf(report, sizeof(report), "P,END,%d\r\n", PLAN_MS(planTicks));
+        }
+        else
+        {
+            usnprintf(report, sizeof(report), "P,ABORT,%d\r\n", planIndex);
+        }
+        if (ustrlen(report) <= UARTTxSpace())
+        {
+            UARTSend(report);
+            planReport = PLAN_REPORT_NONE;
+        }
+    }
+}
+
+//*****************************************************************************
+// One tick of the plan. The setpoints ramp towards the waypoint; once the
+// ramp is done and both errors are within tolerance (or the arrival timeout
+// passes) the hold starts, during which the largest errors are kept. At the
+// end of the hold the result is stored and the next waypoint started. A
+// plan whose submode has been changed under it (landing) is aborted.
+//*****************************************************************************
+void
+PlanStep(Helicopter* heli)
+{
+    Controller* controller = heli->controller;
+    Waypoint* wp;
+    PlanResult* result;
+    int32_t altTarget, yawTarget, altErr, yawErr;
+
+    if (!planRunning)
+    {
+        return;
+    }
+    if (heli->submode != PLAN)
+    {
+        PlanAbort();
+        return;
+    }
+
+    wp = &plan[planIndex];
+    result = &results[planIndex];
+    planTicks++;
+    wpTicks++;
+
+    altTarget = wp->altitude * PLAN_MICRO;
+    yawTarget = yawTargetCounts * PLAN_MICRO;
+    altMicro = Approach(altMicro, altTarget, PLAN_ALT_STEP(wp->rate));
+    yawMicro = Approach(yawMicro, yawTarget, PLAN_YAW_STEP(wp->rate));
+    controller->altitudesetpoint = FromMicro(altMicro);
+    controller->yawanglesetpoint = FromMicro(yawMicro);
+    controller->yaw_increment = YawCountsToDegrees(YawWrap(controller->yawanglesetpoint));
+
+    altErr = wp->altitude - controller->curr_altitude_reading;
+    yawErr = YawCountsToDegrees(YawError(yawTargetCounts, controller->curr_yawangle_reading));
+
+    if (!arrived)
+    {
+        bool settled = (altMicro == altTarget) && (yawMicro == yawTarget)
+                       && Magnitude(altErr) <= PLAN_ALT_TOLERANCE && Magnitude(yawErr) <= PLAN_YAW_TOLERANCE;
+        if (settled || wpTicks >= PLAN_TICKS(PLAN_ARRIVE_TIMEOUT_MS))
+        {
+            arrived = true;
+            arriveTicks = wpTicks;
+            result->arriveMs = settled ? PLAN_MS(wpTicks) : -1;
+        }
+        return;
+    }
+
+    if (Magnitude(altErr) > result->altErrMax)
+    {
+        result->altErrMax = Magnitude(altErr);
+    }
+    if (Magnitude(yawErr) > result->yawErrMax)
+    {
+        result->yawErrMax = Magnitude(yawErr);
+    }
+
+    if (wpTicks - arriveTicks >= PLAN_TICKS(wp->holdMs))
+    {
+        result->altErr = (int16_t)altErr;
+        result->yawErr = (int16_t)yawErr;
+        resultsDone++;
+        if (++planIndex >= planLength)
+        {
+            planRunning = false;
+            planReport = PLAN_REPORT_END;
+            heli->submode = FLY;   // Buttons take over from the last setpoints
+        }
+        else
+        {
+            StartWaypoint(heli);
+        }
+    }
+}
+
+//*****************************************************************************
+// Stops the plan where it is; PlanService reports the waypoint it was on.
+//*****************************************************************************
+void
+PlanAbort(void)
+{
+    if (planRunning)
+    {
+        planRunning = false;
+        planReport = PLAN_REPORT_ABORT;
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef PLAN_H_
+#define PLAN_H_
+
+//*******************************************************************************
+// plan.c
+//
+// Scripted flight plans. A plan is a list of waypoints (altitude, yaw, hold
+// time, ramp rate) uploaded over UART and kept in RAM. While flying, PLAN RUN
+// enters the PLAN submode, in which the setpoints are driven from the plan
+// once per tick instead of from the buttons, so every run of a plan is the
+// same. For each waypoint the time to arrive and the error while holding are
+// reported over UART.
+//
+// Commands, one per line:
+//   WP <alt %> <yaw deg> <hold ms> <rate>   Append a waypoint
+//   PLAN CLEAR                              Remove all waypoints
+//   PLAN RUN                                Fly the plan (from FLY only)
+//   PLAN ABORT                              Stop, holding the current setpoints
+// Each is answered with an "OK ..." or "ERR ..." line. The rate is in %/s
+// for altitude and deg/s for yaw, 0 steps straight to the waypoint. "CAL"
+// lines are passed on to the altitude calibration, see altcal.h, and
+// "TRACE" lines to the execution trace, see trace.h.
+//
+// Reports, one line per waypoint once its hold ends:
+//   P,<index>,<arrival ms or -1>,<alt err %>,<yaw err deg>,<max alt err>,<max yaw err>
+// followed by "P,END,<total ms>", or "P,ABORT,<index>" if the plan is
+// stopped early.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rotors.h"
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+#define PLAN_MAX_WAYPOINTS      32
+#define PLAN_ALT_TOLERANCE      2        // Arrived within this many % ...
+#define PLAN_YAW_TOLERANCE      3        // ... and this many degrees
+#define PLAN_ARRIVE_TIMEOUT_MS  10000    // Hold starts anyway after this long
+#define PLAN_MAX_HOLD_MS        60000
+#define PLAN_MAX_RATE           100
+
+typedef struct {
+    int16_t altitude;        // Setpoint (%)
+    int16_t yaw;             // Setpoint (degrees from the reference, -180 to 180)
+    uint16_t holdMs;         // Time to hold after arriving
+    uint16_t rate;           // Ramp rate (%/s and deg/s), 0 for a step
+} Waypoint;
+
+//*****************************************************************************
+// Reads and acts on any command lines received over UART, and sends the
+// waypoint reports as transmit space allows. Called from the kernel loop.
+void PlanService(Helicopter* heli);
+
+//*****************************************************************************
+// Advances the running plan by one tick, updating the setpoints. Called by
+// the kernel every tick before the controller runs.
+void PlanStep(Helicopter* heli);
+
+//*****************************************************************************
+// Stops a running plan, reporting where it stopped. The submode is left to
+// the caller.
+void PlanAbort(void);
+
+#endif /* PLAN_H_ */
@@ -0,0 +1,105 @@
+//*******************************************************************************
+// recorder.c
+//
+// Flight recorder for the raw inputs of the helicopter: ADC samples, quadrature
+// pin states, the yaw reference, SW1/SW2 and button levels, plus every SysTick.
+// Each input is stored with a cycle timestamp in a RAM ring that holds the
+// most recent REC_BUF_SIZE records. When a landing completes the ring is
+// frozen and dumped over UART so a rig session can be reproduced offline
+// (see tools/recdump.py).
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driverlib/cpu.h"
+#include "utils/ustdlib.h"
+#include "rotors.h"
+#include "system.h"
+#include "uart.h"
+#include "recorder.h"
+
+//*****************************************************************************
+// Global Variables
+//*****************************************************************************
+static Record recBuf[REC_BUF_SIZE];
+static uint16_t recWrite = 0;              // Next slot to write
+static uint16_t recCount = 0;              // Number of valid records
+static volatile bool recFrozen = false;    // Set while the ring is dumped
+static uint32_t recDropped = 0;            // Inputs lost while frozen
+
+//*****************************************************************************
+// Stores one input in the ring, overwriting the oldest record. Interrupts are
+// masked for the few instructions it takes to claim a slot, as the kernel
+// records the buttons and SW2 while the ISRs record everything else.
+//*****************************************************************************
+void
+RecorderWrite(RecSource source, uint16_t value)
+{
+    uint32_t masked = CPUcpsid();
+
+    if (recFrozen)
+    {
+        recDropped++;
+    }
+    else
+    {
+        recBuf[recWrite].timestamp = GetTimestamp();
+        recBuf[recWrite].source = source;
+        recBuf[recWrite].value = value;
+        recWrite = (recWrite + 1) % REC_BUF_SIZE;
+        if (recCount < REC_BUF_SIZE)
+        {
+            recCount++;
+        }
+    }
+
+    if (!masked)
+    {
+        CPUcpsie();
+    }
+}
+
+//*****************************************************************************
+// Stops recording so the ring can be dumped with RecorderDump().
+//*****************************************************************************
+void
+RecorderFreeze(void)
+{
+    recFrozen = true;
+}
+
+//*****************************************************************************
+// Background task: sends the oldest frozen record as a text line of the form
+// "R,<timestamp>,<source>,<value>". One record is sent per call, and only
+// when the UART transmit ring has room for it. Once empty "R,END,<dropped>" is sent and recording
+// resumes.
+//*****************************************************************************
+void
+RecorderDump(void)
+{
+    char line[40];
+
+    if (!recFrozen || UARTTxSpace() < sizeof(line))
+    {
+        return;
+    }
+
+    if (recCount > 0)
+    {
+        Record* rec = &recBuf[(recWrite + REC_BUF_SIZE - recCount) % REC_BUF_SIZE];
+        usnprintf(line, sizeof(line), "R,%u,%u,%u\r\n",
+                  rec->timestamp, rec->source, rec->value);
+        recCount--;
+    }
+    else
+    {
+        usnprintf(line, sizeof(line), "R,END,%u\r\n", recDropped);
+        recDropped = 0;
+        recFrozen = false;
+    }
+    UARTSend(line);
+}
@@ -0,0 +1,68 @@
+#ifndef RECORDER_H_
+#define RECORDER_H_
+
+//*******************************************************************************
+// recorder.c
+//
+// Flight recorder for the raw inputs of the helicopter: ADC samples, quadrature
+// pin states, the yaw reference, SW1/SW2 and button levels, plus every SysTick.
+// Each input is stored with a cycle timestamp in a RAM ring that holds the
+// most recent REC_BUF_SIZE records. When a landing completes the ring is
+// frozen and dumped over UART so a rig session can be reproduced offline:
+// tools/recdump.py makes a CSV of it, which the SITL replays through the
+// firmware (sitl/sitl.c, --replay).
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+#define RECORD_ENABLED  0        // Set to 1 to record raw inputs
+#define REC_BUF_SIZE    1024     // Number of records held (8 bytes each)
+
+// Input sources stored in each record
+typedef enum {
+    REC_TICK = 0,      // SysTick interrupt, value unused
+    REC_ADC,           // Altitude ADC sample
+    REC_QUAD,          // Quadrature state, PB1:PB0
+    REC_YAW_REF,       // Yaw reference level on PC4
+    REC_SWITCHES,      // SW1 in bit 0, SW2 in bit 1
+    REC_BUTTONS        // Raw button levels, bit n is button n of butNames
+} RecSource;
+
+typedef struct {
+    uint32_t timestamp;  // GetTimestamp() when the input was captured
+    uint8_t source;      // RecSource
+    uint8_t reserved;
+    uint16_t value;
+} Record;
+
+// Hooks placed in the ISRs and polling functions, compiled out unless
+// RECORD_ENABLED is set.
+#if RECORD_ENABLED
+#define RECORD(source, value)   RecorderWrite((source), (value))
+#else
+#define RECORD(source, value)
+#endif
+
+//*****************************************************************************
+// Stores one input in the ring, overwriting the oldest record. Safe to call
+// from both interrupt and kernel context. Inputs are dropped while frozen.
+void RecorderWrite(RecSource source, uint16_t value);
+
+//*****************************************************************************
+// Stops recording so the ring can be dumped with RecorderDump().
+void RecorderFreeze(void);
+
+//*****************************************************************************
+// Background task: sends one frozen record over UART per call. Once the ring
+// is empty an end marker with the dropped count is sent and recording resumes.
+void RecorderDump(void);
+
+#endif /* RECORDER_H_ */
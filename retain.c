@@ -0,0 +1,106 @@
+//*******************************************************************************
+// retain.c
+//
+// State kept across warm resets. The altitude reference, the yaw reference
+// and the hover duty are copied into a block of RAM the startup code does
+// not clear, checked by a magic number, version and CRC.
+// After a software, watchdog or reset pin reset a valid block is restored,
+// so the rig is ready without waiting for the altitude buffer to fill. After
+// a power-on reset, or if the block fails its checks, everything starts from
+// the defaults as before.
+//
+// Only state measured or learned on the rig is kept. A reflash through the
+// debugger resets as a software reset, so anything fixed by the image, such
+// as the controller gains, would be overwritten with the old image's.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "driverlib/sysctl.h"
+#include "utils/ustdlib.h"
+#include "system.h"
+#include "rotors.h"
+#include "buffer.h"
+#include "yaw.h"
+#include "uart.h"
+#include "crc.h"
+#include "retain.h"
+
+static NOINIT RetainedState retained;
+
+uint32_t resetCause = 0;
+bool retainRestored = false;
+
+//*****************************************************************************
+// True if the block holds a complete save from this build's layout.
+//*****************************************************************************
+static bool
+RetainValid(void)
+{
+    return retained.magic == RETAIN_MAGIC && retained.version == RETAIN_VERSION
+           && retained.length == sizeof(RetainedState)
+           && retained.crc == Crc32(&retained, offsetof(RetainedState, crc));
+}
+
+//*****************************************************************************
+// Restores the retained block after a warm reset. The altitude buffer is
+// filled with the reference so the altitude reads zero until real samples
+// replace it. The yaw heading is only trusted after a software reset, which
+// saves it at the moment of reset while landed; the decoder restarted at zero
+// on the same heading, so the frame is shifted to put the reference at zero.
+//*****************************************************************************
+bool
+RetainRestore(Helicopter* heli)
+{
+    char report[64];
+    bool warm;
+
+    resetCause = SysCtlResetCauseGet();
+    SysCtlResetCauseClear(resetCause);
+    warm = !(resetCause & SYSCTL_CAUSE_POR)
+           && (resetCause & (SYSCTL_CAUSE_SW | SYSCTL_CAUSE_WDOG0 | SYSCTL_CAUSE_EXT));
+
+    retainRestored = warm && RetainValid();
+    if (retainRestored)
+    {
+        heli->buffer->refAltADC = retained.refAltADC;
+        BufferFill(retained.refAltADC);
+        hoverDuty = retained.hoverDuty;
+
+        if ((resetCause & SYSCTL_CAUSE_SW) && retained.yawValid)
+        {
+            ShiftYawFrame(heli, -retained.yawHeading);
+            yawRefOffset = 0;
+            yawRefKnown = true;
+        }
+    }
+
+    usnprintf(report, sizeof(report), "Boot: %s reset (cause 0x%02x), retained %s\r\n",
+              warm ? "warm" : "cold", resetCause,
+              retainRestored ? (yawRefKnown ? "alt+yaw" : "alt") : "none");
+    UARTSend(report);
+    return retainRestored;
+}
+
+//*****************************************************************************
+// Saves the current state. The yaw heading is marked valid only while the
+// rig is landed with the reference known, so it cannot have moved by the time
+// the processor comes back up.
+//*****************************************************************************
+void
+RetainSave(Helicopter* heli)
+{
+    retained.magic = RETAIN_MAGIC;
+    retained.version = RETAIN_VERSION;
+    retained.length = sizeof(RetainedState);
+    retained.refAltADC = heli->buffer->refAltADC;
+    retained.yawHeading = YawWrap(heli->controller->curr_yawangle_reading - yawRefOffset);
+    retained.yawValid = (heli->submode == LANDED && yawRefKnown);
+    retained.hoverDuty = hoverDuty;
+    retained.crc = Crc32(&retained, offsetof(RetainedState, crc));
+}
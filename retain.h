@@ -0,0 +1,63 @@
+#ifndef RETAIN_H_
+#define RETAIN_H_
+
+//*******************************************************************************
+// retain.c
+//
+// State kept across warm resets. The altitude reference, the yaw reference
+// and the hover duty are copied into a block of RAM the startup code does
+// not clear, checked by a magic number, version and CRC.
+// After a software, watchdog or reset pin reset a valid block is restored,
+// so the rig is ready without waiting for the altitude buffer to fill. After
+// a power-on reset, or if the block fails its checks, everything starts from
+// the defaults as before.
+//
+// Only state measured or learned on the rig is kept. A reflash through the
+// debugger resets as a software reset, so anything fixed by the image, such
+// as the controller gains, would be overwritten with the old image's.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rotors.h"
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+#define RETAIN_MAGIC        0x52544E31   // "RTN1"
+#define RETAIN_VERSION      2            // Bump when RetainedState changes
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;           // sizeof(RetainedState)
+    int32_t refAltADC;
+    int32_t yawHeading;        // Yaw from the reference (wrapped counts) when saved
+    uint32_t yawValid;         // Non-zero if yawHeading is still the rig's heading
+    int32_t hoverDuty;
+    uint32_t crc;              // CRC-32 of everything above
+} RetainedState;
+
+// The reset cause read at boot (SYSCTL_CAUSE_*) and whether the retained
+// state was restored from it.
+extern uint32_t resetCause;
+extern bool retainRestored;
+
+//*****************************************************************************
+// Reads and clears the reset cause and, on a warm reset with a valid block,
+// restores the retained state into heli. Call once the buffer, UART and yaw
+// decoder are initialised; interrupts may already be enabled, as the kernel
+// has not started. Returns true if the altitude reference was restored, so
+// initAlt can be skipped.
+bool RetainRestore(Helicopter* heli);
+
+//*****************************************************************************
+// Copies the current state into the retained block. Called periodically and
+// just before a software reset.
+void RetainSave(Helicopter* heli);
+
+#endif /* RETAIN_H_ */
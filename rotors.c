@@ -15,6 +15,7 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "inc/hw_memmap.h"
 #include "inc/hw_types.h"
 #include "inc/hw_ints.h"
@@ -26,6 +27,7 @@
 #include "driverlib/systick.h"
 #include "driverlib/sysctl.h"
 #include "driverlib/interrupt.h"
+#include "driverlib/eeprom.h"
 #include "buttons4.h"
 #include "utils/ustdlib.h"
 #include "OrbitOLED/OrbitOLEDInterface.h"
@@ -36,6 +38,65 @@
 #include "buffer.h"
 #include "circBufT.h"
 #include "system.h"
+#include "crc.h"
+
+// Register write statistics for SetPWM, counted since boot.
+uint32_t pwmSetCalls = 0;
+uint32_t pwmRegWrites = 0;
+
+// Controller updates run since boot, for the measured loop rate, and the
+// cycles they took (total since boot, worst since last cleared).
+uint32_t controllerRuns = 0;
+uint32_t controllerCycles = 0;
+uint32_t controllerCyclesMax = 0;
+
+// Main duty that holds a hover, added to the altitude PID output. It is
+// learned while flying (HoverLearn) and kept in EEPROM.
+int32_t hoverDuty = GRAVITY_FACTOR;
+int32_t hoverDutyStored = GRAVITY_FACTOR;
+uint32_t hoverLearns = 0;
+
+// Generator event that triggers the ADC for ADC_PWM_PHASE_PERCENT.
+#if ADC_PWM_PHASE_PERCENT == 0
+#define PWM_ADC_TRIG_EVENT  PWM_TR_CNT_ZERO
+#elif ADC_PWM_PHASE_PERCENT == 100
+#define PWM_ADC_TRIG_EVENT  PWM_TR_CNT_LOAD
+#else
+#define PWM_ADC_TRIG_EVENT  PWM_TR_CNT_AU
+#endif
+
+#define HOVER_STEADY_TICKS  (HOVER_STEADY_MS * ALT_LOOP_RATE_HZ / 1000)
+#define HOVER_LEARN_TICKS   (HOVER_LEARN_MS * ALT_LOOP_RATE_HZ / 1000)
+
+typedef struct {
+    uint32_t magic;
+    int32_t duty;
+    uint32_t crc;       // CRC-32 of the above
+} HoverRecord;
+
+// Each loop takes its derivative across the readings of the last
+// 1 / DERIV_WINDOW_HZ seconds, so this many ticks of that loop.
+#define ALT_DERIV_TICKS  ((ALT_LOOP_RATE_HZ >= DERIV_WINDOW_HZ) ? ALT_LOOP_RATE_HZ / DERIV_WINDOW_HZ : 1)
+#define YAW_DERIV_TICKS  ((YAW_LOOP_RATE_HZ >= DERIV_WINDOW_HZ) ? YAW_LOOP_RATE_HZ / DERIV_WINDOW_HZ : 1)
+
+// Derivative numerators: 100 / dt of the window in loop ticks, divided by
+// CONTROL_TUNED_RATE_HZ when applied so the gains keep their tuned meaning.
+#define ALT_DERIV_SCALE  (100 * ALT_LOOP_RATE_HZ / ALT_DERIV_TICKS)
+#define YAW_DERIV_SCALE  (100 * YAW_LOOP_RATE_HZ / YAW_DERIV_TICKS)
+
+// The integral accumulates Ki * error each tick; these Q16 factors turn the
+// sum into the term the gains were tuned for, scaling by the actual dt.
+#define ALT_I_SCALE_Q16  ((CONTROL_TUNED_RATE_HZ * 65536) / (100 * ALT_LOOP_RATE_HZ))
+#define YAW_I_SCALE_Q16  ((CONTROL_TUNED_RATE_HZ * 65536) / (100 * YAW_LOOP_RATE_HZ))
+
+// Limit on the integral term (in PID sum units), equal to full duty. The
+// integrator stops accumulating beyond this so it cannot wind up.
+#define INTEGRAL_LIMIT   (PWM_DUTY_SCALE * GAIN_DUTY_DIVISOR)
+
+static int32_t altHistory[ALT_DERIV_TICKS];   // Altitude readings across the window
+static int32_t yawHistory[YAW_DERIV_TICKS];   // Yaw readings across the window
+static uint16_t altHistoryIndex = 0;
+static uint16_t yawHistoryIndex = 0;
 
 /*********************************************************************************
  * Create the main helicopter struct entity: controller, main rotor and tail rotor.
@@ -63,6 +124,7 @@ Helicopter* NewHeli(void)
         .ui32Duty = MAIN_PWM_START_DUTY,
         .pwmBase = PWM_MAIN_BASE,
         .pwmGen = PWM_MAIN_GEN,
+        .pwmGenBit = PWM_MAIN_GENBIT,
         .pwmOutNum = PWM_MAIN_OUTNUM,
         .pwmOutBit = PWM_MAIN_OUTBIT,
         .pwmPeriphPWM = PWM_MAIN_PERIPH_PWM,
@@ -70,6 +132,7 @@ Helicopter* NewHeli(void)
         .pwmGPIOConfig = PWM_MAIN_GPIO_CONFIG,
         .pwmGPIOBase = PWM_MAIN_GPIO_BASE,
         .pwmGPIOPin = PWM_MAIN_GPIO_PIN,
+        .adcTrigger = ADC_PWM_TRIGGER,
         .Kp = 1500,  //1000
         .Ki = 10,   //2
         .Kd = 250    //250
@@ -81,6 +144,7 @@ Helicopter* NewHeli(void)
         .ui32Duty = TAIL_PWM_START_DUTY,
         .pwmBase = PWM_TAIL_BASE,
         .pwmGen = PWM_TAIL_GEN,
+        .pwmGenBit = PWM_TAIL_GENBIT,
         .pwmOutNum = PWM_TAIL_OUTNUM,
         .pwmOutBit = PWM_TAIL_OUTBIT,
         .pwmPeriphPWM = PWM_TAIL_PERIPH_PWM,
@@ -115,6 +179,8 @@ Helicopter* NewHeli(void)
  * initialisePWM
  * M0PWM7 (J4-05, PC5) is used for the main rotor motor
  * M1PWM5 (J3-10, PF1) is used for the tail rotor motor
+ * The generator is left stopped; initialiseRotors starts
+ * both together.
  *********************************************************/
 void
 initialisePWM(Rotor *rotor)
@@ -126,30 +192,73 @@ initialisePWM(Rotor *rotor)
     GPIOPinConfigure(rotor->pwmGPIOConfig);
     GPIOPinTypePWM(rotor->pwmGPIOBase, rotor->pwmGPIOPin);
 
+    // Load and compare updates are locally synchronised, taking effect when
+    // the counter reaches zero, so a duty change never cuts a period short.
     PWMGenConfigure(rotor->pwmBase, rotor->pwmGen,
-                    PWM_GEN_MODE_UP_DOWN | PWM_GEN_MODE_NO_SYNC);
+                    PWM_GEN_MODE_UP_DOWN | PWM_GEN_MODE_NO_SYNC |
+                    PWM_GEN_MODE_GEN_SYNC_LOCAL);
     // Set the initial PWM parameters
     SetPWM(rotor);
 
-    PWMGenEnable(rotor->pwmBase, rotor->pwmGen);
+    // The ADC trigger goes out once per period at the set phase
+    if (rotor->adcTrigger)
+    {
+        PWMGenIntTrigEnable(rotor->pwmBase, rotor->pwmGen, PWM_ADC_TRIG_EVENT);
+    }
 
     // Disable the output.  Repeat this call with 'true' to turn O/P on.
     PWMOutputState(rotor->pwmBase, rotor->pwmOutBit, false);
 }
 
 /********************************************************
- * Function to set the freq, duty cycle of PWM
+ * Function to set the freq, duty cycle of PWM. The period
+ * is only recalculated and written when the frequency
+ * changes, and the compare register only when the duty
+ * changes, so repeated calls with the same duty are cheap.
  ********************************************************/
 void
 SetPWM(Rotor* rotor)
 {
-    // Calculate the PWM period corresponding to the freq.
-    uint32_t ui32Period =
-        SysCtlClockGet() / PWM_DIVIDER / rotor->ui32Freq;
+    uint32_t ui32Freq = rotor->ui32Freq;
+    uint32_t ui32Duty = rotor->ui32Duty;
+
+    pwmSetCalls++;
+    if (ui32Freq != rotor->ui32PeriodFreq)
+    {
+        // Calculate the PWM period corresponding to the freq, kept within
+        // the range the generator can produce at a useful resolution.
+        uint32_t ui32Period = PWM_CLOCK_HZ / ui32Freq;
+        if (ui32Period > PWM_MAX_PERIOD_COUNTS)
+        {
+            ui32Period = PWM_MAX_PERIOD_COUNTS;
+        }
+        else if (ui32Period < PWM_MIN_PERIOD_COUNTS)
+        {
+            ui32Period = PWM_MIN_PERIOD_COUNTS;
+        }
+        rotor->ui32Period = ui32Period;
+        rotor->ui32PeriodFreq = ui32Freq;
+        PWMGenPeriodSet(rotor->pwmBase, rotor->pwmGen, rotor->ui32Period);
+        pwmRegWrites++;
+#if ADC_PWM_PHASE_PERCENT > 0 && ADC_PWM_PHASE_PERCENT < 100
+        if (rotor->adcTrigger)
+        {
+            // Comparator A at the phase, counting up (load is half the period)
+            PWMPulseWidthSet(rotor->pwmBase, PWM_ADC_TRIG_OUTNUM,
+                             rotor->ui32Period * (100 - ADC_PWM_PHASE_PERCENT) / 100);
+            pwmRegWrites++;
+        }
+#endif
+        rotor->ui32WrittenDuty = ~ui32Duty;   // Compare must be rescaled for the new period
+    }
 
-    PWMGenPeriodSet(rotor->pwmBase, rotor->pwmGen, ui32Period);
-    PWMPulseWidthSet(rotor->pwmBase, rotor->pwmOutNum,
-                     ui32Period * rotor->ui32Duty / 100);
+    if (ui32Duty != rotor->ui32WrittenDuty)
+    {
+        PWMPulseWidthSet(rotor->pwmBase, rotor->pwmOutNum,
+                         rotor->ui32Period * ui32Duty / PWM_DUTY_SCALE);
+        rotor->ui32WrittenDuty = ui32Duty;
+        pwmRegWrites++;
+    }
 }
 
 /********************************************************
@@ -173,78 +282,175 @@ initialiseRotors(Helicopter* heli)
     initialisePWM(heli->mainrotor);
     initialisePWM(heli->tailrotor);
 
+    // Both generators are started, and their counters zeroed, within a few
+    // cycles of each other. With the same period and both centred on load,
+    // the main generator's ADC trigger then falls at the middle of the tail
+    // pulse too, as far from its edges as from the main rotor's.
+    bool masked = IntMasterDisable();
+    PWMGenEnable(heli->mainrotor->pwmBase, heli->mainrotor->pwmGen);
+    PWMGenEnable(heli->tailrotor->pwmBase, heli->tailrotor->pwmGen);
+    PWMSyncTimeBase(heli->mainrotor->pwmBase, heli->mainrotor->pwmGenBit);
+    PWMSyncTimeBase(heli->tailrotor->pwmBase, heli->tailrotor->pwmGenBit);
+    if (!masked)
+    {
+        IntMasterEnable();
+    }
+
     PWMOutputState(heli->mainrotor->pwmBase, heli->mainrotor->pwmOutBit, true);
     PWMOutputState(heli->tailrotor->pwmBase, heli->tailrotor->pwmOutBit, true);
 }
 
 /********************************************************
- * adjustHeli polls the buttons UP, DOWN, RIGHT and LEFT
- * to look for increments in altitude and yaw angle set
- * points.
+ * adjustHeli takes the presses of the buttons UP, DOWN,
+ * RIGHT and LEFT, auto-repeats included, as increments
+ * in altitude and yaw angle set points. The new duties
+ * are applied by the kernel once per tick.
  ********************************************************/
 void
 AdjustHeli(Helicopter *heli)
 {
-    // Background task: Check for button pushes
-    if ((checkButton(UP) == PUSHED) && (heli->controller->altitudesetpoint <= 90)) {
-        heli->controller->altitudesetpoint += 10; // Increase altitude setpoint by 10%
-
-    } else if ((checkButton(DOWN) == PUSHED) && (heli->controller->altitudesetpoint >= 10)) {
-        heli->controller->altitudesetpoint -= 10; // Decrease altitude setpoint by 10%
-
-    } else if (checkButton(RIGHT) == PUSHED) {
-        // Increase Yaw Angle by 15 Degrees (19 states)
-        heli->controller->yawanglesetpoint -= (56/3);
-        heli->controller->yaw_increment -= 15;
-
-    } else if (checkButton(LEFT) == PUSHED) {
-        // Decrease Yaw Angle by 15 Degrees (19 states)
-        heli->controller->yawanglesetpoint += (56/3);
-        heli->controller->yaw_increment += 15;
+    // Background task: Check for button pushes. Every button is taken each
+    // pass, with its presses and auto-repeats since the last pass, so held
+    // and simultaneous buttons all count.
+    int32_t altSteps = checkButtonPresses(UP) - checkButtonPresses(DOWN);
+    int32_t yawSteps = checkButtonPresses(LEFT) - checkButtonPresses(RIGHT);
+
+    if (heli->submode != FLY)
+    {
+        return;   // A flight plan has the setpoints, presses are discarded
+    }
+
+    // Altitude setpoint moves in 10% steps, held between 0 and 100%
+    heli->controller->altitudesetpoint += 10 * altSteps;
+    if (heli->controller->altitudesetpoint > 100) {
+        heli->controller->altitudesetpoint = 100;
+    } else if (heli->controller->altitudesetpoint < 0) {
+        heli->controller->altitudesetpoint = 0;
+    }
+
+    // Yaw Angle moves 15 Degrees per step, LEFT increasing. The desired angle
+    // is kept in degrees and the setpoint counts derived from it, so whole
+    // turns of presses come back to exactly the same count.
+    heli->controller->yaw_increment = YawWrapDegrees(heli->controller->yaw_increment + 15 * yawSteps);
+    heli->controller->yawanglesetpoint = YawDegreesToCounts(heli->controller->yaw_increment);
+}
+
+/********************************************************
+ * Accumulates Ki * error into the rotor integral and
+ * returns the integral term scaled by iScaleQ16 for the
+ * loop's dt. The sum is left unchanged when the term
+ * would pass INTEGRAL_LIMIT (anti-windup).
+ ********************************************************/
+RAMFUNC static int32_t
+IntegralTerm (Rotor *rotor, int32_t error, int32_t iScaleQ16)
+{
+    int32_t I = rotor->I + rotor->Ki * error;
+    int32_t term = (int32_t)(((int64_t)I * iScaleQ16) >> 16);
+
+    if (term > INTEGRAL_LIMIT || term < -INTEGRAL_LIMIT)
+    {
+        return (int32_t)(((int64_t)rotor->I * iScaleQ16) >> 16);
     }
-    heli->controller->yawanglesetpoint = heli->controller->yawanglesetpoint % 448;
-    heli->controller->yaw_increment = (((heli->controller->yaw_increment + 540) % 360) - 180);
-    SetPWM(heli->mainrotor);
-    SetPWM(heli->tailrotor);
+    rotor->I = I;
+    return term;
 }
 
 /********************************************************
  * Digital Implementation of PID Controller for main rotor
- * Calculates P, I and D components for the main.
+ * Calculates P, I and D components for the main. Runs at
+ * ALT_LOOP_RATE_HZ; I and D are scaled by that dt.
  ********************************************************/
-int32_t
+RAMFUNC int32_t
 main_controller (Helicopter *heli)
 {
     int32_t error = heli->controller->altitudesetpoint - heli->controller->curr_altitude_reading;   // error
     int32_t P = (heli->mainrotor->Kp * error);            // Proportional
-    int32_t dI = heli->mainrotor->Ki * error / 100;          // Integral
-    int32_t D = (heli->mainrotor->Kd * (heli->controller->prev_altitude_reading - heli->controller->curr_altitude_reading) * 100); // Derivative
+    int32_t I = IntegralTerm(heli->mainrotor, error, ALT_I_SCALE_Q16);    // Integral
 
-    int32_t control = (P + (heli->mainrotor->I + dI) + D) / GAIN_DIVIDE_FACTOR; //leave divide by gain factor until after addition to prevent zero round error for small integral gain accumulation.
+    // Derivative across the window, the oldest reading is replaced by the newest.
+    heli->controller->prev_altitude_reading = altHistory[altHistoryIndex];
+    altHistory[altHistoryIndex] = heli->controller->curr_altitude_reading;
+    altHistoryIndex = (altHistoryIndex + 1) % ALT_DERIV_TICKS;
+    int32_t D = heli->mainrotor->Kd * (heli->controller->prev_altitude_reading - heli->controller->curr_altitude_reading)
+                * ALT_DERIV_SCALE / CONTROL_TUNED_RATE_HZ; // Derivative
 
-
-    heli->mainrotor->I = (heli->mainrotor->I + dI);  // Saves previous yaw angle for next error calculation
-    heli->controller->prev_altitude_reading = heli->controller->curr_altitude_reading; // Saves previous yaw angle for next error calculation
+    int32_t control = (P + I + D) / GAIN_DUTY_DIVISOR; //leave divide by gain factor until after addition to prevent zero round error for small integral gain accumulation.
 
     return (control);   // Add gravity and coupling offsets
 }
 
+/********************************************************
+ * Learns the hover duty while flying. Once the altitude
+ * has been within HOVER_STEADY_ERROR of the setpoint and
+ * not moving for HOVER_STEADY_MS, every HOVER_LEARN_MS
+ * a share of the integral term is moved into hoverDuty.
+ * The integrator gives up the same duty, so the output
+ * does not step, and over a few seconds the integral
+ * that a takeoff would otherwise have to wind up ends up
+ * in the feed-forward. Not while the output saturates.
+ ********************************************************/
+RAMFUNC static void
+HoverLearn (Helicopter* heli, int32_t mainOutput)
+{
+    static uint32_t steadyTicks = 0;
+    Controller* controller = heli->controller;
+    Rotor* rotor = heli->mainrotor;
+    int32_t error = controller->altitudesetpoint - controller->curr_altitude_reading;
+    int32_t rate = controller->prev_altitude_reading - controller->curr_altitude_reading;
+
+    if ((heli->submode != FLY && heli->submode != PLAN)
+        || error > HOVER_STEADY_ERROR || error < -HOVER_STEADY_ERROR
+        || rate > HOVER_STEADY_ERROR || rate < -HOVER_STEADY_ERROR
+        || mainOutput >= PWM_MAIN_DUTY_MAX || mainOutput <= PWM_MAIN_DUTY_MIN)
+    {
+        steadyTicks = 0;
+        return;
+    }
+    if (++steadyTicks < HOVER_STEADY_TICKS)
+    {
+        return;
+    }
+    steadyTicks = HOVER_STEADY_TICKS - HOVER_LEARN_TICKS;   // Next transfer a period on
+
+    int32_t iDuty = (int32_t)(((int64_t)rotor->I * ALT_I_SCALE_Q16) >> 16) / GAIN_DUTY_DIVISOR;
+    int32_t transfer = iDuty / HOVER_LEARN_FRACTION;
+    if (hoverDuty + transfer > PWM_MAIN_DUTY_MAX)
+    {
+        transfer = PWM_MAIN_DUTY_MAX - hoverDuty;
+    }
+    else if (hoverDuty + transfer < PWM_MAIN_DUTY_MIN)
+    {
+        transfer = PWM_MAIN_DUTY_MIN - hoverDuty;
+    }
+    if (transfer == 0)
+    {
+        return;
+    }
+    hoverDuty += transfer;
+    rotor->I -= (int32_t)((((int64_t)transfer * GAIN_DUTY_DIVISOR) << 16) / ALT_I_SCALE_Q16);
+    hoverLearns++;
+}
+
 /********************************************************
  * Digital Implementation of PID Controller for tail rotor
- * Calculates P, I and D components for the tail.
+ * Calculates P, I and D components for the tail. Runs at
+ * YAW_LOOP_RATE_HZ; I and D are scaled by that dt.
  ********************************************************/
-int32_t
+RAMFUNC int32_t
 tail_controller (Helicopter *heli)
 {
-    int32_t error = (heli->controller->yawanglesetpoint) - heli->controller->curr_yawangle_reading;   // error
+    int32_t error = YawError(heli->controller->yawanglesetpoint, heli->controller->curr_yawangle_reading);   // shortest way round
     int32_t P = heli->tailrotor->Kp * error;            // Proportional
-    int32_t dI = heli->tailrotor->Ki * error / 100;          // Integral
-    int32_t D = heli->tailrotor->Kd * (heli->controller->prev_yawangle_reading - heli->controller->curr_yawangle_reading) * 100;   // Derivative
+    int32_t I = IntegralTerm(heli->tailrotor, error, YAW_I_SCALE_Q16);    // Integral
 
-    int32_t control = (P + (heli->tailrotor->I + dI) + D) / GAIN_DIVIDE_FACTOR; //leave divide by gain factor until after addition to prevent zero round error for small integral gain accumulation.
+    // Derivative across the window, the oldest reading is replaced by the newest.
+    heli->controller->prev_yawangle_reading = yawHistory[yawHistoryIndex];
+    yawHistory[yawHistoryIndex] = heli->controller->curr_yawangle_reading;
+    yawHistoryIndex = (yawHistoryIndex + 1) % YAW_DERIV_TICKS;
+    int32_t D = heli->tailrotor->Kd * (heli->controller->prev_yawangle_reading - heli->controller->curr_yawangle_reading)
+                * YAW_DERIV_SCALE / CONTROL_TUNED_RATE_HZ;   // Derivative
 
-    heli->tailrotor->I = (heli->tailrotor->I + dI);
-    heli->controller->prev_yawangle_reading = heli->controller->curr_yawangle_reading; // Saves previous yaw angle for next error calculation
+    int32_t control = (P + I + D) / GAIN_DUTY_DIVISOR; //leave divide by gain factor until after addition to prevent zero round error for small integral gain accumulation.
 
     return (control);   // Add gravity and coupling offsets
 }
@@ -254,44 +460,120 @@ tail_controller (Helicopter *heli)
  * rotors, taking into account coupling and gravity forces.
  * This also checks for saturation of the PWM via large
  * error, and reduces that PWM to stable values. It then
- * sets duty based on the control.
+ * sets duty based on the control. Called once per SysTick;
+ * each loop only updates on its own divider.
  ********************************************************/
-void
+RAMFUNC void
 ControllerImplementation (Helicopter* heli)
 {
-    CalculateAltitude(heli); // Updates current altitude value
-
-    // Calculate control output using PID controller
-    int32_t main_controlOutput = main_controller(heli) + GRAVITY_FACTOR;  // Produce a control output for main rotor
-    int32_t tail_controlOutput = tail_controller(heli) + ((8 * main_controlOutput) / 10);  // Produce a control output for tail rotor
-
-    // Apply saturation limits to the new duty cycle for main rotor
-    if (main_controlOutput > PWM_MAIN_DUTY_MAX) {
-        main_controlOutput = PWM_MAIN_DUTY_MAX;
-    } else if (main_controlOutput < PWM_MAIN_DUTY_MIN) {
-        main_controlOutput = PWM_MAIN_DUTY_MIN;
+    static uint16_t altTick = 0;
+    static uint16_t yawTick = 0;
+    static int32_t main_controlOutput = 0;  // Unsaturated main output, also feeds the tail coupling
+    uint32_t start = GetTimestamp();
+
+    controllerRuns++;
+
+    if (++altTick >= ALT_LOOP_DIVIDER)
+    {
+        altTick = 0;
+        CalculateAltitude(heli); // Updates current altitude value
+
+        // Calculate control output using PID controller
+        main_controlOutput = main_controller(heli) + hoverDuty;  // Produce a control output for main rotor
+
+        // Apply saturation limits to the new duty cycle for main rotor
+        int32_t mainDuty = main_controlOutput;
+        if (mainDuty > PWM_MAIN_DUTY_MAX) {
+            mainDuty = PWM_MAIN_DUTY_MAX;
+        } else if (mainDuty < PWM_MAIN_DUTY_MIN) {
+            mainDuty = PWM_MAIN_DUTY_MIN;
+        }
+        heli->mainrotor->ui32Duty = mainDuty; // Adjust the duty cycle of main rotor based on control output
+        HoverLearn(heli, main_controlOutput);
     }
 
-    // Apply saturation limits to the new duty cycle for tail rotor
-    if (tail_controlOutput > PWM_TAIL_DUTY_MAX) {
-        tail_controlOutput = PWM_TAIL_DUTY_MAX;
-    } else if (tail_controlOutput < PWM_TAIL_DUTY_MIN) {
-        tail_controlOutput = PWM_TAIL_DUTY_MIN;
+    if (++yawTick >= YAW_LOOP_DIVIDER)
+    {
+        yawTick = 0;
+        int32_t tail_controlOutput = tail_controller(heli) + ((8 * main_controlOutput) / 10);  // Produce a control output for tail rotor
+
+        // Apply saturation limits to the new duty cycle for tail rotor
+        if (tail_controlOutput > PWM_TAIL_DUTY_MAX) {
+            tail_controlOutput = PWM_TAIL_DUTY_MAX;
+        } else if (tail_controlOutput < PWM_TAIL_DUTY_MIN) {
+            tail_controlOutput = PWM_TAIL_DUTY_MIN;
+        }
+        heli->tailrotor->ui32Duty = tail_controlOutput; // Adjust the duty cycle of tail rotor based on control output
     }
 
-    // Apply control output to adjust duty cycle and doesn't exceed caps
-    heli->mainrotor->ui32Duty = main_controlOutput; // Adjust the duty cycle of main rotor based on control output
-    heli->tailrotor->ui32Duty = tail_controlOutput; // Adjust the duty cycle of tail rotor based on control output
-
+    uint32_t cycles = GetTimestamp() - start;
+    controllerCycles += cycles;
+    if (cycles > controllerCyclesMax)
+    {
+        controllerCyclesMax = cycles;
+    }
 }
 
+/********************************************************
+ * Re-zeroes the yaw frame on the reference. Kernel
+ * context only, like the yaw decoding.
+ ********************************************************/
+void
+ShiftYawFrame (Helicopter* heli, int32_t offset)
+{
+    uint16_t i;
+
+    heli->controller->curr_yawangle_reading -= offset;
+    heli->controller->prev_yawangle_reading -= offset;
+    heli->controller->yawanglesetpoint -= offset;
+    for (i = 0; i < YAW_DERIV_TICKS; i++)
+    {
+        yawHistory[i] -= offset;
+    }
+}
 
+/********************************************************
+ * Reads the stored hover duty, keeping GRAVITY_FACTOR if
+ * there is none or it is out of range.
+ ********************************************************/
+void
+HoverDutyLoad (void)
+{
+    HoverRecord record;
 
+    if (!eepromReady)
+    {
+        return;
+    }
+    EEPROMRead((uint32_t*)&record, HOVER_EEPROM_ADDR, sizeof(record));
+    if (record.magic == HOVER_MAGIC && record.crc == Crc32(&record, offsetof(HoverRecord, crc))
+        && record.duty >= PWM_MAIN_DUTY_MIN && record.duty <= PWM_MAIN_DUTY_MAX)
+    {
+        hoverDuty = record.duty;
+        hoverDutyStored = record.duty;
+    }
+}
 
+/********************************************************
+ * Stores the hover duty if it has moved by at least
+ * HOVER_SAVE_CHANGE, sparing the EEPROM small changes.
+ * A write stalls for milliseconds, so landed only.
+ ********************************************************/
+void
+HoverDutySave (void)
+{
+    HoverRecord record;
+    int32_t change = hoverDuty - hoverDutyStored;
 
-
-
-
-
-
-
+    if (!eepromReady || (change < HOVER_SAVE_CHANGE && change > -HOVER_SAVE_CHANGE))
+    {
+        return;
+    }
+    record.magic = HOVER_MAGIC;
+    record.duty = hoverDuty;
+    record.crc = Crc32(&record, offsetof(HoverRecord, crc));
+    if (EEPROMProgram((uint32_t*)&record, HOVER_EEPROM_ADDR, sizeof(record)) == 0)
+    {
+        hoverDutyStored = hoverDuty;
+    }
+}
@@ -25,25 +25,51 @@
 // General PWM configuration
 #define PWM_DIVIDER        4
 
+// Duty cycles are carried in hundredths of a percent, PWM_DUTY_SCALE is 100%.
+#define PWM_DUTY_SCALE          10000
+#define PWM_DUTY_PERCENT(p)     ((p) * (PWM_DUTY_SCALE / 100))
+
+// Limits on the PWM period in PWM clock counts. The 16-bit load register
+// holds half the period in up/down mode. The compare is matched counting
+// both up and down, so a step of the compare widens the pulse by two
+// counts: 2 / 2000, 0.1% of the period, at the minimum. SetPWM clamps to
+// these, which bounds the usable frequency for the selected clock.
+#define PWM_MAX_PERIOD_COUNTS   131070
+#define PWM_MIN_PERIOD_COUNTS   2000
+
 // Main Rotor Specific PWM configuration
 #define MAIN_PWM_START_RATE_HZ  250
 #define MAIN_PWM_START_DUTY     0
-#define PWM_MAIN_DUTY_MAX     80
-#define PWM_MAIN_DUTY_MIN     20
+#define PWM_MAIN_DUTY_MAX     PWM_DUTY_PERCENT(80)
+#define PWM_MAIN_DUTY_MIN     PWM_DUTY_PERCENT(20)
 
 // Tail Rotor Specific PWM configuration
 #define TAIL_PWM_START_RATE_HZ  250
 #define TAIL_PWM_START_DUTY    0
-#define PWM_TAIL_DUTY_MAX     64
-#define PWM_TAIL_DUTY_MIN     16
+#define PWM_TAIL_DUTY_MAX     PWM_DUTY_PERCENT(64)
+#define PWM_TAIL_DUTY_MIN     PWM_DUTY_PERCENT(16)
 
+// Gains are in thousandths of a percent of duty per unit of error; dividing
+// the PID sum by GAIN_DUTY_DIVISOR gives duty in PWM_DUTY_SCALE units.
 #define GAIN_DIVIDE_FACTOR     1000
-#define GRAVITY_FACTOR         51
+#define GAIN_DUTY_DIVISOR      (GAIN_DIVIDE_FACTOR * 100 / PWM_DUTY_SCALE)
+#define GRAVITY_FACTOR         PWM_DUTY_PERCENT(51)   // Hover duty until one is learned
+
+// Hover duty learning, see HoverLearn. The learned duty is stored in EEPROM
+// at HOVER_EEPROM_ADDR, after the altitude calibration table.
+#define HOVER_STEADY_ERROR     1            // Altitude error and change (%) counted as steady
+#define HOVER_STEADY_MS        1000         // Steady this long before learning
+#define HOVER_LEARN_MS         100          // Then a transfer this often ...
+#define HOVER_LEARN_FRACTION   4            // ... of this fraction of the integral term
+#define HOVER_SAVE_CHANGE      (PWM_DUTY_PERCENT(1) / 2)
+#define HOVER_EEPROM_ADDR      0x040
+#define HOVER_MAGIC            0x484F5631   // "HOV1"
 
 //  PWM Hardware Details M0PWM7 (gen 3)
 //  ---Main Rotor PWM: PC5, J4-05
 #define PWM_MAIN_BASE        PWM0_BASE
 #define PWM_MAIN_GEN         PWM_GEN_3
+#define PWM_MAIN_GENBIT      PWM_GEN_3_BIT
 #define PWM_MAIN_OUTNUM      PWM_OUT_7
 #define PWM_MAIN_OUTBIT      PWM_OUT_7_BIT
 #define PWM_MAIN_PERIPH_PWM  SYSCTL_PERIPH_PWM0
@@ -51,11 +77,13 @@
 #define PWM_MAIN_GPIO_BASE   GPIO_PORTC_BASE
 #define PWM_MAIN_GPIO_CONFIG GPIO_PC5_M0PWM7
 #define PWM_MAIN_GPIO_PIN    GPIO_PIN_5
+#define PWM_ADC_TRIG_OUTNUM  PWM_OUT_6   // Comparator A, unused by the output, sets the ADC trigger phase
 
 //  PWM Hardware Details M1PWM5 (gen 2)
 //  ---Tail Rotor PWM: PF1, J4-05
 #define PWM_TAIL_BASE        PWM1_BASE
 #define PWM_TAIL_GEN         PWM_GEN_2
+#define PWM_TAIL_GENBIT      PWM_GEN_2_BIT
 #define PWM_TAIL_OUTNUM      PWM_OUT_5
 #define PWM_TAIL_OUTBIT      PWM_OUT_5_BIT
 #define PWM_TAIL_PERIPH_PWM  SYSCTL_PERIPH_PWM1
@@ -74,19 +102,20 @@ typedef struct {
     int32_t prev_yawangle_reading;
     int32_t prev_yaw_reading;
     int32_t curr_altitude_reading;       // a function, calculatealtitude as a %, of refAltADC. This is called after init_Alt initialises the refAltADC
-    int32_t curr_yawangle_reading;
-    int32_t yaw_increment;
+    int32_t curr_yawangle_reading;       // unwrapped yaw count from the reference, see yaw.h
+    int32_t yaw_increment;               // desired yaw in degrees (-180 to 179), set by the buttons
     int32_t altitudesetpoint;            // set point, + or - 10% increments vertically via updateduty()
-    int32_t yawanglesetpoint;            // set point, + or - 15% increments rotationally via updateduty()
+    int32_t yawanglesetpoint;            // set point in yaw counts, derived from yaw_increment; the error is taken the shortest way round
     uint8_t altitude_move_up;
     uint8_t altitude_move_down;
 } Controller;
 
 typedef struct {
     volatile uint32_t ui32Freq;
-    volatile uint32_t ui32Duty;
+    volatile uint32_t ui32Duty;          // Duty cycle in PWM_DUTY_SCALE units
     uint32_t pwmBase;
     uint32_t pwmGen;
+    uint32_t pwmGenBit;                  // pwmGen as a PWMSyncTimeBase bit
     uint32_t pwmOutNum;
     uint32_t pwmOutBit;
     uint32_t pwmPeriphPWM;
@@ -98,8 +127,29 @@ typedef struct {
     int32_t Ki;
     int32_t Kd;
     int32_t I;
+    uint32_t ui32Period;                 // PWM period cached by SetPWM for ui32PeriodFreq
+    uint32_t ui32PeriodFreq;             // Frequency ui32Period was computed for, 0 if none
+    uint32_t ui32WrittenDuty;            // Duty last written to the compare register
+    bool adcTrigger;                     // Generator triggers the altitude ADC
 } Rotor;
 
+// Register write statistics for SetPWM, counted since boot.
+extern uint32_t pwmSetCalls;
+extern uint32_t pwmRegWrites;
+
+// Calls to ControllerImplementation since boot, the cycles they took in
+// total and the worst single call since controllerCyclesMax was cleared.
+extern uint32_t controllerRuns;
+extern uint32_t controllerCycles;
+extern uint32_t controllerCyclesMax;
+
+// Feed-forward main duty for a hover, learned in flight and kept across
+// resets (EEPROM, and retain.h for warm resets). The value last stored and
+// the number of learning transfers since boot are kept for telemetry.
+extern int32_t hoverDuty;
+extern int32_t hoverDutyStored;
+extern uint32_t hoverLearns;
+
 typedef struct {
     int32_t meanVal;                   //current altitude, as a % of 100!!!
     int32_t refAltADC;                 //reference altitude ADC value
@@ -114,7 +164,8 @@ typedef enum {
 typedef enum {
     FLY = 0,
     TAKEOFF = 1,
-    LANDED = 2
+    LANDED = 2,
+    PLAN = 3             // Flying a flight plan, see plan.h
 } SubMode;
 
 typedef struct {
@@ -136,11 +187,14 @@ Helicopter* NewHeli(void);
  * initialisePWM
  * M0PWM7 (J4-05, PC5) is used for the main rotor motor
  * M1PWM5 (J3-10, PF1) is used for the tail rotor motor
+ * The generator is left stopped; initialiseRotors starts
+ * both together.
  *********************************************************/
 void initialisePWM(Rotor *rotor);
 
 /********************************************************
- * Function to set the freq, duty cycle of PWM
+ * Function to set the freq, duty cycle of PWM. Only the
+ * registers whose value changed are written.
  ********************************************************/
 void SetPWM(Rotor *rotor);
 
@@ -152,7 +206,8 @@ void initialiseRotors (Helicopter* heli);
 /********************************************************
  * adjustHeli polls the buttons UP, DOWN, RIGHT and LEFT
  * to look for increments in altitude and yaw angle set
- * points.
+ * points. Simultaneous and held (auto-repeating)
+ * buttons are all applied.
  ********************************************************/
 void AdjustHeli(Helicopter* heli);
 
@@ -160,7 +215,7 @@ void AdjustHeli(Helicopter* heli);
  * Digital Implementation of PID Controller for main rotor
  * Calculates P, I and D components for the main.
  ********************************************************/
-int32_t MainController (Helicopter* heli);
+int32_t main_controller (Helicopter* heli);
 
 /********************************************************
  * Computers the control outputs for the main and tail
@@ -175,6 +230,24 @@ void ControllerImplementation (Helicopter* heli);
  * Digital Implementation of PID Controller for tail rotor
  * Calculates P, I and D components for the tail.
  ********************************************************/
-int32_t TailController (Helicopter* heli);
+int32_t tail_controller (Helicopter* heli);
+
+/********************************************************
+ * Moves the yaw frame so the count 'offset' becomes zero,
+ * shifting the reading, setpoint and derivative history
+ * together so the controller sees no step.
+ ********************************************************/
+void ShiftYawFrame (Helicopter* heli, int32_t offset);
+
+/********************************************************
+ * Loads the learned hover duty from EEPROM, if stored.
+ ********************************************************/
+void HoverDutyLoad (void);
+
+/********************************************************
+ * Stores the learned hover duty in EEPROM if it changed
+ * enough to be worth a write. Call while landed.
+ ********************************************************/
+void HoverDutySave (void);
 
 #endif /* ROTORS_H_ */
@@ -0,0 +1,108 @@
+//*******************************************************************************
+// board.c
+//
+// The rest of the board support the firmware links against in the SITL
+// build: TivaWare's ustdlib on the host C library, and the Orbit OLED kept
+// as four lines of text for the console's "state" command.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utils/ustdlib.h"
+#include "OrbitOLED/OrbitOLEDInterface.h"
+#include "board.h"
+
+char oledText[OLED_ROWS][OLED_COLUMNS + 1];
+
+//*****************************************************************************
+// ustdlib. The firmware only uses conversions the C library formats the
+// same way.
+//*****************************************************************************
+int
+uvsnprintf(char *s, uint32_t size, const char *format, va_list arg)
+{
+    return vsnprintf(s, size, format, arg);
+}
+
+int
+usnprintf(char *s, uint32_t size, const char *format, ...)
+{
+    va_list arg;
+    int length;
+
+    va_start(arg, format);
+    length = vsnprintf(s, size, format, arg);
+    va_end(arg);
+    return length;
+}
+
+int
+usprintf(char *s, const char *format, ...)
+{
+    va_list arg;
+    int length;
+
+    va_start(arg, format);
+    length = vsprintf(s, format, arg);
+    va_end(arg);
+    return length;
+}
+
+uint32_t
+ustrlen(const char *s)
+{
+    return strlen(s);
+}
+
+int
+ustrncmp(const char *s1, const char *s2, uint32_t n)
+{
+    return strncmp(s1, s2, n);
+}
+
+uint32_t
+ustrtoul(const char *nptr, const char **endptr, int base)
+{
+    return strtoul(nptr, (char**)endptr, base);
+}
+
+int32_t
+ustrtol(const char *nptr, const char **endptr, int base)
+{
+    return strtol(nptr, (char**)endptr, base);
+}
+
+//*****************************************************************************
+// OLED
+//*****************************************************************************
+void
+OLEDInitialise(void)
+{
+    int row;
+
+    for (row = 0; row < OLED_ROWS; row++)
+    {
+        memset(oledText[row], ' ', OLED_COLUMNS);
+        oledText[row][OLED_COLUMNS] = '\0';
+    }
+}
+
+void
+OLEDStringDraw(const char *pcStr, unsigned long ulColumn, unsigned long ulRow)
+{
+    if (ulRow >= OLED_ROWS)
+    {
+        return;
+    }
+    while (*pcStr && ulColumn < OLED_COLUMNS)
+    {
+        oledText[ulRow][ulColumn++] = *pcStr++;
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef BOARD_H_
+#define BOARD_H_
+
+//*******************************************************************************
+// board.c
+//
+// The rest of the board support the firmware links against in the SITL
+// build: TivaWare's ustdlib on the host C library, and the Orbit OLED kept
+// as four lines of text.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#define OLED_ROWS       4
+#define OLED_COLUMNS    16
+
+extern char oledText[OLED_ROWS][OLED_COLUMNS + 1];
+
+#endif /* BOARD_H_ */
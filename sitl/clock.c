@@ -0,0 +1,122 @@
+//*******************************************************************************
+// clock.c
+//
+// Event queue behind virtual time in the SITL build: a binary min-heap of
+// timers ordered by due cycle, then start order.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "clock.h"
+
+uint64_t clockEvents = 0;
+
+static ClockTimer* heap[CLOCK_MAX_TIMERS];
+static uint32_t heapCount = 0;
+static uint64_t started = 0;
+
+static bool
+Before(const ClockTimer* a, const ClockTimer* b)
+{
+    return a->due < b->due || (a->due == b->due && a->order < b->order);
+}
+
+static void
+Place(ClockTimer* timer, uint32_t index)
+{
+    heap[index] = timer;
+    timer->slot = index + 1;
+}
+
+//*****************************************************************************
+// Restores the heap order about one entry, moving it up or down.
+//*****************************************************************************
+static void
+Sift(uint32_t index)
+{
+    ClockTimer* timer = heap[index];
+
+    while (index > 0 && Before(timer, heap[(index - 1) / 2]))
+    {
+        Place(heap[(index - 1) / 2], index);
+        index = (index - 1) / 2;
+    }
+    for (;;)
+    {
+        uint32_t child = 2 * index + 1;
+
+        if (child >= heapCount)
+        {
+            break;
+        }
+        if (child + 1 < heapCount && Before(heap[child + 1], heap[child]))
+        {
+            child++;
+        }
+        if (!Before(heap[child], timer))
+        {
+            break;
+        }
+        Place(heap[child], index);
+        index = child;
+    }
+    Place(timer, index);
+}
+
+void
+ClockStart(ClockTimer* timer, uint64_t due)
+{
+    timer->due = due;
+    timer->order = started++;
+    if (!timer->slot)
+    {
+        if (heapCount == CLOCK_MAX_TIMERS)
+        {
+            fprintf(stderr, "SITL: too many timers for %s\n", timer->name);
+            exit(1);
+        }
+        Place(timer, heapCount++);
+    }
+    Sift(timer->slot - 1);
+}
+
+void
+ClockStop(ClockTimer* timer)
+{
+    uint32_t index = timer->slot;
+
+    if (!index)
+    {
+        return;
+    }
+    index--;
+    timer->slot = 0;
+    heapCount--;
+    if (index < heapCount)
+    {
+        heap[index] = heap[heapCount];
+        Sift(index);
+    }
+}
+
+ClockTimer*
+ClockFirst(void)
+{
+    return heapCount ? heap[0] : NULL;
+}
+
+void
+ClockPop(void)
+{
+    if (heapCount)
+    {
+        ClockStop(heap[0]);
+        clockEvents++;
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef CLOCK_H_
+#define CLOCK_H_
+
+//*******************************************************************************
+// clock.c
+//
+// Event queue behind virtual time in the SITL build. Every source of a
+// hardware event (SysTick, a PWM trigger, a UART character time, a
+// quadrature edge, the plant, host I/O) owns a ClockTimer and starts it for
+// the core cycle its next event falls on. hal.c takes the timers in time
+// order, moving virtual time to each and calling its handler, which may
+// start it or any other again. Timers due on the same cycle run in the
+// order they were started.
+//
+// The queue is a binary heap of timers, each knowing its place in it, so
+// starting, moving and stopping one are O(log n) with no allocation.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CLOCK_MAX_TIMERS     32
+
+typedef struct {
+    void (*handler)(void);
+    const char* name;        // For diagnostics
+    uint64_t due;            // Core cycle of the event
+    uint64_t order;          // Start order, breaking ties
+    uint32_t slot;           // Place in the heap plus one, 0 when stopped
+} ClockTimer;
+
+#define CLOCK_TIMER(handler)  { (handler), #handler, 0, 0, 0 }
+
+//*****************************************************************************
+// Starts, or moves, a timer to fire at the given cycle.
+void ClockStart(ClockTimer* timer, uint64_t due);
+
+//*****************************************************************************
+// Stops a timer; a stopped timer is left alone.
+void ClockStop(ClockTimer* timer);
+
+static inline bool
+ClockRunning(const ClockTimer* timer)
+{
+    return timer->slot != 0;
+}
+
+//*****************************************************************************
+// The timer due first, or NULL when none is running, and its removal.
+ClockTimer* ClockFirst(void);
+void ClockPop(void);
+
+//*****************************************************************************
+// Events run since power on of this process.
+extern uint64_t clockEvents;
+
+#endif /* CLOCK_H_ */
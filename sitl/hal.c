@@ -0,0 +1,637 @@
+//*******************************************************************************
+// hal.c
+//
+// Core of the host hardware abstraction for the SITL build: virtual time, the
+// NVIC, PRIMASK and WFI, SysTick, the DWT cycle counter, the timestamp timer,
+// the watchdog, the EEPROM and resets.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "inc/hw_ints.h"
+#include "driverlib/cpu.h"
+#include "driverlib/eeprom.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/systick.h"
+#include "driverlib/timer.h"
+#include "driverlib/watchdog.h"
+#include "system.h"
+#include "clock.h"
+#include "hal.h"
+
+uint64_t sitlCycles = 0;
+
+// DWT registers, see system.h. The cycle counter follows virtual time while
+// the core is awake and, as the core's does, stops in WFI. Timer 5's count
+// (the timestamp) follows virtual time throughout. GetCycles() reads the
+// host's clock, as the firmware's own code takes no virtual time.
+volatile uint32_t sitlDemcr = 0;
+volatile uint32_t sitlDwtCtrl = 0;
+volatile uint32_t sitlDwtCyccnt = 0;
+volatile uint32_t sitlTimer5Tav = 0;
+static bool timer5Enabled = false;
+static bool asleep = false;      // In WFI, with no handler running
+
+// NVIC, indexed by exception number
+#define THREAD_PRIORITY  0x100   // Below every handler
+static void (*vectors[NUM_INTERRUPTS])(void);
+static uint8_t priority[NUM_INTERRUPTS];
+static bool enabled[NUM_INTERRUPTS];
+static bool pending[NUM_INTERRUPTS];
+static uint32_t pendingCount = 0;   // Saves scanning when none is
+static uint16_t activePriority = THREAD_PRIORITY;
+static bool primask = false;
+static uint64_t taken = 0;       // Handlers run, for the wake from WFI
+
+static void SysTickFire(void);
+static ClockTimer sysTickTimer = CLOCK_TIMER(SysTickFire);
+static uint32_t sysTickPeriod = 0x01000000;
+static uint64_t sysTickReload = 0;   // Cycle the counter last reloaded
+static bool sysTickEnabled = false;
+
+static void WatchdogFire(void);
+static ClockTimer watchdogTimer = CLOCK_TIMER(WatchdogFire);
+static uint32_t watchdogReload = 0xFFFFFFFF;
+static bool watchdogEnabled = false;
+static bool watchdogReset = false;
+static bool watchdogLocked = false;
+static bool watchdogTimedOut = false;
+
+static uint32_t eeprom[SITL_EEPROM_WORDS];
+static bool eepromErased = false;
+static int eepromFd = -1;
+
+static uint32_t resetCause = SYSCTL_CAUSE_POR;
+
+// No-init RAM (system.h NOINIT), carried across a reset
+extern char __start_sitl_noinit[] __attribute__((weak));
+extern char __stop_sitl_noinit[] __attribute__((weak));
+
+uint32_t
+SitlHostNanoseconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((uint64_t)now.tv_sec * 1000000000u + now.tv_nsec);
+}
+
+//*****************************************************************************
+// Virtual time
+//*****************************************************************************
+static void
+SetTime(uint64_t cycles)
+{
+    if ((sitlDwtCtrl & DWT_CTRL_CYCCNTENA) && !asleep)
+    {
+        sitlDwtCyccnt += (uint32_t)(cycles - sitlCycles);
+    }
+    if (timer5Enabled)
+    {
+        sitlTimer5Tav += (uint32_t)(cycles - sitlCycles);
+    }
+    sitlCycles = cycles;
+}
+
+//*****************************************************************************
+// Runs the first event if it is due by limit: moves virtual time to it and
+// calls its handler. An event started for a cycle already past runs now.
+//*****************************************************************************
+static bool
+RunNext(uint64_t limit)
+{
+    ClockTimer* timer = ClockFirst();
+
+    if (!timer || timer->due > limit)
+    {
+        return false;
+    }
+    ClockPop();
+    if (timer->due > sitlCycles)
+    {
+        SetTime(timer->due);
+    }
+    timer->handler();
+    return true;
+}
+
+void
+SitlAdvance(uint64_t cycles)
+{
+    uint64_t end = sitlCycles + cycles;
+
+    while (RunNext(end))
+    {
+    }
+    SetTime(end);
+}
+
+//*****************************************************************************
+// NVIC. Takes the most urgent pending, enabled interrupt that can preempt
+// what is running, lowest number first among equals, until none is left.
+//*****************************************************************************
+static void
+Dispatch(void)
+{
+    while (!primask && pendingCount)
+    {
+        uint32_t best = 0;
+        uint32_t i;
+
+        for (i = 0; i < NUM_INTERRUPTS; i++)
+        {
+            if (pending[i] && enabled[i] && vectors[i] && priority[i] < activePriority
+                && (best == 0 || priority[i] < priority[best]))
+            {
+                best = i;
+            }
+        }
+        if (best == 0)
+        {
+            return;
+        }
+
+        uint16_t interrupted = activePriority;
+        bool slept = asleep;
+        pending[best] = false;
+        pendingCount--;
+        taken++;
+        activePriority = priority[best];
+        asleep = false;
+        vectors[best]();
+        asleep = slept;
+        activePriority = interrupted;
+    }
+}
+
+void
+SitlIntPend(uint32_t interrupt)
+{
+    if (!pending[interrupt])
+    {
+        pending[interrupt] = true;
+        pendingCount++;
+    }
+    Dispatch();
+}
+
+void
+IntRegister(uint32_t ui32Interrupt, void (*pfnHandler)(void))
+{
+    vectors[ui32Interrupt] = pfnHandler;
+}
+
+void
+IntPriorityGroupingSet(uint32_t ui32Bits)
+{
+}
+
+void
+IntPrioritySet(uint32_t ui32Interrupt, uint8_t ui8Priority)
+{
+    priority[ui32Interrupt] = ui8Priority & 0xE0;   // Three bits implemented
+}
+
+void
+IntEnable(uint32_t ui32Interrupt)
+{
+    enabled[ui32Interrupt] = true;
+    Dispatch();
+}
+
+void
+IntDisable(uint32_t ui32Interrupt)
+{
+    enabled[ui32Interrupt] = false;
+}
+
+void
+IntPendSet(uint32_t ui32Interrupt)
+{
+    SitlIntPend(ui32Interrupt);
+}
+
+bool
+IntMasterEnable(void)
+{
+    return CPUcpsie();
+}
+
+bool
+IntMasterDisable(void)
+{
+    return CPUcpsid();
+}
+
+//*****************************************************************************
+// CPU
+//*****************************************************************************
+uint32_t
+CPUcpsid(void)
+{
+    uint32_t was = primask;
+    primask = true;
+    return was;
+}
+
+uint32_t
+CPUcpsie(void)
+{
+    uint32_t was = primask;
+    primask = false;
+    Dispatch();
+    return was;
+}
+
+uint32_t
+CPUprimask(void)
+{
+    return primask;
+}
+
+//*****************************************************************************
+// Runs events until one raises an interrupt that would wake the core: one
+// taken straight away, or, with PRIMASK set, one left pending for the
+// kernel to take once it unmasks, as WFI wakes for it regardless.
+//*****************************************************************************
+static bool
+Waiting(void)
+{
+    uint32_t i;
+
+    for (i = 0; pendingCount && i < NUM_INTERRUPTS; i++)
+    {
+        if (pending[i] && enabled[i] && vectors[i])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+CPUwfi(void)
+{
+    uint64_t before = taken;
+
+    asleep = true;
+    while (taken == before && !Waiting())
+    {
+        if (!RunNext(UINT64_MAX))
+        {
+            fprintf(stderr, "SITL: asleep with nothing left to wake it\n");
+            exit(1);
+        }
+    }
+    asleep = false;
+}
+
+//*****************************************************************************
+// SysTick, counting down from the period and raising its interrupt as it
+// reloads. A new period is taken up at the next reload.
+//*****************************************************************************
+static void
+SysTickFire(void)
+{
+    sysTickReload = sitlCycles;
+    ClockStart(&sysTickTimer, sitlCycles + sysTickPeriod);
+    SitlIntPend(FAULT_SYSTICK);
+}
+
+void
+SysTickPeriodSet(uint32_t ui32Period)
+{
+    sysTickPeriod = ui32Period;
+}
+
+uint32_t
+SysTickPeriodGet(void)
+{
+    return sysTickPeriod;
+}
+
+uint32_t
+SysTickValueGet(void)
+{
+    if (!sysTickEnabled)
+    {
+        return 0;
+    }
+    return (sysTickPeriod - 1) - (uint32_t)((sitlCycles - sysTickReload) % sysTickPeriod);
+}
+
+void
+SysTickIntRegister(void (*pfnHandler)(void))
+{
+    IntRegister(FAULT_SYSTICK, pfnHandler);
+    enabled[FAULT_SYSTICK] = true;
+}
+
+void
+SysTickIntEnable(void)
+{
+    enabled[FAULT_SYSTICK] = true;
+}
+
+void
+SysTickEnable(void)
+{
+    if (!sysTickEnabled)
+    {
+        sysTickEnabled = true;
+        sysTickReload = sitlCycles;
+        ClockStart(&sysTickTimer, sitlCycles + sysTickPeriod);
+    }
+}
+
+//*****************************************************************************
+// System control
+//*****************************************************************************
+void
+SysCtlClockSet(uint32_t ui32Config)
+{
+}
+
+uint32_t
+SysCtlClockGet(void)
+{
+    return SYSTEM_CLOCK_HZ;
+}
+
+void
+SysCtlPeripheralEnable(uint32_t ui32Peripheral)
+{
+}
+
+void
+SysCtlPeripheralReset(uint32_t ui32Peripheral)
+{
+}
+
+bool
+SysCtlPeripheralReady(uint32_t ui32Peripheral)
+{
+    return true;
+}
+
+void
+SysCtlPeripheralSleepEnable(uint32_t ui32Peripheral)
+{
+}
+
+void
+SysCtlDelay(uint32_t ui32Count)
+{
+    SitlAdvance(3 * (uint64_t)ui32Count);   // Three cycle loop
+}
+
+void
+SysCtlSleep(void)
+{
+    CPUwfi();
+}
+
+void
+SysCtlReset(void)
+{
+    SitlReset(SYSCTL_CAUSE_SW);
+}
+
+uint32_t
+SysCtlResetCauseGet(void)
+{
+    return resetCause;
+}
+
+void
+SysCtlResetCauseClear(uint32_t ui32Causes)
+{
+    resetCause &= ~ui32Causes;
+}
+
+//*****************************************************************************
+// Timer 5, only as the timestamp uses it: counting up from zero through all
+// 32 bits, in sleep as awake.
+//*****************************************************************************
+void
+TimerConfigure(uint32_t ui32Base, uint32_t ui32Config)
+{
+    timer5Enabled = false;
+    sitlTimer5Tav = 0;
+}
+
+void
+TimerLoadSet(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Value)
+{
+}
+
+void
+TimerControlStall(uint32_t ui32Base, uint32_t ui32Timer, bool bStall)
+{
+}
+
+void
+TimerEnable(uint32_t ui32Base, uint32_t ui32Timer)
+{
+    timer5Enabled = true;
+}
+
+//*****************************************************************************
+// Watchdog 0. Its first time-out raises the interrupt; a second, with the
+// interrupt not cleared in between, resets the processor. Clearing the
+// interrupt reloads the count. While locked, as on the part, writes to its
+// registers other than the lock, the interrupt clear included, are ignored.
+//*****************************************************************************
+static void
+WatchdogRestart(void)
+{
+    watchdogTimedOut = false;
+    if (watchdogEnabled)
+    {
+        ClockStart(&watchdogTimer, sitlCycles + watchdogReload);
+    }
+}
+
+static void
+WatchdogFire(void)
+{
+    if (watchdogTimedOut && watchdogReset)
+    {
+        SitlReset(SYSCTL_CAUSE_WDOG0);
+    }
+    watchdogTimedOut = true;
+    ClockStart(&watchdogTimer, sitlCycles + watchdogReload);
+    SitlIntPend(INT_WATCHDOG);
+}
+
+bool
+WatchdogLockState(uint32_t ui32Base)
+{
+    return watchdogLocked;
+}
+
+void
+WatchdogLock(uint32_t ui32Base)
+{
+    watchdogLocked = true;
+}
+
+void
+WatchdogUnlock(uint32_t ui32Base)
+{
+    watchdogLocked = false;
+}
+
+void
+WatchdogReloadSet(uint32_t ui32Base, uint32_t ui32LoadVal)
+{
+    if (watchdogLocked)
+    {
+        return;
+    }
+    watchdogReload = ui32LoadVal;
+    if (watchdogEnabled)
+    {
+        WatchdogRestart();
+    }
+}
+
+void
+WatchdogResetEnable(uint32_t ui32Base)
+{
+    watchdogReset = watchdogReset || !watchdogLocked;
+}
+
+void
+WatchdogStallEnable(uint32_t ui32Base)
+{
+}
+
+void
+WatchdogEnable(uint32_t ui32Base)
+{
+    if (watchdogLocked)
+    {
+        return;
+    }
+    watchdogEnabled = true;
+    WatchdogRestart();
+}
+
+void
+WatchdogIntClear(uint32_t ui32Base)
+{
+    if (!watchdogLocked)
+    {
+        WatchdogRestart();
+    }
+}
+
+void
+WatchdogIntRegister(uint32_t ui32Base, void (*pfnHandler)(void))
+{
+    IntRegister(INT_WATCHDOG, pfnHandler);
+    IntEnable(INT_WATCHDOG);
+}
+
+//*****************************************************************************
+// EEPROM, erased to all ones until loaded from a file or a reset
+//*****************************************************************************
+void
+HalEepromFile(const char* path)
+{
+    eepromFd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (eepromFd < 0)
+    {
+        perror(path);
+        return;
+    }
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    if (pread(eepromFd, eeprom, sizeof(eeprom), 0) < 0)
+    {
+        perror(path);
+    }
+    eepromErased = true;
+}
+
+uint32_t
+EEPROMInit(void)
+{
+    if (!eepromErased)
+    {
+        memset(eeprom, 0xFF, sizeof(eeprom));
+        eepromErased = true;
+    }
+    return EEPROM_INIT_OK;
+}
+
+void
+EEPROMRead(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count)
+{
+    if (ui32Address + ui32Count <= sizeof(eeprom))
+    {
+        memcpy(pui32Data, (char*)eeprom + ui32Address, ui32Count & ~3u);
+    }
+}
+
+uint32_t
+EEPROMProgram(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count)
+{
+    if (ui32Address + ui32Count > sizeof(eeprom))
+    {
+        return 1;
+    }
+    memcpy((char*)eeprom + ui32Address, pui32Data, ui32Count & ~3u);
+    if (eepromFd >= 0 && pwrite(eepromFd, eeprom, sizeof(eeprom), 0) < 0)
+    {
+        perror("SITL: EEPROM");
+    }
+    return 0;
+}
+
+//*****************************************************************************
+// Reset. Virtual time runs on, the EEPROM and no-init RAM keep their
+// contents; everything else starts again with the new process.
+//*****************************************************************************
+void
+HalSave(int fd)
+{
+    uint32_t noinit = (uint32_t)(__stop_sitl_noinit - __start_sitl_noinit);
+
+    if (write(fd, &sitlCycles, sizeof(sitlCycles)) < 0
+        || write(fd, eeprom, sizeof(eeprom)) < 0
+        || write(fd, &noinit, sizeof(noinit)) < 0
+        || (noinit && write(fd, __start_sitl_noinit, noinit) < 0))
+    {
+        perror("SITL: reset");
+    }
+}
+
+void
+HalLoad(int fd, uint32_t cause)
+{
+    uint32_t noinit = 0;
+
+    if (read(fd, &sitlCycles, sizeof(sitlCycles)) != sizeof(sitlCycles)
+        || read(fd, eeprom, sizeof(eeprom)) != sizeof(eeprom)
+        || read(fd, &noinit, sizeof(noinit)) != sizeof(noinit)
+        || noinit != (uint32_t)(__stop_sitl_noinit - __start_sitl_noinit)
+        || (noinit && read(fd, __start_sitl_noinit, noinit) != (ssize_t)noinit))
+    {
+        fprintf(stderr, "SITL: reset state lost\n");
+    }
+    eepromErased = true;
+    resetCause = cause;
+}
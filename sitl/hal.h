@@ -0,0 +1,67 @@
+#ifndef HAL_H_
+#define HAL_H_
+
+//*******************************************************************************
+// hal.c
+//
+// Core of the host hardware abstraction for the SITL build: virtual time, the
+// NVIC, PRIMASK and WFI, SysTick, the DWT cycle counter, the watchdog, the
+// EEPROM and resets. The firmware is compiled unchanged against the TivaWare
+// headers in sitl/include, whose functions are implemented here and in
+// periph.c.
+//
+// Virtual time is counted in core clock cycles and moves from one event to
+// the next (see clock.h): a SysTick reload, a PWM triggered conversion, a
+// UART character time, a quadrature edge, a step of the plant. It passes
+// only while the firmware waits, in CPUwfi, which the kernel calls whenever
+// it is idle, and in SysCtlDelay; firmware code takes no virtual time.
+// CPUwfi runs events until one raises an interrupt that wakes the core.
+// Interrupts follow the Cortex-M rules: a handler runs only if it is more
+// urgent than the code it interrupts and PRIMASK is clear, so one raised in
+// the kernel's masked sleep is taken when the kernel unmasks.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "system.h"
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+#define SITL_EEPROM_WORDS    512    // 2 KB
+
+extern uint64_t sitlCycles;     // Virtual time, core cycles since power on
+
+//*****************************************************************************
+// Moves virtual time on by cycles, running the events that fall due.
+void SitlAdvance(uint64_t cycles);
+
+//*****************************************************************************
+// Pends an interrupt (exception number, as inc/hw_ints.h) and takes it if
+// it can preempt what is running.
+void SitlIntPend(uint32_t interrupt);
+
+//*****************************************************************************
+// Keeps the EEPROM in a file, loaded now and written on every program.
+void HalEepromFile(const char* path);
+
+//*****************************************************************************
+// Saves the state that survives a reset (virtual time, EEPROM and no-init
+// RAM) to fd, and restores it with the cause of the reset after the restart.
+void HalSave(int fd);
+void HalLoad(int fd, uint32_t cause);
+
+//*****************************************************************************
+// Altitude ADC reading at the present cycle. Provided by sitl.c.
+uint32_t SitlAltitudeCounts(void);
+
+//*****************************************************************************
+// Restarts the SITL as after a reset with the given SYSCTL_CAUSE_ bits.
+// Provided by sitl.c.
+void SitlReset(uint32_t cause) __attribute__((noreturn));
+
+#endif /* HAL_H_ */
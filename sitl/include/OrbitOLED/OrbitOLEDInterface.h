@@ -0,0 +1,18 @@
+#ifndef ORBITOLEDINTERFACE_H_
+#define ORBITOLEDINTERFACE_H_
+
+//*******************************************************************************
+// OrbitOLED/OrbitOLEDInterface.h (SITL)
+//
+// The Orbit board's 16x4 character OLED, kept as text for the console's
+// "oled" command (see sitl/board.c).
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+void OLEDInitialise(void);
+void OLEDStringDraw(const char *pcStr, unsigned long ulColumn, unsigned long ulRow);
+
+#endif // ORBITOLEDINTERFACE_H_
@@ -0,0 +1,40 @@
+#ifndef __DRIVERLIB_ADC_H__
+#define __DRIVERLIB_ADC_H__
+
+//*******************************************************************************
+// driverlib/adc.h (SITL)
+//
+// The part of the TivaWare ADC API the firmware uses, implemented by the
+// host HAL in sitl/periph.c against the plant's altitude sensor.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ADC_TRIGGER_PROCESSOR   0x00000000
+#define ADC_TRIGGER_PWM0        0x00000006
+#define ADC_TRIGGER_PWM1        0x00000007
+#define ADC_TRIGGER_PWM2        0x00000008
+#define ADC_TRIGGER_PWM3        0x00000009
+#define ADC_CTL_CH9             0x00000009
+#define ADC_CTL_IE              0x00000040
+#define ADC_CTL_END             0x00000020
+
+void ADCSequenceConfigure(uint32_t ui32Base, uint32_t ui32SequenceNum,
+                          uint32_t ui32Trigger, uint32_t ui32Priority);
+void ADCSequenceStepConfigure(uint32_t ui32Base, uint32_t ui32SequenceNum,
+                              uint32_t ui32Step, uint32_t ui32Config);
+void ADCSequenceEnable(uint32_t ui32Base, uint32_t ui32SequenceNum);
+void ADCSequenceDisable(uint32_t ui32Base, uint32_t ui32SequenceNum);
+void ADCIntRegister(uint32_t ui32Base, uint32_t ui32SequenceNum, void (*pfnHandler)(void));
+void ADCIntEnable(uint32_t ui32Base, uint32_t ui32SequenceNum);
+void ADCIntClear(uint32_t ui32Base, uint32_t ui32SequenceNum);
+uint32_t ADCIntStatus(uint32_t ui32Base, uint32_t ui32SequenceNum, bool bMasked);
+void ADCProcessorTrigger(uint32_t ui32Base, uint32_t ui32SequenceNum);
+int32_t ADCSequenceDataGet(uint32_t ui32Base, uint32_t ui32SequenceNum, uint32_t *pui32Buffer);
+
+#endif // __DRIVERLIB_ADC_H__
@@ -0,0 +1,22 @@
+#ifndef __DRIVERLIB_CPU_H__
+#define __DRIVERLIB_CPU_H__
+
+//*******************************************************************************
+// driverlib/cpu.h (SITL)
+//
+// PRIMASK and wait for interrupt. CPUwfi is where virtual time passes, see
+// sitl/hal.c.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+
+uint32_t CPUcpsid(void);
+uint32_t CPUcpsie(void);
+uint32_t CPUprimask(void);
+void CPUwfi(void);
+
+#endif // __DRIVERLIB_CPU_H__
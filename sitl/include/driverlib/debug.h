@@ -0,0 +1,18 @@
+#ifndef __DRIVERLIB_DEBUG_H__
+#define __DRIVERLIB_DEBUG_H__
+
+//*******************************************************************************
+// driverlib/debug.h (SITL)
+//
+// Assertions, checked on the host.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <assert.h>
+
+#define ASSERT(expr)    assert(expr)
+
+#endif // __DRIVERLIB_DEBUG_H__
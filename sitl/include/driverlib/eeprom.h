@@ -0,0 +1,22 @@
+#ifndef __DRIVERLIB_EEPROM_H__
+#define __DRIVERLIB_EEPROM_H__
+
+//*******************************************************************************
+// driverlib/eeprom.h (SITL)
+//
+// The EEPROM, held in host memory and optionally a file, see sitl/hal.c.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+
+#define EEPROM_INIT_OK          0
+
+uint32_t EEPROMInit(void);
+void EEPROMRead(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count);
+uint32_t EEPROMProgram(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count);
+
+#endif // __DRIVERLIB_EEPROM_H__
@@ -0,0 +1,67 @@
+#ifndef __DRIVERLIB_GPIO_H__
+#define __DRIVERLIB_GPIO_H__
+
+//*******************************************************************************
+// driverlib/gpio.h (SITL)
+//
+// The part of the TivaWare GPIO API the firmware uses, implemented by the
+// host HAL in sitl/periph.c. Input levels are driven by the plant and the
+// console.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define GPIO_PIN_0              0x00000001
+#define GPIO_PIN_1              0x00000002
+#define GPIO_PIN_2              0x00000004
+#define GPIO_PIN_3              0x00000008
+#define GPIO_PIN_4              0x00000010
+#define GPIO_PIN_5              0x00000020
+#define GPIO_PIN_6              0x00000040
+#define GPIO_PIN_7              0x00000080
+
+#define GPIO_INT_PIN_0          0x00000001
+#define GPIO_INT_PIN_1          0x00000002
+#define GPIO_INT_PIN_2          0x00000004
+#define GPIO_INT_PIN_3          0x00000008
+#define GPIO_INT_PIN_4          0x00000010
+#define GPIO_INT_PIN_5          0x00000020
+#define GPIO_INT_PIN_6          0x00000040
+#define GPIO_INT_PIN_7          0x00000080
+
+#define GPIO_DIR_MODE_IN        0x00000000
+#define GPIO_DIR_MODE_OUT       0x00000001
+
+#define GPIO_FALLING_EDGE       0x00000000
+#define GPIO_BOTH_EDGES         0x00000001
+#define GPIO_LOW_LEVEL          0x00000002
+#define GPIO_RISING_EDGE        0x00000004
+#define GPIO_HIGH_LEVEL         0x00000006
+
+#define GPIO_STRENGTH_2MA       0x00000001
+#define GPIO_STRENGTH_4MA       0x00000002
+#define GPIO_STRENGTH_6MA       0x00000065
+#define GPIO_PIN_TYPE_STD_WPU   0x0000000A
+#define GPIO_PIN_TYPE_STD_WPD   0x0000000C
+
+int32_t GPIOPinRead(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinWrite(uint32_t ui32Port, uint8_t ui8Pins, uint8_t ui8Val);
+void GPIODirModeSet(uint32_t ui32Port, uint8_t ui8Pins, uint32_t ui32PinIO);
+void GPIOPadConfigSet(uint32_t ui32Port, uint8_t ui8Pins, uint32_t ui32Strength, uint32_t ui32PadType);
+void GPIOIntTypeSet(uint32_t ui32Port, uint8_t ui8Pins, uint32_t ui32IntType);
+void GPIOIntEnable(uint32_t ui32Port, uint32_t ui32IntFlags);
+void GPIOIntDisable(uint32_t ui32Port, uint32_t ui32IntFlags);
+uint32_t GPIOIntStatus(uint32_t ui32Port, bool bMasked);
+void GPIOIntClear(uint32_t ui32Port, uint32_t ui32IntFlags);
+void GPIOIntRegister(uint32_t ui32Port, void (*pfnIntHandler)(void));
+void GPIOPinConfigure(uint32_t ui32PinConfig);
+void GPIOPinTypeGPIOInput(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinTypePWM(uint32_t ui32Port, uint8_t ui8Pins);
+void GPIOPinTypeUART(uint32_t ui32Port, uint8_t ui8Pins);
+
+#endif // __DRIVERLIB_GPIO_H__
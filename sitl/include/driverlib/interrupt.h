@@ -0,0 +1,27 @@
+#ifndef __DRIVERLIB_INTERRUPT_H__
+#define __DRIVERLIB_INTERRUPT_H__
+
+//*******************************************************************************
+// driverlib/interrupt.h (SITL)
+//
+// The NVIC, modelled by sitl/hal.c: handlers are called from the host with
+// the Cortex-M priority rules.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+bool IntMasterEnable(void);
+bool IntMasterDisable(void);
+void IntRegister(uint32_t ui32Interrupt, void (*pfnHandler)(void));
+void IntPriorityGroupingSet(uint32_t ui32Bits);
+void IntPrioritySet(uint32_t ui32Interrupt, uint8_t ui8Priority);
+void IntEnable(uint32_t ui32Interrupt);
+void IntDisable(uint32_t ui32Interrupt);
+void IntPendSet(uint32_t ui32Interrupt);
+
+#endif // __DRIVERLIB_INTERRUPT_H__
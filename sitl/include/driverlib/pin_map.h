@@ -0,0 +1,20 @@
+#ifndef __DRIVERLIB_PIN_MAP_H__
+#define __DRIVERLIB_PIN_MAP_H__
+
+//*******************************************************************************
+// driverlib/pin_map.h (SITL)
+//
+// Pin function selections. Only recorded, the SITL wires each peripheral to
+// its board pin directly.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#define GPIO_PA0_U0RX           0x00000001
+#define GPIO_PA1_U0TX           0x00000401
+#define GPIO_PC5_M0PWM7         0x00021404
+#define GPIO_PF1_M1PWM5         0x00050405
+
+#endif // __DRIVERLIB_PIN_MAP_H__
@@ -0,0 +1,63 @@
+#ifndef __DRIVERLIB_SYSCTL_H__
+#define __DRIVERLIB_SYSCTL_H__
+
+//*******************************************************************************
+// driverlib/sysctl.h (SITL)
+//
+// Clocking, peripheral control, delays and resets, see sitl/hal.c. A reset
+// restarts the SITL process, keeping the UART and no-init RAM.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SYSCTL_SYSDIV_2_5       0xC1000000
+#define SYSCTL_SYSDIV_4         0x01C00000
+#define SYSCTL_SYSDIV_5         0x02400000
+#define SYSCTL_SYSDIV_10        0x04C00000
+#define SYSCTL_USE_PLL          0x00000000
+#define SYSCTL_OSC_MAIN         0x00000000
+#define SYSCTL_XTAL_16MHZ       0x00000540
+
+#define SYSCTL_PWMDIV_1         0x00000000
+#define SYSCTL_PWMDIV_2         0x00100000
+#define SYSCTL_PWMDIV_4         0x00120000
+
+#define SYSCTL_PERIPH_WDOG0     0xf0000000
+#define SYSCTL_PERIPH_GPIOA     0xf0000800
+#define SYSCTL_PERIPH_GPIOB     0xf0000801
+#define SYSCTL_PERIPH_GPIOC     0xf0000802
+#define SYSCTL_PERIPH_GPIOD     0xf0000803
+#define SYSCTL_PERIPH_GPIOE     0xf0000804
+#define SYSCTL_PERIPH_GPIOF     0xf0000805
+#define SYSCTL_PERIPH_TIMER5    0xf0000405
+#define SYSCTL_PERIPH_UART0     0xf0001800
+#define SYSCTL_PERIPH_ADC0      0xf0003800
+#define SYSCTL_PERIPH_PWM0      0xf0004000
+#define SYSCTL_PERIPH_PWM1      0xf0004001
+#define SYSCTL_PERIPH_EEPROM0   0xf0005800
+
+#define SYSCTL_CAUSE_EXT        0x00000001
+#define SYSCTL_CAUSE_POR        0x00000002
+#define SYSCTL_CAUSE_BOR        0x00000004
+#define SYSCTL_CAUSE_WDOG0      0x00000008
+#define SYSCTL_CAUSE_SW         0x00000010
+
+void SysCtlClockSet(uint32_t ui32Config);
+uint32_t SysCtlClockGet(void);
+void SysCtlPWMClockSet(uint32_t ui32Config);
+void SysCtlPeripheralEnable(uint32_t ui32Peripheral);
+void SysCtlPeripheralReset(uint32_t ui32Peripheral);
+bool SysCtlPeripheralReady(uint32_t ui32Peripheral);
+void SysCtlPeripheralSleepEnable(uint32_t ui32Peripheral);
+void SysCtlDelay(uint32_t ui32Count);
+void SysCtlSleep(void);
+void SysCtlReset(void);
+uint32_t SysCtlResetCauseGet(void);
+void SysCtlResetCauseClear(uint32_t ui32Causes);
+
+#endif // __DRIVERLIB_SYSCTL_H__
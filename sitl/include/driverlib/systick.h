@@ -0,0 +1,23 @@
+#ifndef __DRIVERLIB_SYSTICK_H__
+#define __DRIVERLIB_SYSTICK_H__
+
+//*******************************************************************************
+// driverlib/systick.h (SITL)
+//
+// SysTick, counted from virtual time, see sitl/hal.c.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+
+void SysTickPeriodSet(uint32_t ui32Period);
+uint32_t SysTickPeriodGet(void);
+uint32_t SysTickValueGet(void);
+void SysTickIntRegister(void (*pfnHandler)(void));
+void SysTickIntEnable(void);
+void SysTickEnable(void);
+
+#endif // __DRIVERLIB_SYSTICK_H__
@@ -0,0 +1,27 @@
+#ifndef __DRIVERLIB_TIMER_H__
+#define __DRIVERLIB_TIMER_H__
+
+//*******************************************************************************
+// driverlib/timer.h (SITL)
+//
+// General purpose timers, only as the timestamp uses Timer 5: 32 bits,
+// periodic, counting up through the full range at the system clock in
+// virtual cycles, see sitl/hal.c.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TIMER_CFG_PERIODIC_UP   0x00000012
+#define TIMER_A                 0x000000FF
+
+void TimerConfigure(uint32_t ui32Base, uint32_t ui32Config);
+void TimerLoadSet(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Value);
+void TimerControlStall(uint32_t ui32Base, uint32_t ui32Timer, bool bStall);
+void TimerEnable(uint32_t ui32Base, uint32_t ui32Timer);
+
+#endif // __DRIVERLIB_TIMER_H__
@@ -0,0 +1,58 @@
+#ifndef __DRIVERLIB_UART_H__
+#define __DRIVERLIB_UART_H__
+
+//*******************************************************************************
+// driverlib/uart.h (SITL)
+//
+// The part of the TivaWare UART API the firmware uses, implemented by the
+// host HAL in sitl/periph.c with 16 byte FIFOs clocked at the baud rate.
+// The line is the SITL's pseudo-terminal.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define UART_INT_RX             0x00000010
+#define UART_INT_TX             0x00000020
+#define UART_INT_RT             0x00000040
+
+#define UART_CONFIG_WLEN_8      0x00000060
+#define UART_CONFIG_STOP_ONE    0x00000000
+#define UART_CONFIG_PAR_NONE    0x00000000
+
+#define UART_FIFO_TX1_8         0x00000000
+#define UART_FIFO_TX2_8         0x00000001
+#define UART_FIFO_TX4_8         0x00000002
+#define UART_FIFO_TX6_8         0x00000003
+#define UART_FIFO_TX7_8         0x00000004
+#define UART_FIFO_RX1_8         0x00000000
+#define UART_FIFO_RX2_8         0x00000008
+#define UART_FIFO_RX4_8         0x00000010
+#define UART_FIFO_RX6_8         0x00000018
+#define UART_FIFO_RX7_8         0x00000020
+
+#define UART_TXINT_MODE_FIFO    0x00000000
+#define UART_TXINT_MODE_EOT     0x00000010
+
+void UARTConfigSetExpClk(uint32_t ui32Base, uint32_t ui32UARTClk, uint32_t ui32Baud, uint32_t ui32Config);
+void UARTFIFOEnable(uint32_t ui32Base);
+void UARTFIFOLevelSet(uint32_t ui32Base, uint32_t ui32TxLevel, uint32_t ui32RxLevel);
+void UARTTxIntModeSet(uint32_t ui32Base, uint32_t ui32Mode);
+void UARTEnable(uint32_t ui32Base);
+bool UARTCharsAvail(uint32_t ui32Base);
+bool UARTSpaceAvail(uint32_t ui32Base);
+int32_t UARTCharGetNonBlocking(uint32_t ui32Base);
+bool UARTCharPutNonBlocking(uint32_t ui32Base, unsigned char ucData);
+void UARTCharPut(uint32_t ui32Base, unsigned char ucData);
+bool UARTBusy(uint32_t ui32Base);
+void UARTIntRegister(uint32_t ui32Base, void (*pfnHandler)(void));
+void UARTIntEnable(uint32_t ui32Base, uint32_t ui32IntFlags);
+void UARTIntDisable(uint32_t ui32Base, uint32_t ui32IntFlags);
+uint32_t UARTIntStatus(uint32_t ui32Base, bool bMasked);
+void UARTIntClear(uint32_t ui32Base, uint32_t ui32IntFlags);
+
+#endif // __DRIVERLIB_UART_H__
@@ -0,0 +1,28 @@
+#ifndef __DRIVERLIB_WATCHDOG_H__
+#define __DRIVERLIB_WATCHDOG_H__
+
+//*******************************************************************************
+// driverlib/watchdog.h (SITL)
+//
+// Watchdog 0, timed in virtual cycles; a second timeout without the
+// interrupt cleared resets the SITL, see sitl/hal.c.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+bool WatchdogLockState(uint32_t ui32Base);
+void WatchdogLock(uint32_t ui32Base);
+void WatchdogUnlock(uint32_t ui32Base);
+void WatchdogReloadSet(uint32_t ui32Base, uint32_t ui32LoadVal);
+void WatchdogResetEnable(uint32_t ui32Base);
+void WatchdogStallEnable(uint32_t ui32Base);
+void WatchdogEnable(uint32_t ui32Base);
+void WatchdogIntClear(uint32_t ui32Base);
+void WatchdogIntRegister(uint32_t ui32Base, void (*pfnHandler)(void));
+
+#endif // __DRIVERLIB_WATCHDOG_H__
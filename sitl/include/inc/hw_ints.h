@@ -0,0 +1,28 @@
+#ifndef __HW_INTS_H__
+#define __HW_INTS_H__
+
+//*******************************************************************************
+// inc/hw_ints.h (SITL)
+//
+// TM4C123 exception and interrupt numbers, as the HAL's vector table is
+// indexed.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#define FAULT_SYSTICK           15
+#define INT_GPIOA               16
+#define INT_GPIOB               17
+#define INT_GPIOC               18
+#define INT_GPIOD               19
+#define INT_GPIOE               20
+#define INT_UART0               21
+#define INT_ADC0SS3             33
+#define INT_WATCHDOG            34
+#define INT_GPIOF               46
+#define INT_PWM0_3              61
+#define NUM_INTERRUPTS          155
+
+#endif // __HW_INTS_H__
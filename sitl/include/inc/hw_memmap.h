@@ -0,0 +1,27 @@
+#ifndef __HW_MEMMAP_H__
+#define __HW_MEMMAP_H__
+
+//*******************************************************************************
+// inc/hw_memmap.h (SITL)
+//
+// Peripheral base addresses. On the host they only name a peripheral.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#define WATCHDOG0_BASE          0x40000000
+#define GPIO_PORTA_BASE         0x40004000
+#define GPIO_PORTB_BASE         0x40005000
+#define GPIO_PORTC_BASE         0x40006000
+#define GPIO_PORTD_BASE         0x40007000
+#define UART0_BASE              0x4000C000
+#define GPIO_PORTE_BASE         0x40024000
+#define GPIO_PORTF_BASE         0x40025000
+#define PWM0_BASE               0x40028000
+#define PWM1_BASE               0x40029000
+#define TIMER5_BASE             0x40035000
+#define ADC0_BASE               0x40038000
+
+#endif // __HW_MEMMAP_H__
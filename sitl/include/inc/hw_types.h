@@ -0,0 +1,18 @@
+#ifndef __HW_TYPES_H__
+#define __HW_TYPES_H__
+
+//*******************************************************************************
+// inc/hw_types.h (SITL)
+//
+// Register access. The firmware reaches no registers through HWREG, so it
+// is not provided on the host.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#endif // __HW_TYPES_H__
@@ -0,0 +1,25 @@
+#ifndef __TM4C123GH6PM_H__
+#define __TM4C123GH6PM_H__
+
+//*******************************************************************************
+// inc/tm4c123gh6pm.h (SITL)
+//
+// The few named registers the firmware writes, as host variables (see
+// sitl/periph.c).
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+
+extern volatile uint32_t sitlPortFLock;
+extern volatile uint32_t sitlPortFCommit;
+
+#define GPIO_PORTF_LOCK_R       sitlPortFLock
+#define GPIO_PORTF_CR_R         sitlPortFCommit
+#define GPIO_LOCK_M             0xFFFFFFFF
+#define GPIO_LOCK_KEY           0x4C4F434B
+
+#endif // __TM4C123GH6PM_H__
@@ -0,0 +1,26 @@
+#ifndef __USTDLIB_H__
+#define __USTDLIB_H__
+
+//*******************************************************************************
+// utils/ustdlib.h (SITL)
+//
+// TivaWare's small string library, on the host C library (see
+// sitl/board.c).
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdarg.h>
+
+int usprintf(char *s, const char *format, ...);
+int usnprintf(char *s, uint32_t size, const char *format, ...);
+int uvsnprintf(char *s, uint32_t size, const char *format, va_list arg);
+uint32_t ustrlen(const char *s);
+int ustrncmp(const char *s1, const char *s2, uint32_t n);
+uint32_t ustrtoul(const char *nptr, const char **endptr, int base);
+int32_t ustrtol(const char *nptr, const char **endptr, int base);
+
+#endif // __USTDLIB_H__
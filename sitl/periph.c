@@ -0,0 +1,783 @@
+//*******************************************************************************
+// periph.c
+//
+// Peripheral models for the SITL build: GPIO, the altitude ADC sequence, the
+// PWM generators and the UART, behind the TivaWare calls the firmware makes.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <math.h>
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "driverlib/adc.h"
+#include "driverlib/gpio.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/pwm.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/uart.h"
+#include "system.h"
+#include "clock.h"
+#include "hal.h"
+#include "periph.h"
+
+volatile uint32_t sitlPortFLock = 0;
+volatile uint32_t sitlPortFCommit = 0;
+
+//*****************************************************************************
+// GPIO. As on the part, an edge sets the raw status whether or not it is
+// enabled, and the port's interrupt is raised while raw & mask is set.
+//*****************************************************************************
+typedef struct {
+    uint32_t base;
+    uint32_t interrupt;
+    uint8_t level;
+    uint8_t bothEdges;       // GPIOIBE
+    uint8_t risingEdge;      // GPIOIEV
+    uint8_t mask;            // GPIOIM
+    uint8_t raw;             // GPIORIS
+} GpioPort;
+
+static GpioPort ports[] = {
+    { .base = GPIO_PORTA_BASE, .interrupt = INT_GPIOA },
+    { .base = GPIO_PORTB_BASE, .interrupt = INT_GPIOB },
+    { .base = GPIO_PORTC_BASE, .interrupt = INT_GPIOC },
+    { .base = GPIO_PORTD_BASE, .interrupt = INT_GPIOD },
+    { .base = GPIO_PORTE_BASE, .interrupt = INT_GPIOE },
+    { .base = GPIO_PORTF_BASE, .interrupt = INT_GPIOF }
+};
+#define NUM_PORTS  (sizeof(ports) / sizeof(ports[0]))
+
+static GpioPort*
+Port(uint32_t base)
+{
+    uint32_t i;
+
+    for (i = 0; i < NUM_PORTS; i++)
+    {
+        if (ports[i].base == base)
+        {
+            return &ports[i];
+        }
+    }
+    return &ports[0];
+}
+
+static void
+PortRaise(GpioPort* port)
+{
+    if (port->raw & port->mask)
+    {
+        SitlIntPend(port->interrupt);
+    }
+}
+
+void
+PeriphPinInit(uint32_t base, uint8_t pins, bool high)
+{
+    GpioPort* port = Port(base);
+
+    port->level = high ? (port->level | pins) : (port->level & ~pins);
+}
+
+void
+PeriphPinSet(uint32_t base, uint8_t pins, bool high)
+{
+    GpioPort* port = Port(base);
+    uint8_t level = high ? (port->level | pins) : (port->level & ~pins);
+    uint8_t changed = level ^ port->level;
+    uint8_t edges = changed & (port->bothEdges | (high ? port->risingEdge : ~port->risingEdge));
+
+    port->level = level;
+    if (edges)
+    {
+        port->raw |= edges;
+        PortRaise(port);
+    }
+}
+
+uint8_t
+PeriphPinLevels(uint32_t base)
+{
+    return Port(base)->level;
+}
+
+int32_t
+GPIOPinRead(uint32_t ui32Port, uint8_t ui8Pins)
+{
+    return Port(ui32Port)->level & ui8Pins;
+}
+
+void
+GPIOPinWrite(uint32_t ui32Port, uint8_t ui8Pins, uint8_t ui8Val)
+{
+    GpioPort* port = Port(ui32Port);
+
+    port->level = (port->level & ~ui8Pins) | (ui8Val & ui8Pins);
+}
+
+void
+GPIODirModeSet(uint32_t ui32Port, uint8_t ui8Pins, uint32_t ui32PinIO)
+{
+}
+
+void
+GPIOPadConfigSet(uint32_t ui32Port, uint8_t ui8Pins, uint32_t ui32Strength, uint32_t ui32PadType)
+{
+}
+
+void
+GPIOIntTypeSet(uint32_t ui32Port, uint8_t ui8Pins, uint32_t ui32IntType)
+{
+    GpioPort* port = Port(ui32Port);
+
+    port->bothEdges = (ui32IntType & GPIO_BOTH_EDGES) ? (port->bothEdges | ui8Pins) : (port->bothEdges & ~ui8Pins);
+    port->risingEdge = (ui32IntType & GPIO_RISING_EDGE) ? (port->risingEdge | ui8Pins) : (port->risingEdge & ~ui8Pins);
+}
+
+void
+GPIOIntEnable(uint32_t ui32Port, uint32_t ui32IntFlags)
+{
+    GpioPort* port = Port(ui32Port);
+
+    port->mask |= ui32IntFlags;
+    PortRaise(port);
+}
+
+void
+GPIOIntDisable(uint32_t ui32Port, uint32_t ui32IntFlags)
+{
+    Port(ui32Port)->mask &= ~ui32IntFlags;
+}
+
+uint32_t
+GPIOIntStatus(uint32_t ui32Port, bool bMasked)
+{
+    GpioPort* port = Port(ui32Port);
+
+    return bMasked ? (port->raw & port->mask) : port->raw;
+}
+
+void
+GPIOIntClear(uint32_t ui32Port, uint32_t ui32IntFlags)
+{
+    Port(ui32Port)->raw &= ~ui32IntFlags;
+}
+
+void
+GPIOIntRegister(uint32_t ui32Port, void (*pfnIntHandler)(void))
+{
+    GpioPort* port = Port(ui32Port);
+
+    IntRegister(port->interrupt, pfnIntHandler);
+    IntEnable(port->interrupt);
+}
+
+void
+GPIOPinConfigure(uint32_t ui32PinConfig)
+{
+}
+
+void
+GPIOPinTypeGPIOInput(uint32_t ui32Port, uint8_t ui8Pins)
+{
+}
+
+void
+GPIOPinTypePWM(uint32_t ui32Port, uint8_t ui8Pins)
+{
+}
+
+void
+GPIOPinTypeUART(uint32_t ui32Port, uint8_t ui8Pins)
+{
+}
+
+//*****************************************************************************
+// PWM. Two modules of four generators, each with two outputs. In up/down
+// mode the generator period is the full count, as the firmware uses it, and
+// each output's pulse is centred on the load, half way through the period.
+// A generator counts from zero when enabled or its time base is synced.
+//*****************************************************************************
+typedef struct {
+    uint32_t period;         // PWM clocks
+    uint32_t triggers;       // PWM_TR_CNT_ events enabled to the ADC
+    bool enabled;
+    uint64_t start;          // Cycle the count was last at zero
+    uint64_t nextTrigger;    // Cycle of the next ADC trigger
+} PwmGen;
+
+typedef struct {
+    uint32_t base;
+    PwmGen gens[4];
+    uint32_t width[8];
+    uint8_t outputs;         // PWM_OUT_n_BIT enabled
+} PwmModule;
+
+static PwmModule pwms[] = {
+    { .base = PWM0_BASE },
+    { .base = PWM1_BASE }
+};
+static uint32_t pwmDivider = 1;
+
+static void AdcTriggerFire(void);
+static ClockTimer adcTriggerTimer = CLOCK_TIMER(AdcTriggerFire);
+static void AdcTriggerArm(void);
+
+static PwmModule*
+Pwm(uint32_t base)
+{
+    return (base == PWM1_BASE) ? &pwms[1] : &pwms[0];
+}
+
+static PwmGen*
+Gen(uint32_t base, uint32_t gen)
+{
+    return &Pwm(base)->gens[((gen >> 6) - 1) & 3];
+}
+
+//*****************************************************************************
+// Cycles from the start of a period to the trigger event: zero at the start
+// of the up count, load half way, and the up count compare at its width.
+//*****************************************************************************
+static uint64_t
+TriggerPhase(PwmModule* module, uint32_t gen)
+{
+    PwmGen* g = &module->gens[gen];
+
+    if (g->triggers & PWM_TR_CNT_LOAD)
+    {
+        return (uint64_t)g->period * pwmDivider / 2;
+    }
+    if (g->triggers & PWM_TR_CNT_AU)
+    {
+        return (uint64_t)(g->period - module->width[gen * 2]) * pwmDivider / 2;
+    }
+    return 0;
+}
+
+void
+SysCtlPWMClockSet(uint32_t ui32Config)
+{
+    pwmDivider = (ui32Config & SYSCTL_PWMDIV_2) ? 2u << ((ui32Config >> 17) & 7) : 1;
+}
+
+void
+PWMGenConfigure(uint32_t ui32Base, uint32_t ui32Gen, uint32_t ui32Config)
+{
+}
+
+void
+PWMGenPeriodSet(uint32_t ui32Base, uint32_t ui32Gen, uint32_t ui32Period)
+{
+    Gen(ui32Base, ui32Gen)->period = ui32Period;
+    AdcTriggerArm();
+}
+
+uint32_t
+PWMGenPeriodGet(uint32_t ui32Base, uint32_t ui32Gen)
+{
+    return Gen(ui32Base, ui32Gen)->period;
+}
+
+void
+PWMGenEnable(uint32_t ui32Base, uint32_t ui32Gen)
+{
+    PwmModule* module = Pwm(ui32Base);
+    PwmGen* g = Gen(ui32Base, ui32Gen);
+
+    g->enabled = true;
+    g->start = sitlCycles;
+    g->nextTrigger = sitlCycles + TriggerPhase(module, g - module->gens);
+    AdcTriggerArm();
+}
+
+void
+PWMPulseWidthSet(uint32_t ui32Base, uint32_t ui32PWMOut, uint32_t ui32Width)
+{
+    Pwm(ui32Base)->width[ui32PWMOut & 7] = ui32Width;
+}
+
+void
+PWMOutputState(uint32_t ui32Base, uint32_t ui32PWMOutBits, bool bEnable)
+{
+    PwmModule* module = Pwm(ui32Base);
+
+    module->outputs = bEnable ? (module->outputs | ui32PWMOutBits) : (module->outputs & ~ui32PWMOutBits);
+}
+
+void
+PWMGenIntTrigEnable(uint32_t ui32Base, uint32_t ui32Gen, uint32_t ui32IntTrig)
+{
+    Gen(ui32Base, ui32Gen)->triggers |= ui32IntTrig;
+    AdcTriggerArm();
+}
+
+void
+PWMGenIntTrigDisable(uint32_t ui32Base, uint32_t ui32Gen, uint32_t ui32IntTrig)
+{
+    Gen(ui32Base, ui32Gen)->triggers &= ~ui32IntTrig;
+    AdcTriggerArm();
+}
+
+void
+PWMSyncUpdate(uint32_t ui32Base, uint32_t ui32GenBits)
+{
+}
+
+void
+PWMSyncTimeBase(uint32_t ui32Base, uint32_t ui32GenBits)
+{
+    PwmModule* module = Pwm(ui32Base);
+    uint32_t i;
+
+    for (i = 0; i < 4; i++)
+    {
+        if (ui32GenBits & (1u << i))
+        {
+            module->gens[i].start = sitlCycles;
+            module->gens[i].nextTrigger = sitlCycles + TriggerPhase(module, i);
+        }
+    }
+    AdcTriggerArm();
+}
+
+double
+PeriphPwmDuty(uint32_t base, uint32_t out)
+{
+    PwmModule* module = Pwm(base);
+    PwmGen* g = Gen(base, out & ~7u);
+    uint32_t index = out & 7;
+
+    if (!g->enabled || !(module->outputs & (1u << index)) || g->period == 0)
+    {
+        return 0.0;
+    }
+    return (double)module->width[index] / g->period;
+}
+
+double
+PeriphPwmTransient(uint64_t tau)
+{
+    double transient = 0.0;
+    uint32_t m, index;
+
+    for (m = 0; m < 2; m++)
+    {
+        PwmModule* module = &pwms[m];
+
+        for (index = 0; index < 8; index++)
+        {
+            PwmGen* g = &module->gens[index / 2];
+            uint64_t period = (uint64_t)g->period * pwmDivider;
+            uint64_t half = (uint64_t)module->width[index] * pwmDivider / 2;
+
+            if (!g->enabled || !(module->outputs & (1u << index)) || half == 0
+                || module->width[index] >= g->period)
+            {
+                continue;
+            }
+            uint64_t phase = (sitlCycles - g->start) % period;
+            uint64_t rising = (phase + period + half - period / 2) % period;    // Since the edge
+            uint64_t falling = (phase + period - half - period / 2) % period;
+            transient += exp(-(double)rising / tau) - exp(-(double)falling / tau);
+        }
+    }
+    return transient;
+}
+
+//*****************************************************************************
+// ADC0 sequence 3: a single step, converted on a processor or PWM trigger.
+// The result waits in a one entry FIFO; a second conversion before it is
+// read replaces it.
+//*****************************************************************************
+static struct {
+    uint32_t trigger;
+    bool enabled;
+    bool mask;
+    bool raw;
+    bool full;
+    uint32_t data;
+} adc;
+
+static void
+AdcConvert(void)
+{
+    if (!adc.enabled)
+    {
+        return;
+    }
+    adc.data = SitlAltitudeCounts();
+    adc.full = true;
+    adc.raw = true;
+    if (adc.mask)
+    {
+        SitlIntPend(INT_ADC0SS3);
+    }
+}
+
+//*****************************************************************************
+// A PWM trigger converts once a period of its generator, on PWM module 0.
+//*****************************************************************************
+static PwmGen*
+TriggerGen(void)
+{
+    if (adc.trigger < ADC_TRIGGER_PWM0 || adc.trigger > ADC_TRIGGER_PWM3)
+    {
+        return NULL;
+    }
+    PwmGen* g = &pwms[0].gens[adc.trigger - ADC_TRIGGER_PWM0];
+    return (g->enabled && g->triggers && g->period) ? g : NULL;
+}
+
+static void
+AdcTriggerArm(void)
+{
+    PwmGen* g = TriggerGen();
+
+    if (!g)
+    {
+        ClockStop(&adcTriggerTimer);
+        return;
+    }
+    uint64_t period = (uint64_t)g->period * pwmDivider;
+    if (g->nextTrigger < sitlCycles)
+    {
+        g->nextTrigger += (sitlCycles - g->nextTrigger + period - 1) / period * period;
+    }
+    ClockStart(&adcTriggerTimer, g->nextTrigger);
+}
+
+static void
+AdcTriggerFire(void)
+{
+    PwmGen* g = TriggerGen();
+
+    if (g)
+    {
+        g->nextTrigger += (uint64_t)g->period * pwmDivider;
+        ClockStart(&adcTriggerTimer, g->nextTrigger);
+        AdcConvert();
+    }
+}
+
+void
+ADCSequenceConfigure(uint32_t ui32Base, uint32_t ui32SequenceNum, uint32_t ui32Trigger, uint32_t ui32Priority)
+{
+    adc.trigger = ui32Trigger;
+    AdcTriggerArm();
+}
+
+void
+ADCSequenceStepConfigure(uint32_t ui32Base, uint32_t ui32SequenceNum, uint32_t ui32Step, uint32_t ui32Config)
+{
+}
+
+void
+ADCSequenceEnable(uint32_t ui32Base, uint32_t ui32SequenceNum)
+{
+    adc.enabled = true;
+}
+
+void
+ADCSequenceDisable(uint32_t ui32Base, uint32_t ui32SequenceNum)
+{
+    adc.enabled = false;
+}
+
+void
+ADCIntRegister(uint32_t ui32Base, uint32_t ui32SequenceNum, void (*pfnHandler)(void))
+{
+    IntRegister(INT_ADC0SS3, pfnHandler);
+    IntEnable(INT_ADC0SS3);
+}
+
+void
+ADCIntEnable(uint32_t ui32Base, uint32_t ui32SequenceNum)
+{
+    adc.raw = false;   // Clears any outstanding interrupt
+    adc.mask = true;
+}
+
+void
+ADCIntClear(uint32_t ui32Base, uint32_t ui32SequenceNum)
+{
+    adc.raw = false;
+}
+
+uint32_t
+ADCIntStatus(uint32_t ui32Base, uint32_t ui32SequenceNum, bool bMasked)
+{
+    return bMasked ? (adc.raw && adc.mask) : adc.raw;
+}
+
+void
+ADCProcessorTrigger(uint32_t ui32Base, uint32_t ui32SequenceNum)
+{
+    if (adc.trigger == ADC_TRIGGER_PROCESSOR)
+    {
+        AdcConvert();
+    }
+}
+
+int32_t
+ADCSequenceDataGet(uint32_t ui32Base, uint32_t ui32SequenceNum, uint32_t *pui32Buffer)
+{
+    if (!adc.full)
+    {
+        return 0;
+    }
+    *pui32Buffer = adc.data;
+    adc.full = false;
+    return 1;
+}
+
+//*****************************************************************************
+// UART0. Bytes leave the transmit FIFO and enter the receive FIFO one per
+// character time (ten bits), each the event of a timer. The transmit
+// interrupt is raised as the FIFO drains to its level; the receive
+// interrupt when it fills to its level, or, with bytes waiting, when none
+// has arrived for 32 bit times (the timeout). A full receive FIFO holds the
+// host's bytes back rather than overrunning.
+//*****************************************************************************
+#define UART_FIFO_SIZE  16
+
+static struct {
+    uint64_t charCycles;
+    uint32_t mask;
+    uint32_t raw;
+    uint32_t txLevel;
+    uint32_t rxLevel;
+    uint8_t tx[UART_FIFO_SIZE];
+    uint8_t rx[UART_FIFO_SIZE];
+    uint32_t txHead, txCount;
+    uint32_t rxHead, rxCount;
+} uart = { .charCycles = SYSTEM_CLOCK_HZ / 11520, .txLevel = 2, .rxLevel = 8 };
+
+static void UartTxFire(void);
+static void UartRxFire(void);
+static void UartTimeoutFire(void);
+static ClockTimer uartTxTimer = CLOCK_TIMER(UartTxFire);
+static ClockTimer uartRxTimer = CLOCK_TIMER(UartRxFire);
+static ClockTimer uartTimeoutTimer = CLOCK_TIMER(UartTimeoutFire);
+
+// Host side of the line
+static uint8_t lineIn[SITL_UART_BUF_SIZE];
+static uint32_t lineInHead, lineInCount;
+static uint8_t lineOut[SITL_UART_BUF_SIZE];
+static uint32_t lineOutCount;
+
+static void
+UartRaise(uint32_t flags)
+{
+    uart.raw |= flags;
+    if (uart.raw & uart.mask)
+    {
+        SitlIntPend(INT_UART0);
+    }
+}
+
+static void
+UartTxFire(void)
+{
+    if (lineOutCount < SITL_UART_BUF_SIZE)
+    {
+        lineOut[lineOutCount++] = uart.tx[uart.txHead];
+    }
+    uart.txHead = (uart.txHead + 1) % UART_FIFO_SIZE;
+    if (--uart.txCount)
+    {
+        ClockStart(&uartTxTimer, sitlCycles + uart.charCycles);
+    }
+    if (uart.txCount == uart.txLevel)
+    {
+        UartRaise(UART_INT_TX);   // May refill the FIFO
+    }
+}
+
+static void
+UartRxFire(void)
+{
+    if (uart.rxCount < UART_FIFO_SIZE)
+    {
+        uart.rx[(uart.rxHead + uart.rxCount++) % UART_FIFO_SIZE] = lineIn[lineInHead];
+        lineInHead = (lineInHead + 1) % SITL_UART_BUF_SIZE;
+        lineInCount--;
+        ClockStart(&uartTimeoutTimer, sitlCycles + uart.charCycles * 32 / 10);
+    }
+    if (lineInCount)
+    {
+        ClockStart(&uartRxTimer, sitlCycles + uart.charCycles);
+    }
+    if (uart.rxCount >= uart.rxLevel)
+    {
+        UartRaise(UART_INT_RX);
+    }
+}
+
+static void
+UartTimeoutFire(void)
+{
+    if (uart.rxCount)
+    {
+        UartRaise(UART_INT_RT);
+    }
+}
+
+uint32_t
+PeriphUartGive(const uint8_t* data, uint32_t count)
+{
+    uint32_t taken = 0;
+
+    while (taken < count && lineInCount < SITL_UART_BUF_SIZE)
+    {
+        lineIn[(lineInHead + lineInCount++) % SITL_UART_BUF_SIZE] = data[taken++];
+    }
+    if (lineInCount && !ClockRunning(&uartRxTimer))
+    {
+        ClockStart(&uartRxTimer, sitlCycles + uart.charCycles);
+    }
+    return taken;
+}
+
+uint32_t
+PeriphUartTake(uint8_t* data, uint32_t max)
+{
+    uint32_t count = (lineOutCount < max) ? lineOutCount : max;
+    uint32_t i;
+
+    for (i = 0; i < count; i++)
+    {
+        data[i] = lineOut[i];
+    }
+    for (i = count; i < lineOutCount; i++)
+    {
+        lineOut[i - count] = lineOut[i];
+    }
+    lineOutCount -= count;
+    return count;
+}
+
+void
+UARTConfigSetExpClk(uint32_t ui32Base, uint32_t ui32UARTClk, uint32_t ui32Baud, uint32_t ui32Config)
+{
+    uart.charCycles = (uint64_t)ui32UARTClk * 10 / ui32Baud;
+}
+
+void
+UARTFIFOEnable(uint32_t ui32Base)
+{
+}
+
+void
+UARTFIFOLevelSet(uint32_t ui32Base, uint32_t ui32TxLevel, uint32_t ui32RxLevel)
+{
+    static const uint8_t eighths[] = {1, 2, 4, 6, 7};
+
+    uart.txLevel = UART_FIFO_SIZE * eighths[ui32TxLevel % 5] / 8;
+    uart.rxLevel = UART_FIFO_SIZE * eighths[(ui32RxLevel >> 3) % 5] / 8;
+}
+
+void
+UARTTxIntModeSet(uint32_t ui32Base, uint32_t ui32Mode)
+{
+}
+
+void
+UARTEnable(uint32_t ui32Base)
+{
+}
+
+bool
+UARTCharsAvail(uint32_t ui32Base)
+{
+    return uart.rxCount != 0;
+}
+
+bool
+UARTSpaceAvail(uint32_t ui32Base)
+{
+    return uart.txCount < UART_FIFO_SIZE;
+}
+
+int32_t
+UARTCharGetNonBlocking(uint32_t ui32Base)
+{
+    int32_t c;
+
+    if (!uart.rxCount)
+    {
+        return -1;
+    }
+    c = uart.rx[uart.rxHead];
+    uart.rxHead = (uart.rxHead + 1) % UART_FIFO_SIZE;
+    uart.rxCount--;
+    return c;
+}
+
+bool
+UARTCharPutNonBlocking(uint32_t ui32Base, unsigned char ucData)
+{
+    if (uart.txCount >= UART_FIFO_SIZE)
+    {
+        return false;
+    }
+    uart.tx[(uart.txHead + uart.txCount++) % UART_FIFO_SIZE] = ucData;
+    if (!ClockRunning(&uartTxTimer))
+    {
+        ClockStart(&uartTxTimer, sitlCycles + uart.charCycles);
+    }
+    return true;
+}
+
+void
+UARTCharPut(uint32_t ui32Base, unsigned char ucData)
+{
+    while (!UARTCharPutNonBlocking(ui32Base, ucData))
+    {
+        SitlAdvance(uart.charCycles);
+    }
+}
+
+bool
+UARTBusy(uint32_t ui32Base)
+{
+    return uart.txCount != 0;
+}
+
+void
+UARTIntRegister(uint32_t ui32Base, void (*pfnHandler)(void))
+{
+    IntRegister(INT_UART0, pfnHandler);
+    IntEnable(INT_UART0);
+}
+
+void
+UARTIntEnable(uint32_t ui32Base, uint32_t ui32IntFlags)
+{
+    uart.mask |= ui32IntFlags;
+    UartRaise(0);
+}
+
+void
+UARTIntDisable(uint32_t ui32Base, uint32_t ui32IntFlags)
+{
+    uart.mask &= ~ui32IntFlags;
+}
+
+uint32_t
+UARTIntStatus(uint32_t ui32Base, bool bMasked)
+{
+    return bMasked ? (uart.raw & uart.mask) : uart.raw;
+}
+
+void
+UARTIntClear(uint32_t ui32Base, uint32_t ui32IntFlags)
+{
+    uart.raw &= ~ui32IntFlags;
+}
@@ -0,0 +1,48 @@
+#ifndef PERIPH_H_
+#define PERIPH_H_
+
+//*******************************************************************************
+// periph.c
+//
+// Peripheral models for the SITL build: GPIO ports with edge interrupts, the
+// ADC sequence the altitude is sampled on, the PWM generators and the UART.
+// Each implements the TivaWare calls the firmware makes, and runs its own
+// timers (clock.h) for what it does as time passes. The ADC converts the
+// plant's altitude sensor on each trigger of its PWM generator. The UART
+// moves bytes between its 16 byte FIFOs and the host at the baud rate, with
+// the FIFO level and receive timeout interrupts of the real one.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SITL_UART_BUF_SIZE   4096   // Host side of the line, each direction
+
+//*****************************************************************************
+// Drives input pins of a port high or low, raising edge interrupts as
+// configured. PeriphPinInit sets the power on level without any edge.
+void PeriphPinSet(uint32_t port, uint8_t pins, bool high);
+void PeriphPinInit(uint32_t port, uint8_t pins, bool high);
+uint8_t PeriphPinLevels(uint32_t port);
+
+//*****************************************************************************
+// Duty (0 to 1) of a PWM output, 0 unless its generator and output are on.
+double PeriphPwmDuty(uint32_t base, uint32_t out);
+
+//*****************************************************************************
+// Switching transient of the PWM outputs now: for each output running, its
+// last rising edge contributes +1 and its last falling edge -1, each decayed
+// by exp(-t / tau), t the cycles since the edge.
+double PeriphPwmTransient(uint64_t tau);
+
+//*****************************************************************************
+// The host side of the UART. PeriphUartGive queues received bytes, taking as
+// many as there is room for; PeriphUartTake collects transmitted ones.
+uint32_t PeriphUartGive(const uint8_t* data, uint32_t count);
+uint32_t PeriphUartTake(uint8_t* data, uint32_t max);
+
+#endif /* PERIPH_H_ */
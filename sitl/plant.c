@@ -0,0 +1,121 @@
+//*******************************************************************************
+// plant.c
+//
+// Model of the helicopter on its stand for the SITL build: rotor lags, lift
+// and drag, yaw against the reaction torque, and the sensors the firmware
+// reads.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include "plant.h"
+
+PlantConfig plantConfig = {
+    .hover = 0.48,
+    .yawStart = -37.0,
+    .noise = 3.0,
+    .spike = 0.0,
+    .seed = 1
+};
+
+PlantState plant;
+
+void
+PlantInit(void)
+{
+    plant = (PlantState) {
+        .yaw = plantConfig.yawStart,
+        .random = plantConfig.seed ? plantConfig.seed : 1
+    };
+}
+
+//*****************************************************************************
+// Semi-implicit Euler: rates first, then positions from the new rates. The
+// helicopter rests on the ground and stops at the top of the stand.
+//*****************************************************************************
+void
+PlantStep(double dt, double mainDuty, double tailDuty)
+{
+    plant.mainSpeed += (mainDuty - plant.mainSpeed) * dt / PLANT_MAIN_TAU_S;
+    plant.tailSpeed += (tailDuty - plant.tailSpeed) * dt / PLANT_TAIL_TAU_S;
+
+    plant.climb += (PLANT_LIFT * (plant.mainSpeed - plantConfig.hover)
+                    - PLANT_CLIMB_DRAG * plant.climb) * dt;
+    plant.altitude += plant.climb * dt;
+    if (plant.altitude <= 0.0)
+    {
+        plant.altitude = 0.0;
+        plant.climb = (plant.climb > 0.0) ? plant.climb : 0.0;
+    }
+    else if (plant.altitude >= PLANT_ALT_MAX)
+    {
+        plant.altitude = PLANT_ALT_MAX;
+        plant.climb = (plant.climb < 0.0) ? plant.climb : 0.0;
+    }
+
+    plant.yawRate += (PLANT_YAW_TORQUE * (plant.tailSpeed - PLANT_COUPLING * plant.mainSpeed)
+                      - PLANT_YAW_DRAG * plant.yawRate) * dt;
+    plant.yaw += plant.yawRate * dt;
+}
+
+//*****************************************************************************
+// Standard normal deviate from an xorshift generator (Box-Muller), so a run
+// is the same every time for a given seed.
+//*****************************************************************************
+static double
+Uniform(void)
+{
+    plant.random ^= plant.random << 13;
+    plant.random ^= plant.random >> 7;
+    plant.random ^= plant.random << 17;
+    return ((plant.random >> 11) + 0.5) / 9007199254740992.0;
+}
+
+static double
+Gaussian(void)
+{
+    double u = Uniform();
+    double v = Uniform();
+
+    return sqrt(-2.0 * log(u)) * cos(6.283185307179586 * v);
+}
+
+uint32_t
+PlantAltitudeCounts(double altitude, double transient)
+{
+    double counts = PLANT_GROUND_COUNTS - altitude * PLANT_COUNTS_PER_100 / 100.0
+                    + plantConfig.noise * Gaussian() + plantConfig.spike * transient;
+
+    if (counts < 0.0)
+    {
+        return 0;
+    }
+    if (counts > 4095.0)
+    {
+        return 4095;
+    }
+    return (uint32_t)lround(counts);
+}
+
+int32_t
+PlantYawCount(void)
+{
+    return (int32_t)floor(plant.yaw * PLANT_YAW_COUNTS / 360.0 + 0.5);
+}
+
+bool
+PlantAtReference(int32_t count)
+{
+    count %= PLANT_YAW_COUNTS;
+
+    if (count < 0)
+    {
+        count += PLANT_YAW_COUNTS;
+    }
+    return count <= PLANT_REF_HALF_WIDTH || count >= PLANT_YAW_COUNTS - PLANT_REF_HALF_WIDTH;
+}
@@ -0,0 +1,78 @@
+#ifndef PLANT_H_
+#define PLANT_H_
+
+//*******************************************************************************
+// plant.c
+//
+// Model of the helicopter on its stand for the SITL build. Each rotor's
+// speed follows its PWM duty with a first order lag. The main rotor lifts
+// against gravity, with drag, between the ground and the top of the stand.
+// The tail rotor turns the helicopter against the main rotor's reaction
+// torque, with drag. The sensors are those the firmware reads: the altitude
+// as ADC counts with noise, and with a transient after each edge of the rotor
+// PWM, the quadrature count of the yaw disc and the reference slot.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+#define PLANT_MAIN_TAU_S        0.25     // Rotor speed lags, seconds
+#define PLANT_TAIL_TAU_S        0.10
+#define PLANT_LIFT              400.0    // Climb acceleration (%/s^2) per unit speed above hover
+#define PLANT_CLIMB_DRAG        1.5      // Per second
+#define PLANT_ALT_MAX           105.0    // Top of the stand (%)
+#define PLANT_YAW_TORQUE        2000.0   // Yaw acceleration (deg/s^2) per unit net tail speed
+#define PLANT_YAW_DRAG          4.0      // Per second
+#define PLANT_COUPLING          0.8      // Tail speed that balances unit main speed
+#define PLANT_GROUND_COUNTS     2480     // ADC counts landed
+#define PLANT_COUNTS_PER_100    1241     // ADC counts from the ground to 100%
+#define PLANT_YAW_COUNTS        448      // Quadrature counts per turn
+#define PLANT_REF_HALF_WIDTH    3        // Counts each side of the reference slot centre
+#define PLANT_SPIKE_TAU_S       30e-6    // Decay of the altitude transient at a PWM edge
+
+typedef struct {
+    double hover;            // Main duty that holds altitude (0 to 1)
+    double yawStart;         // Degrees from the reference at power on
+    double noise;            // Altitude ADC noise, counts RMS
+    double spike;            // Altitude ADC step at a PWM edge, counts
+    uint64_t seed;
+} PlantConfig;
+
+typedef struct {
+    double altitude;         // % of the stand
+    double climb;            // %/s
+    double mainSpeed;        // 0 to 1
+    double tailSpeed;
+    double yaw;              // Degrees from the reference, unwrapped
+    double yawRate;          // deg/s
+    uint64_t random;         // Noise generator state
+} PlantState;
+
+extern PlantConfig plantConfig;
+extern PlantState plant;
+
+//*****************************************************************************
+// Starts the plant landed, at rest, at the configured yaw.
+void PlantInit(void);
+
+//*****************************************************************************
+// Advances the plant by dt seconds with the given duties (0 to 1).
+void PlantStep(double dt, double mainDuty, double tailDuty);
+
+//*****************************************************************************
+// Sensors: the ADC reading, with noise, for an altitude and the switching
+// transient there (edges, each decayed, rising +1, falling -1; see
+// PeriphPwmTransient), the quadrature count and whether the reference slot
+// is in front of its sensor at a given count.
+uint32_t PlantAltitudeCounts(double altitude, double transient);
+int32_t PlantYawCount(void);
+bool PlantAtReference(int32_t count);
+
+#endif /* PLANT_H_ */
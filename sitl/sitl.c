@@ -0,0 +1,1038 @@
+//*******************************************************************************
+// sitl.c
+//
+// Software in the loop. The firmware's own kernel, mode, controller and UART
+// code, built for the host (see Makefile) and flown against the plant model
+// in plant.c. The UART is a pseudo-terminal, so ground tools open it like the
+// board's serial port and see exactly what the board sends: the status and
+// diagnostic lines, recorder and trace dumps, and the replies to commands.
+// Bytes pass through unchanged at the baud rate.
+//
+// Virtual time moves from event to event (clock.h), paced against the wall
+// clock, or as fast as the host allows with --fast. Either way a run with
+// the same inputs at the same virtual times gives the same output. On exit
+// the simulated seconds per wall clock second and the events run are
+// reported, the measure of the engine's speed.
+//
+//   heli-sitl [options]
+//     --fast              Run as fast as possible, not in real time
+//     --speed <x>         Real time multiple (default 1)
+//     --time <s>          Stop after s seconds of virtual time
+//     --link <path>       Make path a symlink to the pseudo-terminal
+//     --log <file>        Also write everything the UART sends to file
+//     --sw1               Power on with SW1 up
+//     --eeprom <file>     Keep the EEPROM in file between runs
+//     --hover <%>         Plant: main duty that hovers (default 48)
+//     --yaw <deg>         Plant: yaw from the reference at power on (-37)
+//     --noise <counts>    Plant: altitude ADC noise (3)
+//     --spike <counts>    Plant: altitude ADC step at a rotor PWM edge (0)
+//     --seed <n>          Plant: noise seed (1)
+//     --replay <file>     Load a flight recorder dump for the replay command
+//
+// The switches and buttons are worked from the console (standard input), one
+// command a line. "@<ms> " before a command holds it, and those after it,
+// until that virtual time, so a script gives the same run every time.
+// Lines starting with # are comments.
+//   sw1 <0|1>                     Mode switch down or up
+//   reset                         Press SW2, the reset switch
+//   up|down|left|right [n]        Press a button n times (default 1)
+//   uart <text>                   Send text and a newline to the UART, as
+//                                 a ground tool on the pseudo-terminal would
+//   replay                        Start the loaded recording from now
+//   state                         Print the plant and the OLED
+//   quit
+//
+// A replay feeds a flight recorder dump (recorder.h), the CSV tools/recdump.py
+// makes of it, through the pins and the ADC in place of the plant and the
+// console: each record is applied at its time after the replay command, and
+// from then on the sensors and switches hold the levels last replayed. The
+// SysTick records are not needed, the SITL keeping its own. Replaying the
+// same dump from the same script gives the same output every time, as any
+// run does, and at whatever speed --fast allows.
+//
+// A reset restarts the process, as a reset restarts the processor, keeping
+// the pseudo-terminal, the plant, virtual time, the EEPROM and no-init RAM.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "inc/hw_memmap.h"
+#include "driverlib/gpio.h"
+#include "driverlib/pin_map.h"
+#include "driverlib/pwm.h"
+#include "driverlib/sysctl.h"
+#include "buttons4.h"
+#include "mode.h"
+#include "recorder.h"
+#include "rotors.h"
+#include "system.h"
+#include "clock.h"
+#include "hal.h"
+#include "periph.h"
+#include "plant.h"
+#include "board.h"
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+#define SITL_RESUME_MAGIC    0x53544C31   // 'STL1'
+#define CONSOLE_BUF_SIZE     1024
+#define MAX_ACTIONS          64
+#define MAX_EDGES            64
+#define PLANT_CYCLES         (SYSTEM_CLOCK_HZ / 4000)    // Plant step, 250 us
+#define IO_CYCLES            (SYSTEM_CLOCK_HZ / 1000)    // Host I/O and pacing, 1 ms
+#define FAST_IO_CYCLES       (SYSTEM_CLOCK_HZ / 100)     // Host I/O unpaced, 10 ms
+#define PRESS_MS             50           // Button held, then released as long
+#define RESET_PRESS_MS       20
+#define MS_CYCLES            (SYSTEM_CLOCK_HZ / 1000)
+#define REPLAY_MAX_RECORDS   65536
+
+int FirmwareMain(void);   // The firmware's main, renamed by the Makefile
+
+// Options
+static bool fast = false;
+static double speed = 1.0;
+static uint64_t stopCycles = 0;
+static const char* linkPath = NULL;
+static const char* logPath = NULL;
+static FILE* logFile = NULL;
+static bool sw1 = false;
+static const char* replayPath = NULL;
+static char** restartArgs;   // Command line for a reset, --resume added
+
+// Pseudo-terminal
+static int ptyMaster = -1;
+static int ptySlave = -1;    // Held open so the line stays up between clients
+static uint8_t ptyIn[256];
+static uint32_t ptyInStart, ptyInCount;
+static uint64_t lineDropped = 0;
+
+// Console
+static char console[CONSOLE_BUF_SIZE];
+static uint32_t consoleCount = 0;
+static bool consoleOpen = true;
+
+// Pin changes due at a virtual time, in time order
+typedef struct {
+    uint64_t at;
+    uint32_t port;
+    uint8_t pins;
+    bool high;
+} Action;
+static Action actions[MAX_ACTIONS];
+static uint32_t actionCount = 0;
+
+// Quadrature edges due within the present plant step, in time order
+typedef struct {
+    uint64_t at;
+    int32_t count;           // Count the edge moves to
+} Edge;
+static Edge edges[MAX_EDGES];
+static uint32_t edgeHead, edgeCount;
+static int32_t edgeLast;     // Count after the last edge queued
+
+// Recorded inputs, from --replay
+typedef struct {
+    uint64_t at;             // Cycles after the first record
+    uint8_t source;          // RecSource
+    uint16_t value;
+} ReplayInput;
+static ReplayInput* replayInputs;
+static uint32_t replayCount;
+static uint32_t replayNext;  // First input not yet applied
+static uint64_t replayStart; // Virtual time of the first input
+static bool replaying;       // Inputs come from the recording, not the plant
+static uint16_t replayAdc;
+static bool replayAdcSeen;
+
+// The plant runs a step ahead; sensors interpolate across it
+static uint64_t plantStepStart;
+static double altitudeBefore;
+static double yawBefore;     // Counts, unrounded
+
+static void PlantFire(void);
+static void EdgeFire(void);
+static void ActionFire(void);
+static void IoFire(void);
+static void StopFire(void);
+static void ConsoleFire(void);
+static void ReplayFire(void);
+static void Replay(void);
+static ClockTimer plantTimer = CLOCK_TIMER(PlantFire);
+static ClockTimer edgeTimer = CLOCK_TIMER(EdgeFire);
+static ClockTimer actionTimer = CLOCK_TIMER(ActionFire);
+static ClockTimer ioTimer = CLOCK_TIMER(IoFire);
+static ClockTimer stopTimer = CLOCK_TIMER(StopFire);
+static ClockTimer consoleTimer = CLOCK_TIMER(ConsoleFire);
+static ClockTimer replayTimer = CLOCK_TIMER(ReplayFire);
+
+// Pacing
+static uint64_t anchorCycles;
+static struct timespec anchorWall;
+static struct timespec startWall;
+
+static int32_t quadCount;    // Quadrature count the pins show
+
+typedef struct {
+    uint32_t magic;
+    uint32_t cause;
+    int32_t ptyMaster;
+    int32_t ptySlave;
+    bool sw1;
+    uint32_t consoleCount;
+    struct timespec startWall;
+    uint32_t actionCount;
+    uint64_t events;
+    bool replaying;
+    uint32_t replayNext;
+    uint64_t replayStart;
+    uint16_t replayAdc;
+    bool replayAdcSeen;
+} ResumeHeader;
+
+//*****************************************************************************
+// Wall clock
+//*****************************************************************************
+static double
+Seconds(const struct timespec* t)
+{
+    return t->tv_sec + t->tv_nsec * 1e-9;
+}
+
+static void
+Finish(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double wall = Seconds(&now) - Seconds(&startWall);
+    double virt = (double)sitlCycles / SYSTEM_CLOCK_HZ;
+    fprintf(stderr, "SITL: %.3f s simulated in %.3f s (%.1fx), %llu events (%.2f M/s), "
+            "%llu bytes dropped\n",
+            virt, wall, wall > 0.0 ? virt / wall : 0.0, (unsigned long long)clockEvents,
+            wall > 0.0 ? clockEvents / wall * 1e-6 : 0.0, (unsigned long long)lineDropped);
+    if (linkPath)
+    {
+        unlink(linkPath);
+    }
+    if (logFile)
+    {
+        fclose(logFile);
+    }
+    exit(0);
+}
+
+//*****************************************************************************
+// Inputs
+//*****************************************************************************
+static void
+Schedule(uint64_t at, uint32_t port, uint8_t pins, bool high)
+{
+    uint32_t i;
+
+    if (actionCount == MAX_ACTIONS)
+    {
+        fprintf(stderr, "SITL: too many inputs queued\n");
+        return;
+    }
+    for (i = actionCount; i > 0 && actions[i - 1].at > at; i--)
+    {
+        actions[i] = actions[i - 1];
+    }
+    actions[i] = (Action) { at, port, pins, high };
+    actionCount++;
+    ClockStart(&actionTimer, actions[0].at);
+}
+
+static void
+ActionFire(void)
+{
+    uint32_t done = 0;
+    uint32_t i;
+
+    while (done < actionCount && actions[done].at <= sitlCycles)
+    {
+        PeriphPinSet(actions[done].port, actions[done].pins, actions[done].high);
+        done++;
+    }
+    for (i = done; i < actionCount; i++)
+    {
+        actions[i - done] = actions[i];
+    }
+    actionCount -= done;
+    if (actionCount)
+    {
+        ClockStart(&actionTimer, actions[0].at);
+    }
+}
+
+static void
+Press(uint32_t port, uint8_t pin, bool normal, int count)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+    {
+        uint64_t at = sitlCycles + (uint64_t)i * 2 * PRESS_MS * MS_CYCLES;
+        Schedule(at, port, pin, !normal);
+        Schedule(at + PRESS_MS * MS_CYCLES, port, pin, normal);
+    }
+}
+
+static void
+PrintState(void)
+{
+    int row;
+
+    fprintf(stderr, "SITL: t %.3f s, alt %.1f%%, climb %.1f%%/s, yaw %.1f deg, rate %.1f deg/s, "
+            "main %.1f%%, tail %.1f%%\n",
+            (double)sitlCycles / SYSTEM_CLOCK_HZ, plant.altitude, plant.climb, plant.yaw,
+            plant.yawRate, 100.0 * plant.mainSpeed, 100.0 * plant.tailSpeed);
+    for (row = 0; row < OLED_ROWS; row++)
+    {
+        fprintf(stderr, "SITL: |%s|\n", oledText[row]);
+    }
+}
+
+//*****************************************************************************
+// Runs one console command.
+//*****************************************************************************
+static void
+Command(char* line)
+{
+    char* name = strtok(line, " \t");
+    char* rest = strtok(NULL, "");   // All after the name, for uart
+    char* arg;
+    int count;
+
+    if (!name || name[0] == '#')
+    {
+        return;
+    }
+    if (!strcmp(name, "uart"))
+    {
+        char text[CONSOLE_BUF_SIZE + 2];
+        uint32_t length;
+
+        rest = rest ? rest + strspn(rest, " \t") : "";
+        length = snprintf(text, sizeof(text), "%s\r\n", rest);
+        if (PeriphUartGive((const uint8_t*)text, length) < length)
+        {
+            fprintf(stderr, "SITL: UART input full, \"%s\" cut short\n", rest);
+        }
+        return;
+    }
+
+    arg = rest ? strtok(rest, " \t") : NULL;
+    count = arg ? atoi(arg) : 1;
+    if (!strcmp(name, "sw1"))
+    {
+        sw1 = arg && atoi(arg);
+        PeriphPinSet(SW_PORT, SW1_PIN, sw1);
+    }
+    else if (!strcmp(name, "reset"))
+    {
+        Schedule(sitlCycles, SW_PORT, SW2_PIN, true);
+        Schedule(sitlCycles + RESET_PRESS_MS * MS_CYCLES, SW_PORT, SW2_PIN, false);
+    }
+    else if (!strcmp(name, "up"))
+    {
+        Press(UP_BUT_PORT_BASE, UP_BUT_PIN, UP_BUT_NORMAL, count);
+    }
+    else if (!strcmp(name, "down"))
+    {
+        Press(DOWN_BUT_PORT_BASE, DOWN_BUT_PIN, DOWN_BUT_NORMAL, count);
+    }
+    else if (!strcmp(name, "left"))
+    {
+        Press(LEFT_BUT_PORT_BASE, LEFT_BUT_PIN, LEFT_BUT_NORMAL, count);
+    }
+    else if (!strcmp(name, "right"))
+    {
+        Press(RIGHT_BUT_PORT_BASE, RIGHT_BUT_PIN, RIGHT_BUT_NORMAL, count);
+    }
+    else if (!strcmp(name, "replay"))
+    {
+        Replay();
+    }
+    else if (!strcmp(name, "state"))
+    {
+        PrintState();
+    }
+    else if (!strcmp(name, "quit"))
+    {
+        Finish();
+    }
+    else
+    {
+        fprintf(stderr, "SITL: unknown command \"%s\"\n", name);
+    }
+}
+
+//*****************************************************************************
+// Runs the complete console lines, stopping at one held for a later time,
+// which is run by the console timer when that time comes.
+//*****************************************************************************
+static void
+RunConsole(void)
+{
+    char* end;
+
+    while ((end = memchr(console, '\n', consoleCount)) != NULL)
+    {
+        char* line = console;
+        uint32_t length = end - console + 1;
+
+        *end = '\0';
+        if (line[0] == '@')
+        {
+            char* rest;
+            uint64_t at = strtoull(line + 1, &rest, 10) * MS_CYCLES;
+            if (at > sitlCycles)
+            {
+                *end = '\n';
+                ClockStart(&consoleTimer, at);   // Run on time, whatever the pacing
+                return;
+            }
+            line = rest;
+        }
+        Command(line);
+        memmove(console, console + length, consoleCount - length);
+        consoleCount -= length;
+    }
+    if (!consoleOpen && consoleCount && consoleCount < CONSOLE_BUF_SIZE)
+    {
+        console[consoleCount++] = '\n';   // Last line had no newline
+    }
+}
+
+//*****************************************************************************
+// Host I/O, and in real time the wait for the wall clock to catch up with
+// virtual time. The pseudo-terminal is read only as fast as the UART takes
+// the bytes, so a client writing a burst is held back as by flow control.
+// Bytes sent with nobody reading are dropped once the line's buffer is full,
+// as a board's would be lost.
+//*****************************************************************************
+static void
+Io(void)
+{
+    struct pollfd fds[2];
+    struct timespec target = { 0, 0 };
+    uint8_t out[SITL_UART_BUF_SIZE];
+    uint32_t count = PeriphUartTake(out, sizeof(out));
+
+    if (count && write(ptyMaster, out, count) != (ssize_t)count)
+    {
+        lineDropped += count;   // Short writes do not happen on a non-blocking pty
+    }
+    if (count && logFile)
+    {
+        fwrite(out, 1, count, logFile);
+    }
+
+    if (!fast)
+    {
+        double ahead = (double)(sitlCycles - anchorCycles) / (SYSTEM_CLOCK_HZ * speed);
+        double at = Seconds(&anchorWall) + ahead;
+        target.tv_sec = (time_t)at;
+        target.tv_nsec = (long)((at - target.tv_sec) * 1e9);
+    }
+
+    for (;;)
+    {
+        struct timespec timeout = { 0, 0 };
+
+        if (!fast)
+        {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            double wait = Seconds(&target) - Seconds(&now);
+            if (wait > 0.0)
+            {
+                timeout.tv_sec = (time_t)wait;
+                timeout.tv_nsec = (long)((wait - timeout.tv_sec) * 1e9);
+            }
+        }
+
+        fds[0].fd = ptyInCount ? -1 : ptyMaster;
+        fds[0].events = POLLIN;
+        fds[1].fd = consoleOpen ? STDIN_FILENO : -1;
+        fds[1].events = POLLIN;
+        if (ppoll(fds, 2, &timeout, NULL) <= 0)
+        {
+            break;
+        }
+        if (fds[0].revents & POLLIN)
+        {
+            ssize_t n = read(ptyMaster, ptyIn, sizeof(ptyIn));
+            ptyInStart = 0;
+            ptyInCount = (n > 0) ? n : 0;
+        }
+        if (fds[1].revents & (POLLIN | POLLHUP))
+        {
+            ssize_t n = read(STDIN_FILENO, console + consoleCount, CONSOLE_BUF_SIZE - consoleCount);
+            if (n <= 0)
+            {
+                consoleOpen = false;
+            }
+            else
+            {
+                consoleCount += n;
+            }
+        }
+    }
+
+    if (ptyInCount)
+    {
+        uint32_t taken = PeriphUartGive(ptyIn + ptyInStart, ptyInCount);
+        ptyInStart += taken;
+        ptyInCount -= taken;
+    }
+    RunConsole();
+}
+
+//*****************************************************************************
+// Quadrature and reference pins. Each edge moves the count by one, so every
+// one interrupts, and the reference pin follows the slot (low in front of
+// the sensor). The states run 0, 2, 3, 1 as the count rises, PB0 being
+// channel A and PB1 channel B.
+//*****************************************************************************
+static void
+QuadPins(int32_t count, bool interrupt)
+{
+    static const uint8_t states[4] = {0, 2, 3, 1};
+    uint8_t state = states[count & 3];
+    void (*set)(uint32_t, uint8_t, bool) = interrupt ? PeriphPinSet : PeriphPinInit;
+
+    set(GPIO_PORTB_BASE, GPIO_PIN_0, state & 1);
+    set(GPIO_PORTB_BASE, GPIO_PIN_1, state & 2);
+}
+
+static void
+EdgeFire(void)
+{
+    Edge* edge = &edges[edgeHead];
+
+    edgeHead = (edgeHead + 1) % MAX_EDGES;
+    edgeCount--;
+    if (edgeCount)
+    {
+        ClockStart(&edgeTimer, edges[edgeHead].at);
+    }
+    quadCount = edge->count;
+    if (!replaying)
+    {
+        QuadPins(quadCount, true);
+        PeriphPinSet(GPIO_PORTC_BASE, GPIO_PIN_4, !PlantAtReference(quadCount));
+    }
+}
+
+//*****************************************************************************
+// Queues the edges of a plant step, each at the time the yaw crosses the
+// half count between its two counts, taking the yaw as moving steadily
+// through the step.
+//*****************************************************************************
+static void
+QueueEdges(double yawAfter)
+{
+    int32_t target = PlantYawCount();
+    int32_t direction = (target > edgeLast) ? 1 : -1;
+
+    while (edgeLast != target && edgeCount < MAX_EDGES)
+    {
+        double crossing = edgeLast + direction * 0.5;
+        double fraction = (yawAfter != yawBefore) ? (crossing - yawBefore) / (yawAfter - yawBefore) : 1.0;
+        Edge* edge = &edges[(edgeHead + edgeCount) % MAX_EDGES];
+
+        fraction = (fraction < 0.0) ? 0.0 : (fraction > 1.0) ? 1.0 : fraction;
+        edgeLast += direction;
+        edge->at = plantStepStart + (uint64_t)(fraction * PLANT_CYCLES);
+        edge->count = edgeLast;
+        if (edgeCount++ == 0)
+        {
+            ClockStart(&edgeTimer, edge->at);
+        }
+    }
+}
+
+static double
+YawCounts(void)
+{
+    return plant.yaw * PLANT_YAW_COUNTS / 360.0;
+}
+
+//*****************************************************************************
+// A step of the plant under the duties being output. It is stepped to the
+// end of the step now; the sensors follow it across the step.
+//*****************************************************************************
+static void
+PlantFire(void)
+{
+    double mainDuty = PeriphPwmDuty(PWM_MAIN_BASE, PWM_MAIN_OUTNUM);
+    double tailDuty = PeriphPwmDuty(PWM_TAIL_BASE, PWM_TAIL_OUTNUM);
+
+    plantStepStart = sitlCycles;
+    altitudeBefore = plant.altitude;
+    yawBefore = YawCounts();
+    PlantStep((double)PLANT_CYCLES / SYSTEM_CLOCK_HZ, mainDuty, tailDuty);
+    QueueEdges(YawCounts());
+    ClockStart(&plantTimer, sitlCycles + PLANT_CYCLES);
+}
+
+uint32_t
+SitlAltitudeCounts(void)
+{
+    double fraction = (double)(sitlCycles - plantStepStart) / PLANT_CYCLES;
+
+    if (replaying && replayAdcSeen)
+    {
+        return replayAdc;
+    }
+
+    return PlantAltitudeCounts(altitudeBefore + (plant.altitude - altitudeBefore) * fraction,
+                               PeriphPwmTransient((uint64_t)(PLANT_SPIKE_TAU_S * SYSTEM_CLOCK_HZ)));
+}
+
+//*****************************************************************************
+// Replay. The dump is read whole at start up; recdump.py's CSV has a header
+// line, then time_us,source,value with the source by name.
+//*****************************************************************************
+static void
+LoadReplay(const char* path)
+{
+    static const char* const names[] = {"TICK", "ADC", "QUAD", "YAW_REF", "SWITCHES", "BUTTONS"};
+    FILE* file = fopen(path, "r");
+    char line[128];
+
+    if (!file)
+    {
+        perror(path);
+        exit(1);
+    }
+    replayInputs = calloc(REPLAY_MAX_RECORDS, sizeof(ReplayInput));
+    while (fgets(line, sizeof(line), file) && replayCount < REPLAY_MAX_RECORDS)
+    {
+        double us;
+        char name[16];
+        unsigned value;
+        uint32_t source;
+
+        if (sscanf(line, "%lf,%15[^,],%u", &us, name, &value) != 3)
+        {
+            continue;   // The header
+        }
+        for (source = 0; source < sizeof(names) / sizeof(names[0]); source++)
+        {
+            if (!strcmp(name, names[source]))
+            {
+                break;
+            }
+        }
+        if (source == REC_TICK || source == sizeof(names) / sizeof(names[0]))
+        {
+            continue;
+        }
+        replayInputs[replayCount++] = (ReplayInput) {
+            (uint64_t)(us * (SYSTEM_CLOCK_HZ / 1000000)), source, value
+        };
+    }
+    fclose(file);
+    if (!replayCount)
+    {
+        fprintf(stderr, "SITL: no inputs in %s\n", path);
+        exit(1);
+    }
+}
+
+static void
+Replay(void)
+{
+    if (!replayCount)
+    {
+        fprintf(stderr, "SITL: no recording loaded, see --replay\n");
+        return;
+    }
+    replaying = true;
+    replayNext = 0;
+    replayStart = sitlCycles;
+    ClockStart(&replayTimer, replayStart + replayInputs[0].at);
+}
+
+static void
+ReplayInputApply(const ReplayInput* input)
+{
+    static const uint32_t buttonPorts[NUM_BUTS] = {
+        UP_BUT_PORT_BASE, DOWN_BUT_PORT_BASE, LEFT_BUT_PORT_BASE, RIGHT_BUT_PORT_BASE
+    };
+    static const uint8_t buttonPins[NUM_BUTS] = {UP_BUT_PIN, DOWN_BUT_PIN, LEFT_BUT_PIN, RIGHT_BUT_PIN};
+    int i;
+
+    switch (input->source)
+    {
+    case REC_ADC:
+        replayAdc = input->value;
+        replayAdcSeen = true;
+        break;
+    case REC_QUAD:
+        PeriphPinSet(GPIO_PORTB_BASE, GPIO_PIN_0, input->value & 1);
+        PeriphPinSet(GPIO_PORTB_BASE, GPIO_PIN_1, input->value & 2);
+        break;
+    case REC_YAW_REF:
+        PeriphPinSet(GPIO_PORTC_BASE, GPIO_PIN_4, input->value);
+        break;
+    case REC_SWITCHES:
+        sw1 = input->value & 1;
+        PeriphPinSet(SW_PORT, SW1_PIN, sw1);
+        PeriphPinSet(SW_PORT, SW2_PIN, input->value & 2);
+        break;
+    case REC_BUTTONS:
+        for (i = 0; i < NUM_BUTS; i++)
+        {
+            PeriphPinSet(buttonPorts[i], buttonPins[i], input->value & (1 << i));
+        }
+        break;
+    }
+}
+
+static void
+ReplayFire(void)
+{
+    while (replayNext < replayCount && replayStart + replayInputs[replayNext].at <= sitlCycles)
+    {
+        ReplayInputApply(&replayInputs[replayNext++]);
+    }
+    if (replayNext < replayCount)
+    {
+        ClockStart(&replayTimer, replayStart + replayInputs[replayNext].at);
+    }
+    else
+    {
+        fprintf(stderr, "SITL: replay done at %.3f s\n", (double)sitlCycles / SYSTEM_CLOCK_HZ);
+    }
+}
+
+static void
+IoFire(void)
+{
+    Io();
+    ClockStart(&ioTimer, sitlCycles + (fast ? FAST_IO_CYCLES : IO_CYCLES));
+}
+
+static void
+ConsoleFire(void)
+{
+    RunConsole();
+}
+
+static void
+StopFire(void)
+{
+    Finish();
+}
+
+//*****************************************************************************
+// Reset: the state that outlives it goes into a memory file, whose
+// descriptor the restarted process is given with --resume.
+//*****************************************************************************
+void
+SitlReset(uint32_t cause)
+{
+    ResumeHeader header = {
+        .magic = SITL_RESUME_MAGIC,
+        .cause = cause,
+        .ptyMaster = ptyMaster,
+        .ptySlave = ptySlave,
+        .sw1 = sw1,
+        .consoleCount = consoleCount,
+        .startWall = startWall,
+        .actionCount = actionCount,
+        .events = clockEvents,
+        .replaying = replaying,
+        .replayNext = replayNext,
+        .replayStart = replayStart,
+        .replayAdc = replayAdc,
+        .replayAdcSeen = replayAdcSeen
+    };
+    int fd = memfd_create("heli-sitl", 0);
+    char fdArg[16];
+    int argc = 0;
+
+    fprintf(stderr, "SITL: reset (cause 0x%02x) at %.3f s\n", cause, (double)sitlCycles / SYSTEM_CLOCK_HZ);
+    if (logFile)
+    {
+        fclose(logFile);   // Opened again, to append, by the restarted process
+    }
+    if (fd < 0 || write(fd, &header, sizeof(header)) < 0)
+    {
+        perror("SITL: reset");
+        exit(1);
+    }
+    HalSave(fd);
+    if (write(fd, &plant, sizeof(plant)) < 0 || write(fd, console, consoleCount) < 0
+        || write(fd, actions, actionCount * sizeof(Action)) < 0)
+    {
+        perror("SITL: reset");
+    }
+    lseek(fd, 0, SEEK_SET);
+
+    while (restartArgs[argc])
+    {
+        argc++;
+    }
+    snprintf(fdArg, sizeof(fdArg), "%d", fd);
+    restartArgs[argc] = "--resume";
+    restartArgs[argc + 1] = fdArg;
+    restartArgs[argc + 2] = NULL;
+    execv("/proc/self/exe", restartArgs);
+    perror("SITL: restart");
+    exit(1);
+}
+
+static void
+Resume(int fd)
+{
+    ResumeHeader header;
+
+    if (read(fd, &header, sizeof(header)) != sizeof(header) || header.magic != SITL_RESUME_MAGIC)
+    {
+        fprintf(stderr, "SITL: bad resume state\n");
+        exit(1);
+    }
+    HalLoad(fd, header.cause);
+    if (read(fd, &plant, sizeof(plant)) != sizeof(plant)
+        || read(fd, console, header.consoleCount) != (ssize_t)header.consoleCount
+        || header.actionCount > MAX_ACTIONS
+        || read(fd, actions, header.actionCount * sizeof(Action))
+           != (ssize_t)(header.actionCount * sizeof(Action)))
+    {
+        fprintf(stderr, "SITL: bad resume state\n");
+        exit(1);
+    }
+    close(fd);
+    ptyMaster = header.ptyMaster;
+    ptySlave = header.ptySlave;
+    sw1 = header.sw1;
+    consoleCount = header.consoleCount;
+    startWall = header.startWall;
+    actionCount = header.actionCount;
+    clockEvents = header.events;
+    replaying = header.replaying;
+    replayNext = header.replayNext;
+    replayStart = header.replayStart;
+    replayAdc = header.replayAdc;
+    replayAdcSeen = header.replayAdcSeen;
+}
+
+//*****************************************************************************
+// Opens the pseudo-terminal. Its slave end is put in raw mode, so a client
+// that does not set the line up still gets the bytes as sent.
+//*****************************************************************************
+static void
+OpenPty(void)
+{
+    struct termios raw;
+
+    ptyMaster = posix_openpt(O_RDWR | O_NOCTTY);
+    if (ptyMaster < 0 || grantpt(ptyMaster) < 0 || unlockpt(ptyMaster) < 0
+        || (ptySlave = open(ptsname(ptyMaster), O_RDWR | O_NOCTTY)) < 0)
+    {
+        perror("SITL: pseudo-terminal");
+        exit(1);
+    }
+    tcgetattr(ptySlave, &raw);
+    cfmakeraw(&raw);
+    tcsetattr(ptySlave, TCSANOW, &raw);
+    fcntl(ptyMaster, F_SETFL, fcntl(ptyMaster, F_GETFL) | O_NONBLOCK);
+}
+
+static void
+Usage(const char* name)
+{
+    fprintf(stderr, "usage: %s [--fast] [--speed x] [--time s] [--link path] [--log file] [--sw1]\n"
+            "       [--eeprom file] [--hover %%] [--yaw deg] [--noise counts]\n"
+            "       [--spike counts] [--seed n] [--replay file]\n", name);
+    exit(2);
+}
+
+int
+main(int argc, char** argv)
+{
+    int resumeFd = -1;
+    int i;
+
+    restartArgs = calloc(argc + 3, sizeof(char*));
+    restartArgs[0] = argv[0];
+    for (i = 1; i < argc; i++)
+    {
+        const char* opt = argv[i];
+        const char* val = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (!strcmp(opt, "--resume") && val)
+        {
+            resumeFd = atoi(val);
+            i++;
+            continue;
+        }
+        restartArgs[i] = argv[i];
+        if (!strcmp(opt, "--fast"))
+        {
+            fast = true;
+        }
+        else if (!strcmp(opt, "--sw1"))
+        {
+            sw1 = true;
+        }
+        else if (!val)
+        {
+            Usage(argv[0]);
+        }
+        else
+        {
+            if (!strcmp(opt, "--speed"))
+            {
+                speed = atof(val);
+            }
+            else if (!strcmp(opt, "--time"))
+            {
+                stopCycles = (uint64_t)(atof(val) * SYSTEM_CLOCK_HZ);
+            }
+            else if (!strcmp(opt, "--link"))
+            {
+                linkPath = val;
+            }
+            else if (!strcmp(opt, "--log"))
+            {
+                logPath = val;
+            }
+            else if (!strcmp(opt, "--eeprom"))
+            {
+                HalEepromFile(val);
+            }
+            else if (!strcmp(opt, "--hover"))
+            {
+                plantConfig.hover = atof(val) / 100.0;
+            }
+            else if (!strcmp(opt, "--yaw"))
+            {
+                plantConfig.yawStart = atof(val);
+            }
+            else if (!strcmp(opt, "--noise"))
+            {
+                plantConfig.noise = atof(val);
+            }
+            else if (!strcmp(opt, "--spike"))
+            {
+                plantConfig.spike = atof(val);
+            }
+            else if (!strcmp(opt, "--seed"))
+            {
+                plantConfig.seed = strtoull(val, NULL, 0);
+            }
+            else if (!strcmp(opt, "--replay"))
+            {
+                replayPath = val;
+            }
+            else
+            {
+                Usage(argv[0]);
+            }
+            i++;
+            restartArgs[i] = argv[i];
+        }
+    }
+    for (i = 1; i < argc; i++)
+    {
+        // Close the gaps left by --resume
+        if (!restartArgs[i])
+        {
+            memmove(&restartArgs[i], &restartArgs[i + 1], (argc - i) * sizeof(char*));
+        }
+    }
+    if (speed <= 0.0)
+    {
+        Usage(argv[0]);
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    if (resumeFd >= 0)
+    {
+        Resume(resumeFd);
+    }
+    else
+    {
+        PlantInit();
+        OpenPty();
+        fprintf(stderr, "SITL: UART on %s\n", ptsname(ptyMaster));
+    }
+    if (replayPath)
+    {
+        LoadReplay(replayPath);
+    }
+    if (logPath && !(logFile = fopen(logPath, (resumeFd >= 0) ? "a" : "w")))
+    {
+        perror(logPath);
+        exit(1);
+    }
+    if (linkPath)
+    {
+        unlink(linkPath);
+        if (symlink(ptsname(ptyMaster), linkPath) < 0)
+        {
+            perror(linkPath);
+        }
+    }
+
+    // Power on levels: buttons released, switches as set, sensors as the
+    // plant stands
+    PeriphPinInit(UP_BUT_PORT_BASE, UP_BUT_PIN, UP_BUT_NORMAL);
+    PeriphPinInit(DOWN_BUT_PORT_BASE, DOWN_BUT_PIN, DOWN_BUT_NORMAL);
+    PeriphPinInit(LEFT_BUT_PORT_BASE, LEFT_BUT_PIN, LEFT_BUT_NORMAL);
+    PeriphPinInit(RIGHT_BUT_PORT_BASE, RIGHT_BUT_PIN, RIGHT_BUT_NORMAL);
+    PeriphPinInit(SW_PORT, SW1_PIN, sw1);
+    quadCount = PlantYawCount();
+    edgeLast = quadCount;
+    QuadPins(quadCount, false);
+    PeriphPinInit(GPIO_PORTC_BASE, GPIO_PIN_4, !PlantAtReference(quadCount));
+
+    plantStepStart = sitlCycles;
+    altitudeBefore = plant.altitude;
+    ClockStart(&plantTimer, sitlCycles);
+    ClockStart(&ioTimer, sitlCycles + IO_CYCLES);
+    if (stopCycles)
+    {
+        ClockStart(&stopTimer, stopCycles);
+    }
+    if (actionCount)
+    {
+        ClockStart(&actionTimer, actions[0].at);
+    }
+    if (replaying && replayNext < replayCount)
+    {
+        ClockStart(&replayTimer, replayStart + replayInputs[replayNext].at);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &anchorWall);
+    if (resumeFd < 0)
+    {
+        startWall = anchorWall;
+    }
+    anchorCycles = sitlCycles;
+
+    return FirmwareMain();
+}
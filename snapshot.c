@@ -0,0 +1,75 @@
+//*******************************************************************************
+// snapshot.c
+//
+// Published state of the helicopter for the display and telemetry, copied by
+// the kernel once per tick into one of two seqlocked slots so readers always
+// see a single tick's values without locks or masking interrupts.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rotors.h"
+#include "system.h"
+#include "yaw.h"
+#include "snapshot.h"
+
+typedef struct {
+    volatile uint32_t sequence;  // Odd while the slot is being written
+    volatile Snapshot snap;      // Volatile so it is written inside the sequence
+} SnapshotSlot;
+
+static SnapshotSlot slots[2];
+static volatile uint8_t published = 0;
+
+//*****************************************************************************
+// Fills the slot that is not published, bracketing it with the sequence, then
+// publishes it. Any reader still copying the other slot finishes undisturbed.
+//*****************************************************************************
+RAMFUNC void
+SnapshotPublish(Helicopter* heli)
+{
+    SnapshotSlot* slot = &slots[published ^ 1];
+
+    slot->sequence++;
+    slot->snap.tick = sysTickCount;
+    slot->snap.altitude = heli->controller->curr_altitude_reading;
+    slot->snap.altitudeSetpoint = heli->controller->altitudesetpoint;
+    slot->snap.yaw = GetYawAngleDegrees(heli);
+    slot->snap.yawSetpoint = heli->controller->yaw_increment;
+    slot->snap.mainDuty = heli->mainrotor->ui32Duty;
+    slot->snap.tailDuty = heli->tailrotor->ui32Duty;
+    slot->snap.mode = heli->mode;
+    slot->snap.submode = heli->submode;
+    slot->sequence++;
+    published ^= 1;
+}
+
+//*****************************************************************************
+// Copies the published slot, trying again if its sequence was odd or changed
+// during the copy, which takes the writer publishing twice meanwhile.
+//*****************************************************************************
+void
+SnapshotRead(Snapshot* snap)
+{
+    SnapshotSlot* slot;
+    uint32_t sequence;
+
+    do
+    {
+        slot = &slots[published];
+        sequence = slot->sequence;
+        snap->tick = slot->snap.tick;
+        snap->altitude = slot->snap.altitude;
+        snap->altitudeSetpoint = slot->snap.altitudeSetpoint;
+        snap->yaw = slot->snap.yaw;
+        snap->yawSetpoint = slot->snap.yawSetpoint;
+        snap->mainDuty = slot->snap.mainDuty;
+        snap->tailDuty = slot->snap.tailDuty;
+        snap->mode = slot->snap.mode;
+        snap->submode = slot->snap.submode;
+    } while ((sequence & 1) || slot->sequence != sequence);
+}
@@ -0,0 +1,47 @@
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+//*******************************************************************************
+// snapshot.c
+//
+// Published state of the helicopter for the display and telemetry. Once per
+// tick, after the controller has run and the duties are applied, the kernel
+// copies every reported field into a snapshot. Readers take a copy of the
+// latest snapshot, so everything they show comes from the same tick, without
+// locks or masking interrupts. There are two snapshot slots, each with a
+// sequence count (a seqlock): the writer fills the slot not published and
+// then publishes it, and a reader retries only if the slot it was copying was
+// rewritten under it. A reader that preempts the writer always finds the
+// published slot whole, so it never waits.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rotors.h"
+
+typedef struct {
+    uint32_t tick;               // sysTickCount when published
+    int32_t altitude;            // %
+    int32_t altitudeSetpoint;    // %
+    int32_t yaw;                 // Degrees, wrapped for display
+    int32_t yawSetpoint;         // Degrees
+    uint32_t mainDuty;           // Duty (%, two decimal places)
+    uint32_t tailDuty;
+    uint8_t mode;                // Mode
+    uint8_t submode;             // SubMode
+} Snapshot;
+
+//*****************************************************************************
+// Publishes the current state. Called by the kernel once per tick; there
+// must only ever be one writer.
+void SnapshotPublish(Helicopter* heli);
+
+//*****************************************************************************
+// Copies the latest published state into snap. Safe from any context.
+void SnapshotRead(Snapshot* snap);
+
+#endif /* SNAPSHOT_H_ */
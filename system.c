@@ -17,11 +17,14 @@
 #include <stdio.h>
 #include <stdbool.h>
 #include "inc/hw_memmap.h"
+#include "inc/hw_ints.h"
 #include "driverlib/adc.h"
 #include "driverlib/sysctl.h"
 #include "driverlib/systick.h"
 #include "driverlib/interrupt.h"
 #include "driverlib/debug.h"
+#include "driverlib/eeprom.h"
+#include "driverlib/timer.h"
 #include "utils/ustdlib.h"
 #include "OrbitOLED/OrbitOLEDInterface.h"
 #include "yaw.h"
@@ -31,42 +34,79 @@
 #include "uart.h"
 #include "rotors.h"
 #include "mode.h"
+#include "recorder.h"
+#include "events.h"
+#include "isrstats.h"
+#include "retain.h"
+#include "altcal.h"
+#include "snapshot.h"
 
 //Interrupt flags for the helicopter system
-volatile uint8_t DeltaTFlag = 0;
 volatile uint8_t slowTick = 0;
 volatile uint8_t ResetFlag = 0;
+volatile uint32_t sysTickCount = 0;
+volatile uint8_t BootReady = 0;
+bool eepromReady = false;
+uint32_t bootReadyUs = 0;
 
 //*****************************************************************************
-// The interrupt handler for the for SysTick interrupt.
+// The interrupt handler for the for SysTick interrupt. Unless the PWM
+// triggers them (ADC_PWM_TRIGGER), ADC conversions are started here rather
+// than in the kernel so samples are evenly spaced, and from the start of
+// boot so the altitude reference can settle meanwhile.
 //*****************************************************************************
-void
+RAMFUNC void
 SysTickIntHandler(void)
 {
-    DeltaTFlag = 1;
+    ISR_ENTER(ISR_SYSTICK);
+    RECORD(REC_TICK, 0);
+    sysTickCount++;
+#if !ADC_PWM_TRIGGER
+    if (sysTickCount % ADC_SAMPLE_DIVIDER == 0)
+    {
+        ADCProcessorTrigger(ADC0_BASE, 3);   // Initiate a conversion
+    }
+#endif
+    if (BootReady)
+    {
+        EventPost(EVENT_TICK, 0);
+    }
+    ISR_PROBE();
+    ISR_EXIT(ISR_SYSTICK);
 }
 
 //*****************************************************************************
-// System Tick runs at 150Hz. Within this function, a new ADC value is
-// processed each call, button updates are polled for and slow tick is used
-// to manage UART printing.
+// System Tick runs at SYSTICK_RATE_HZ. Within this function the buttons are
+// polled, slow tick is raised for the display and the UART status and
+// diagnostics lines are printed, each at the rate set in system.h.
 //*****************************************************************************
 void
 SysTick(Helicopter* heli)
 {
-    // Initiate a conversion
-    ADCProcessorTrigger(ADC0_BASE, 3);
+    static uint16_t tickCount = 0;  // Stores current tick count, wraps each second.
 
-    static uint8_t tickCount = 0;  // Stores current tick count.
-    const uint8_t ticksPerSlow = SYSTICK_RATE_HZ / SLOWTICK_RATE_HZ; //set the UART print rate.
-
-    updateButtons ();       // Poll the buttons
-    if (++tickCount >= ticksPerSlow)
-    {                       // Signal a slow tick
+    if (++tickCount >= SYSTICK_RATE_HZ)
+    {
         tickCount = 0;
-        slowTick = 1;
+    }
+
+    if (tickCount % BUTTON_POLL_DIVIDER == 0)
+    {
+        updateButtons ();       // Poll the buttons
+    }
+    slowTick = (tickCount % DISPLAY_DIVIDER == 0);   // Signal a slow tick
+    if (tickCount % TELEMETRY_DIVIDER == 0)
+    {
         UARTPrint(heli);   // Print current information of helicopter
     }
+    if (tickCount % DIAG_DIVIDER == 0)
+    {
+        UARTPrintDiag();
+    }
+    if (tickCount % RETAIN_DIVIDER == 0)
+    {
+        RetainSave(heli);   // Keep the retained state current for a warm reset
+    }
 }
 
 //***************************************************************************************************
@@ -75,15 +115,15 @@ SysTick(Helicopter* heli)
 void
 initClock (void)
 {
-    // Set the clock rate to 20 MHz
-    SysCtlClockSet (SYSCTL_SYSDIV_10 | SYSCTL_USE_PLL | SYSCTL_OSC_MAIN |
+    // Set the clock rate to the selected profile (CLOCK_PROFILE_MHZ)
+    SysCtlClockSet (CLOCK_SYSDIV | SYSCTL_USE_PLL | SYSCTL_OSC_MAIN |
                    SYSCTL_XTAL_16MHZ);
     // Set the PWM clock rate (using the prescaler)
     SysCtlPWMClockSet(PWM_DIVIDER_CODE);
     //
     // Set up the period for the SysTick timer.  The SysTick timer period is
     // set as a function of the system clock.
-    SysTickPeriodSet(SysCtlClockGet() / SAMPLE_RATE_HZ);
+    SysTickPeriodSet(SYSTEM_CLOCK_HZ / SYSTICK_RATE_HZ);
     //
     // Register the interrupt handler
     SysTickIntRegister(SysTickIntHandler);
@@ -92,6 +132,67 @@ initClock (void)
     SysTickIntEnable();
     SysTickEnable();
 
+    initTimestamp();
+}
+
+//*****************************************************************************
+// Starts the timestamp timer from zero, counting up at the system clock and
+// wrapping at 32 bits. It is kept clocked in sleep, whatever the clock
+// gating, and stops while the debugger halts the core, as the DWT counter
+// does. Trace must be enabled in the debug monitor register before the DWT
+// counter will run.
+//*****************************************************************************
+void
+initTimestamp (void)
+{
+    SysCtlPeripheralEnable(TIMESTAMP_TIMER_PERIPH);
+    while (!SysCtlPeripheralReady(TIMESTAMP_TIMER_PERIPH))
+    {
+    }
+    SysCtlPeripheralSleepEnable(TIMESTAMP_TIMER_PERIPH);
+    TimerConfigure(TIMESTAMP_TIMER_BASE, TIMER_CFG_PERIODIC_UP);
+    TimerLoadSet(TIMESTAMP_TIMER_BASE, TIMER_A, 0xFFFFFFFF);
+    TimerControlStall(TIMESTAMP_TIMER_BASE, TIMER_A, true);
+    TimerEnable(TIMESTAMP_TIMER_BASE, TIMER_A);
+
+    DEMCR_R |= DEMCR_TRCENA;
+    DWT_CYCCNT_R = 0;
+    DWT_CTRL_R |= DWT_CTRL_CYCCNTENA;
+}
+
+//*****************************************************************************
+// Starts the EEPROM, which holds the altitude calibration and the learned
+// hover duty. eepromReady is left false if it fails to come up, in which
+// case nothing is read from or written to it.
+//*****************************************************************************
+void
+initEEPROM (void)
+{
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_EEPROM0);
+    while (!SysCtlPeripheralReady(SYSCTL_PERIPH_EEPROM0))
+    {
+    }
+    eepromReady = (EEPROMInit() == EEPROM_INIT_OK);
+}
+
+//*****************************************************************************
+// Applies the priority plan in system.h. Handlers at the same level do not
+// preempt each other, so a yaw edge and a reference crossing are serviced
+// back to back in NVIC order (GPIOB first).
+//*****************************************************************************
+void
+initInterruptPriorities (void)
+{
+    IntPriorityGroupingSet(INT_PRIORITY_GROUPING);
+    IntPrioritySet(INT_GPIOB, PRIORITY_YAW);
+    IntPrioritySet(INT_GPIOC, PRIORITY_YAW_REF);
+    IntPrioritySet(FAULT_SYSTICK, PRIORITY_SYSTICK);
+    IntPrioritySet(INT_ADC0SS3, PRIORITY_ADC);
+    IntPrioritySet(INT_GPIOA, PRIORITY_MODE_SW);
+    IntPrioritySet(INT_GPIOE, PRIORITY_BUTTONS);
+    IntPrioritySet(INT_GPIOD, PRIORITY_BUTTONS);
+    IntPrioritySet(INT_GPIOF, PRIORITY_BUTTONS);
+    IntPrioritySet(INT_UART0, PRIORITY_UART);
 }
 
 //*****************************************************************************
@@ -100,49 +201,72 @@ initClock (void)
 void
 initHelicopter(Helicopter* heli)
 {
+    char report[80];
+
+    // Altitude sampling starts first, along with the PWM that triggers it,
+    // so the buffer fills while everything else is brought up. Ticks are not
+    // queued until the kernel is ready.
+    initEvents ();   // Before any interrupt can post
     initClock ();
     initADC ();
     initBuffer();
+    initialiseRotors (heli);   // Duties are zero until the kernel runs
+    initInterruptPriorities();
+    IntMasterEnable();
+
     initialiseUSB_UART ();
     initYawPeripherals (heli);
-    initialiseRotors (heli);
-    OLEDInitialise ();
     initSWS();
     initRefYaw();
+    initEEPROM();
+    initAltCal();
+    HoverDutyLoad();
+    bool restored = RetainRestore(heli);   // Warm reset: state kept in no-init RAM
+    OLEDInitialise ();   // The slowest step, overlapped with the altitude settling
 
-    // Enable interrupts to the processor.
-    IntMasterEnable();
-
-    initAlt(heli); //inits the refAltADC;
+    if (!restored)
+    {
+        initAlt(heli); //inits the refAltADC;
+    }
+    RetainSave(heli);
 
+    bootReadyUs = GetTimestamp() / CLOCK_PROFILE_MHZ;
+    BootReady = 1;   // SysTick now queues ticks for the kernel
+    usnprintf(report, sizeof(report), "Boot: ready (us): %d, ref %d, %s %d samples var %d\r\n",
+              bootReadyUs, heli->buffer->refAltADC, restored ? "retained," : "settled from",
+              altSettleSamples, altSettleVariance);
+    UARTSend(report);
 }
 
 
 //*****************************************************************************
 // Function to show screen state, modified for Project
 // Displays altitude (%), yaw angle (degrees), main rotor duty cycle (%)
-// and tail rotor duty cycle (%).
+// and tail rotor duty cycle (%), all from the latest snapshot.
 //*****************************************************************************
 void
 DisplayProject(Helicopter* heli)
 {
     char string[17];  // 16 characters across the display
+    Snapshot snap;
 
-    int16_t yawAngle = GetYawAngleDegrees(heli);  // Outputs Yaw in degrees.
+    SnapshotRead(&snap);  // All four lines from the same tick
 
     // Display Altitude (%)
-    usnprintf(string, sizeof(string), "Alt (%%): %4d", heli->controller->curr_altitude_reading);
+    usnprintf(string, sizeof(string), "Alt (%%): %4d", snap.altitude);
     OLEDStringDraw(string, 0, 0);
 
     // Display Yaw Angle (Degrees)
-    usnprintf(string, sizeof(string), "Yaw (deg): %4d", yawAngle);
+    usnprintf(string, sizeof(string), "Yaw (deg): %4d", snap.yaw);
     OLEDStringDraw(string, 0, 1);
 
     // Display Main Rotor Duty Cycle (%)
-    usnprintf(string, sizeof(string), "M-Rot (%%): %4d", heli->mainrotor->ui32Duty);
+    usnprintf(string, sizeof(string), "M-Rot (%%):%3d.%02d", snap.mainDuty / 100,
+              snap.mainDuty % 100);
     OLEDStringDraw(string, 0, 2);
 
     // Display Tail Rotor Duty Cycle (%)
-    usnprintf(string, sizeof(string), "T-Rot (%%): %4d", heli->tailrotor->ui32Duty);
+    usnprintf(string, sizeof(string), "T-Rot (%%):%3d.%02d", snap.tailDuty / 100,
+              snap.tailDuty % 100);
     OLEDStringDraw(string, 0, 3);
 }
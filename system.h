@@ -22,31 +22,156 @@
 //*****************************************************************************
 // Constants
 //*****************************************************************************
-#define SAMPLE_RATE_HZ 150    // Sample Rate for ADC inputs
-#define SYSTICK_RATE_HZ 100   // Systick frequency
-#define SLOWTICK_RATE_HZ 8    // Slowtick frequency
+// Clock profile: the core clock in MHz, one of 20, 40, 50 or 80. Every clock
+// derived value (SysTick, PWM and UART divisors, delays) is computed from
+// SYSTEM_CLOCK_HZ rather than read back at run time.
+#define CLOCK_PROFILE_MHZ    80
+
+#if CLOCK_PROFILE_MHZ == 80
+#define CLOCK_SYSDIV         SYSCTL_SYSDIV_2_5
+#elif CLOCK_PROFILE_MHZ == 50
+#define CLOCK_SYSDIV         SYSCTL_SYSDIV_4
+#elif CLOCK_PROFILE_MHZ == 40
+#define CLOCK_SYSDIV         SYSCTL_SYSDIV_5
+#elif CLOCK_PROFILE_MHZ == 20
+#define CLOCK_SYSDIV         SYSCTL_SYSDIV_10
+#else
+#error "CLOCK_PROFILE_MHZ must be 20, 40, 50 or 80"
+#endif
+
+#define SYSTEM_CLOCK_HZ      (CLOCK_PROFILE_MHZ * 1000000UL)
+#define PWM_CLOCK_HZ         (SYSTEM_CLOCK_HZ / PWM_DIVIDER)   // PWM_DIVIDER_CODE must match
+#define SWITCH_SETTLE_US     45      // Settling delay before SW1 is read
+#define DELAY_US(us)         ((SYSTEM_CLOCK_HZ / 3000000UL) * (us))   // SysCtlDelay takes 3 cycle loops
+
+// Hot code (ISRs and the controller) can be run from SRAM to avoid flash
+// wait states above 40 MHz. This needs the linker command file to give the
+// .TI.ramfunc section (.ramfunc for GCC) a flash load address and an SRAM
+// run address copied at boot, so it is off unless that is in place.
+#define RAMFUNC_ENABLED      0
+
+#if RAMFUNC_ENABLED && defined(__TI_COMPILER_VERSION__)
+#define RAMFUNC              __attribute__((ramfunc))
+#elif RAMFUNC_ENABLED && defined(__GNUC__)
+#define RAMFUNC              __attribute__((section(".ramfunc"), long_call, noinline))
+#else
+#define RAMFUNC
+#endif
+
+// Data the startup code must not zero or initialise, so it survives a warm
+// reset (see retain.c). For GCC the linker script must place .noinit in
+// SRAM outside .bss. The SITL build keeps the section over its restarts.
+#if defined(SITL)
+#define NOINIT               __attribute__((section("sitl_noinit")))
+#elif defined(__TI_COMPILER_VERSION__)
+#define NOINIT               __attribute__((noinit))
+#elif defined(__GNUC__)
+#define NOINIT               __attribute__((section(".noinit")))
+#else
+#define NOINIT
+#endif
+
+// Task rates. SysTick runs at SYSTICK_RATE_HZ and every other rate must
+// divide it exactly; each task runs on every (SYSTICK_RATE_HZ / rate)th tick.
+#define SYSTICK_RATE_HZ      1000   // Systick frequency, the base tick
+#define ADC_SAMPLE_RATE_HZ   1000   // Sample Rate for ADC inputs
+#define ALT_LOOP_RATE_HZ     1000   // Main rotor (altitude) controller rate
+#define YAW_LOOP_RATE_HZ     1000   // Tail rotor (yaw) controller rate
+#define BUTTON_POLL_RATE_HZ  125    // Button auto-repeat and re-sample rate
+#define DISPLAY_RATE_HZ      8      // OLED refresh rate (slowtick)
+#define TELEMETRY_RATE_HZ    8      // UART status line rate
+#define DIAG_RATE_HZ         1      // UART diagnostics line rate
+#define RETAIN_RATE_HZ       1      // Retained state save rate (see retain.h)
+
+#define ADC_SAMPLE_DIVIDER   (SYSTICK_RATE_HZ / ADC_SAMPLE_RATE_HZ)
+#define ALT_LOOP_DIVIDER     (SYSTICK_RATE_HZ / ALT_LOOP_RATE_HZ)
+#define YAW_LOOP_DIVIDER     (SYSTICK_RATE_HZ / YAW_LOOP_RATE_HZ)
+#define BUTTON_POLL_DIVIDER  (SYSTICK_RATE_HZ / BUTTON_POLL_RATE_HZ)
+#define DISPLAY_DIVIDER      (SYSTICK_RATE_HZ / DISPLAY_RATE_HZ)
+#define TELEMETRY_DIVIDER    (SYSTICK_RATE_HZ / TELEMETRY_RATE_HZ)
+#define DIAG_DIVIDER         (SYSTICK_RATE_HZ / DIAG_RATE_HZ)
+
+// Altitude sample trigger. With ADC_PWM_TRIGGER the main rotor's PWM
+// generator starts a conversion once per period at ADC_PWM_PHASE_PERCENT of
+// its up count: 0 is the counter at zero and 100 at load, the centres of the
+// pulse and the gap, furthest from the switching edges. Otherwise SysTick
+// starts one every ADC_SAMPLE_DIVIDER ticks, at no set phase to the PWM.
+#define ADC_PWM_TRIGGER        1
+#define ADC_PWM_PHASE_PERCENT  100
+#define RETAIN_DIVIDER       (SYSTICK_RATE_HZ / RETAIN_RATE_HZ)
+
+// The controller gains were tuned with the loops running at this rate. The
+// integral is scaled by the actual dt relative to it, and the derivative is
+// taken across a fixed DERIV_WINDOW_HZ span so it does not turn into
+// quantisation noise at high loop rates.
+#define CONTROL_TUNED_RATE_HZ  150
+#define DERIV_WINDOW_HZ        100
+
+// NVIC priorities. The TM4C123 implements the top three priority bits and
+// all three are used for preemption (no subpriority); lower is more urgent.
+// Yaw edges and the reference come first so no edge is missed, SysTick next
+// so the control timebase is steady, then the ADC sample, the mode switch
+// and buttons, and finally the UART, which only refills its FIFO.
+#define INT_PRIORITY_GROUPING  3
+#define PRIORITY_YAW           0x00
+#define PRIORITY_YAW_REF       0x00
+#define PRIORITY_SYSTICK       0x20
+#define PRIORITY_ADC           0x40
+#define PRIORITY_MODE_SW       0x60
+#define PRIORITY_BUTTONS       0x60
+#define PRIORITY_UART          0x80
+
 #define PWM_DIVIDER_CODE   SYSCTL_PWMDIV_4
 #define MAIN_ROTOR_SELECT    0
 #define TAIL_ROTOR_SELECT    1
 
-// Conversion parameters for states to degrees (yaw).
-#define NUM_SLOTS       112
-#define TOTAL_DEG       360
-#define TOTAL_STATES    NUM_SLOTS * 4
-#define YAW_DELTA       TOTAL_DEG / (TOTAL_STATES)
+// Free running timestamp, in system clock cycles, used by the recorder,
+// events, trace and timing instrumentation: Timer 5 counting up through all
+// 32 bits. The core sleeps between events, and the DWT cycle counter stops
+// with it, so the timer, which runs on in sleep, is the timebase for anything
+// that may span a sleep. The DWT counter, cheaper to read, is kept for
+// GetCycles(), timing code that runs without sleeping (bench.c), counting
+// at CYCLES_CLOCK_HZ. Firmware code takes no virtual time in the SITL, so
+// there GetCycles() reads the host's clock in nanoseconds instead.
+#if defined(SITL)
+extern volatile uint32_t sitlDemcr, sitlDwtCtrl, sitlDwtCyccnt, sitlTimer5Tav;
+uint32_t SitlHostNanoseconds(void);
+#define DEMCR_R         sitlDemcr
+#define DWT_CTRL_R      sitlDwtCtrl
+#define DWT_CYCCNT_R    sitlDwtCyccnt
+#define TIMESTAMP_R     sitlTimer5Tav
+#define GetCycles()     SitlHostNanoseconds()
+#define CYCLES_CLOCK_HZ 1000000000UL
+#else
+#define DEMCR_R         (*((volatile uint32_t *)0xE000EDFC))
+#define DWT_CTRL_R      (*((volatile uint32_t *)0xE0001000))
+#define DWT_CYCCNT_R    (*((volatile uint32_t *)0xE0001004))
+#define TIMESTAMP_R     (*((volatile uint32_t *)0x40035050))   // Timer 5 TAV
+#define GetCycles()     (DWT_CYCCNT_R)
+#define CYCLES_CLOCK_HZ SYSTEM_CLOCK_HZ
+#endif
+#define TIMESTAMP_TIMER_BASE    TIMER5_BASE
+#define TIMESTAMP_TIMER_PERIPH  SYSCTL_PERIPH_TIMER5
+#define DEMCR_TRCENA    0x01000000
+#define DWT_CTRL_CYCCNTENA  0x00000001
+#define GetTimestamp()  (TIMESTAMP_R)
 
-//Interrupt flags for the system self-clearing deltaTFlag and slowtick.
-extern volatile uint8_t DeltaTFlag;
+//Flags for the system: slowtick and the reset switch.
 extern volatile uint8_t slowTick;
 extern volatile uint8_t ResetFlag;
+extern volatile uint32_t sysTickCount;   // SysTick interrupts since boot
+extern volatile uint8_t BootReady;       // Set once initHelicopter is done
+extern uint32_t bootReadyUs;             // Time from the clock being set to ready
+extern bool eepromReady;                 // EEPROM started, see initEEPROM
 
 //*****************************************************************************
-// The interrupt handler for the for SysTick interrupt.
+// The interrupt handler for the for SysTick interrupt. Posts EVENT_TICK.
 //*****************************************************************************
 void SysTickIntHandler(void);
 
 //*****************************************************************************
-//Handles functionaity for an interrupt that prints to UART
+// Runs the tick based background tasks (buttons, display flag, UART output)
+// each at its own rate. Called once per SysTick by the kernel.
 //*****************************************************************************
 void SysTick(Helicopter* heli);
 
@@ -57,7 +182,23 @@ void SysTick(Helicopter* heli);
 void initClock (void);
 
 //*****************************************************************************
-// Function to initialize all parts of helicopter.
+// Starts the EEPROM, setting eepromReady if it can be used.
+//*****************************************************************************
+void initEEPROM (void);
+
+//*****************************************************************************
+// Sets the NVIC priority grouping and the priority of every interrupt.
+//*****************************************************************************
+void initInterruptPriorities (void);
+
+//*****************************************************************************
+// Starts the timestamp timer (GetTimestamp) and the DWT cycle counter
+// (GetCycles).
+//*****************************************************************************
+void initTimestamp (void);
+
+//*****************************************************************************
+// Function to initialize all parts of helicopter. Reports the time to ready.
 //*****************************************************************************
 void initHelicopter(Helicopter* heli);
 
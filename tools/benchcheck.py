@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""Compares firmware benchmark results against a stored baseline.
+
+RunBenchmarks (bench.c, BENCHMARK_ENABLED) prints one line per function:
+"B,<name>,<iterations>,<min>,<mean>,<max>,<clock Hz>" in cycles. This script
+reads those lines from a UART capture, writes them as JSON and flags any
+function whose mean cycle count grew by more than the threshold. Exits with
+status 1 when a regression is found.
+
+The host build (make -C sitl bench) prints the same lines timed in host
+nanoseconds, clock 1000000000; keep a separate baseline for it, and allow
+a wider threshold, as host timings of calls this short vary run to run.
+
+    python3 tools/benchcheck.py capture.log --baseline bench_baseline.json
+    python3 tools/benchcheck.py capture.log --baseline bench_baseline.json --update
+"""
+
+import argparse
+import json
+import sys
+
+
+def parse(path):
+    results = {}
+    with open(path, errors="replace") as log:
+        for line in log:
+            fields = line.strip().split(",")
+            if len(fields) != 7 or fields[0] != "B":
+                continue
+            name = fields[1]
+            iterations, low, mean, high, clock = (int(f) for f in fields[2:])
+            results[name] = {"iterations": iterations, "min": low, "mean": mean,
+                             "max": high, "clock_hz": clock}
+    return results
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", help="UART capture containing B, lines")
+    parser.add_argument("--baseline", required=True, help="baseline JSON file")
+    parser.add_argument("--update", action="store_true", help="overwrite the baseline with this run")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="allowed growth of mean cycles, in percent (default 10)")
+    parser.add_argument("--json", help="also write this run's results to a JSON file")
+    args = parser.parse_args()
+
+    results = parse(args.log)
+    if not results:
+        sys.exit("no benchmark lines found in %s" % args.log)
+    if args.json:
+        with open(args.json, "w") as out:
+            json.dump(results, out, indent=2, sort_keys=True)
+    if args.update:
+        with open(args.baseline, "w") as out:
+            json.dump(results, out, indent=2, sort_keys=True)
+        print("baseline updated with %d functions" % len(results))
+        return
+
+    with open(args.baseline) as f:
+        baseline = json.load(f)
+
+    regressions = 0
+    print("%-26s %10s %10s %8s" % ("function", "baseline", "mean", "change"))
+    for name in sorted(results):
+        mean = results[name]["mean"]
+        if name not in baseline:
+            print("%-26s %10s %10d %8s" % (name, "-", mean, "new"))
+            continue
+        if baseline[name]["clock_hz"] != results[name]["clock_hz"]:
+            print("warning: %s measured at a different clock to its baseline" % name, file=sys.stderr)
+        base = baseline[name]["mean"]
+        change = (mean - base) * 100.0 / base if base else 0.0
+        flag = ""
+        if change > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-26s %10d %10d %+7.1f%%%s" % (name, base, mean, change, flag))
+    for name in sorted(set(baseline) - set(results)):
+        print("%-26s %10d %10s %8s" % (name, baseline[name]["mean"], "-", "missing"))
+
+    sys.exit(1 if regressions else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,184 @@
+#!/usr/bin/env python3
+"""Summarises flash and RAM use per module from a linker map file.
+
+Reads a TI ARM linker map (its MODULE SUMMARY table) or a GNU ld map (the
+input sections of its memory map) and gives the flash (code, read-only data
+and initialised data) and RAM (initialised and zeroed data) of each object
+file. Compared against a stored baseline, any module that grew by more than
+the threshold, and the totals, are flagged. Exits with status 1 when a
+regression is found.
+
+    python3 tools/mapsummary.py Debug/helicopter.map --baseline map_baseline.json
+    python3 tools/mapsummary.py Debug/helicopter.map --baseline map_baseline.json --update
+"""
+
+import argparse
+import json
+import os
+import re
+import sys
+
+FLASH_KB = 256      # TM4C123GH6PM
+SRAM_KB = 32
+
+TI_ROW = re.compile(r"^\s+(\S+\.(?:obj|o))\s+(\d+)\s+(\d+)\s+(\d+)\s*$")
+GNU_SECTION = re.compile(r"^ (\.\S+|COMMON)(?:\s+(0x[0-9a-fA-F]+)\s+(0x[0-9a-fA-F]+)\s+(\S+))?\s*$")
+GNU_WRAPPED = re.compile(r"^\s+(0x[0-9a-fA-F]+)\s+(0x[0-9a-fA-F]+)\s+(\S+\.(?:o|obj|a\(.*\)))\s*$")
+
+
+def module_name(path):
+    return os.path.basename(path.replace("\\", "/"))
+
+
+def add(modules, name, flash=0, ram=0):
+    entry = modules.setdefault(name, {"flash": 0, "ram": 0})
+    entry["flash"] += flash
+    entry["ram"] += ram
+
+
+def parse_ti(lines):
+    """MODULE SUMMARY rows: code, ro data, rw data. rw data is in RAM and,
+    for initialised data, also in flash, which the TI summary leaves out."""
+    modules = {}
+    in_summary = False
+    for line in lines:
+        if line.startswith("MODULE SUMMARY"):
+            in_summary = True
+            continue
+        if in_summary and line.startswith("SEGMENT ALLOCATION MAP"):
+            break
+        match = TI_ROW.match(line) if in_summary else None
+        if match:
+            code, ro, rw = (int(g) for g in match.groups()[1:])
+            add(modules, module_name(match.group(1)), flash=code + ro, ram=rw)
+    return modules
+
+
+def classify(section):
+    if section.startswith((".text", ".rodata", ".ARM", ".const", ".init_array")):
+        return "flash"
+    if section.startswith(".data"):
+        return "data"
+    if section.startswith((".bss", ".noinit")) or section == "COMMON":
+        return "ram"
+    return None
+
+
+def parse_gnu(lines):
+    """Input section lines of the memory map. Long section names put the
+    address, size and file on the next line."""
+    modules = {}
+    pending = None
+    in_map = False
+    for line in lines:
+        if line.startswith("Linker script and memory map"):
+            in_map = True
+            continue
+        if not in_map:
+            continue
+        match = GNU_SECTION.match(line)
+        if match:
+            section, _, size, path = match.groups()
+            if size is None:
+                pending = section
+                continue
+        else:
+            wrapped = GNU_WRAPPED.match(line)
+            if not (wrapped and pending):
+                pending = None
+                continue
+            section, size, path = pending, wrapped.group(2), wrapped.group(3)
+        pending = None
+        kind = classify(section)
+        size = int(size, 16)
+        if kind is None or size == 0:
+            continue
+        name = module_name(path)
+        if kind == "flash":
+            add(modules, name, flash=size)
+        elif kind == "data":
+            add(modules, name, flash=size, ram=size)
+        else:
+            add(modules, name, ram=size)
+    return modules
+
+
+def parse(path):
+    with open(path, errors="replace") as f:
+        lines = f.readlines()
+    if any(line.startswith("MODULE SUMMARY") for line in lines):
+        return parse_ti(lines)
+    return parse_gnu(lines)
+
+
+def totals(modules):
+    return {"flash": sum(m["flash"] for m in modules.values()),
+            "ram": sum(m["ram"] for m in modules.values())}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("map", help="linker map file")
+    parser.add_argument("--baseline", help="baseline JSON file to compare against")
+    parser.add_argument("--update", action="store_true", help="overwrite the baseline with this build")
+    parser.add_argument("--threshold", type=int, default=64,
+                        help="allowed growth of a module, in bytes (default 64)")
+    parser.add_argument("--json", help="also write this build's summary to a JSON file")
+    args = parser.parse_args()
+
+    modules = parse(args.map)
+    if not modules:
+        sys.exit("no modules found in %s" % args.map)
+    total = totals(modules)
+    if args.json:
+        with open(args.json, "w") as out:
+            json.dump(modules, out, indent=2, sort_keys=True)
+    if args.update:
+        if not args.baseline:
+            sys.exit("--update needs --baseline")
+        with open(args.baseline, "w") as out:
+            json.dump(modules, out, indent=2, sort_keys=True)
+        print("baseline updated with %d modules" % len(modules))
+        return
+
+    baseline = {}
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+
+    regressions = 0
+    print("%-24s %8s %8s %9s %9s" % ("module", "flash", "ram", "d flash", "d ram"))
+    for name in sorted(modules, key=lambda n: -(modules[n]["flash"] + modules[n]["ram"])):
+        entry = modules[name]
+        if name in baseline:
+            dflash = entry["flash"] - baseline[name]["flash"]
+            dram = entry["ram"] - baseline[name]["ram"]
+            delta = "%+9d %+9d" % (dflash, dram)
+        elif baseline:
+            dflash, dram = entry["flash"], entry["ram"]
+            delta = "%9s %9s" % ("new", "new")
+        else:
+            dflash = dram = 0
+            delta = ""
+        flag = ""
+        if dflash > args.threshold or dram > args.threshold:
+            flag = "  REGRESSION"
+            regressions += 1
+        print("%-24s %8d %8d %s%s" % (name, entry["flash"], entry["ram"], delta, flag))
+    for name in sorted(set(baseline) - set(modules)):
+        print("%-24s %8s %8s %9s" % (name, "-", "-", "removed"))
+
+    print("%-24s %8d %8d" % ("total", total["flash"], total["ram"]))
+    print("of %d KB flash (%.1f%%) and %d KB SRAM (%.1f%%), stack and heap not included"
+          % (FLASH_KB, total["flash"] * 100.0 / (FLASH_KB * 1024),
+             SRAM_KB, total["ram"] * 100.0 / (SRAM_KB * 1024)))
+    if baseline:
+        base = totals(baseline)
+        print("change since baseline: flash %+d, ram %+d"
+              % (total["flash"] - base["flash"], total["ram"] - base["ram"]))
+
+    sys.exit(1 if regressions else 0)
+
+
+if __name__ == "__main__":
+    main()
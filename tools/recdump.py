@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+"""Extracts a flight recorder dump from a captured UART log.
+
+The firmware (recorder.c, RECORD_ENABLED) sends one "R,<timestamp>,<source>,<value>"
+line per record after a landing, followed by "R,END,<dropped>". This script
+pulls those lines out of a terminal capture, unwraps the 32-bit cycle counter
+and writes a CSV with time in microseconds since the first record.
+
+    python3 tools/recdump.py capture.log -o flight.csv --clock-hz 80000000
+"""
+
+import argparse
+import csv
+import sys
+
+SOURCES = ["TICK", "ADC", "QUAD", "YAW_REF", "SWITCHES", "BUTTONS"]
+
+
+def parse(lines):
+    """Yields (cycles, source, value) for each record, with wrap-around removed."""
+    offset = 0
+    last = None
+    for line in lines:
+        fields = line.strip().split(",")
+        if len(fields) < 3 or fields[0] != "R":
+            continue
+        if fields[1] == "END":
+            if int(fields[2]):
+                print("warning: %s inputs dropped while dumping" % fields[2], file=sys.stderr)
+            last = None
+            offset = 0
+            continue
+        stamp, source, value = int(fields[1]), int(fields[2]), int(fields[3])
+        if last is not None and stamp < last:
+            offset += 1 << 32
+        last = stamp
+        yield stamp + offset, source, value
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", help="UART capture containing R, lines")
+    parser.add_argument("-o", "--output", default="-", help="CSV file (default stdout)")
+    parser.add_argument("--clock-hz", type=int, default=80000000,
+                        help="system clock the recording was made at")
+    args = parser.parse_args()
+
+    with open(args.log, errors="replace") as log:
+        records = list(parse(log))
+    if not records:
+        sys.exit("no recorder lines found in %s" % args.log)
+
+    out = sys.stdout if args.output == "-" else open(args.output, "w", newline="")
+    writer = csv.writer(out)
+    writer.writerow(["time_us", "source", "value"])
+    start = records[0][0]
+    for cycles, source, value in records:
+        name = SOURCES[source] if source < len(SOURCES) else str(source)
+        writer.writerow(["%.3f" % ((cycles - start) * 1e6 / args.clock_hz), name, value])
+
+
+if __name__ == "__main__":
+    main()
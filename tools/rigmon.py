@@ -0,0 +1,259 @@
+#!/usr/bin/env python3
+"""Monitors the telemetry of several rigs at once.
+
+Each rig's UART, a serial port or the pseudo-terminal of a SITL run
+(sitl/sitl.c), is read through one epoll loop. Everything received is
+written unchanged to <logdir>/<rig>.log, so recdump.py, trace2chrome.py and
+benchcheck.py work on those logs as on any capture. The lines are decoded
+as they arrive:
+
+  status line (UARTFormatStatus, uart.c)  altitude and yaw error while flying
+  "Diag:" line (UARTPrintDiag, uart.c)    controller rate, UART drop count
+  "Boot:" lines (retain.c, system.c)      resets
+
+Every TELEMETRY_RATE_HZ status line, the once a second diagnostics and the
+replies and dumps (OK/ERR, R/T/P/B/CAL records) are recognised; anything
+else is counted as a bad line, a line garbled on the way. Dropped frames
+are the status lines the firmware could not queue (its UART drop count)
+plus the bad lines. Statistics over the last --window seconds are printed
+for every rig each --interval seconds. A rig that hangs up or cannot be
+opened is retried each interval.
+
+    python3 tools/rigmon.py rig1=/dev/ttyACM0 rig2=/dev/ttyACM1 --logdir logs
+    python3 tools/rigmon.py sim=/tmp/heli.pty --window 5
+"""
+
+import argparse
+import errno
+import os
+import re
+import select
+import sys
+import termios
+import time
+import tty
+
+READ_SIZE = 65536
+FLYING = (0, 3)          # SubMode FLY and PLAN (rotors.h)
+MODE_NAMES = {0: "FLY", 1: "TAKEOFF", 2: "LANDED", 3: "PLAN"}
+
+STATUS = re.compile(rb"Alt Desired \(%\):\s*(-?\d+), Alt Actual \(%\):\s*(-?\d+), "
+                    rb"Yaw Desired \(deg\):\s*(-?\d+), Yaw Actual \(deg\):\s*(-?\d+), "
+                    rb"M-Rot \(%\):\s*\d+\.\d+, T-Rot \(%\):\s*\d+\.\d+, Mode: (\d+)$")
+DIAG = re.compile(rb"Diag: .*Ctrl \(/s\):\s*(\d+),.*UART drops: (\d+)$")
+KNOWN = (b"Diag", b"Boot:", b"Takeoff", b"OK", b"ERR", b"R,", b"T,", b"P,", b"B,", b"CAL,")
+
+
+class Bucket:
+    """Totals for one second of one rig."""
+    __slots__ = ("second", "lines", "status", "bad", "drops", "ctrl",
+                 "alt_n", "alt_sum", "alt_max", "yaw_n", "yaw_sum", "yaw_max")
+
+    def __init__(self, second):
+        self.second = second
+        self.lines = self.status = self.bad = self.drops = 0
+        self.ctrl = None
+        self.alt_n = self.alt_sum = self.alt_max = 0
+        self.yaw_n = self.yaw_sum = self.yaw_max = 0
+
+
+class Rig:
+    def __init__(self, name, path, logdir, window):
+        self.name = name
+        self.path = path
+        self.fd = None
+        self.partial = b""
+        self.log = open(os.path.join(logdir, name + ".log"), "ab", buffering=READ_SIZE)
+        self.window = window
+        self.buckets = [Bucket(-1) for _ in range(window + 1)]   # and the second filling
+        self.bucket = self.buckets[0]
+        self.mode = None
+        self.boots = 0
+        self.uart_drops = None   # Firmware count at the last Diag line
+        self.error = ""
+
+    def open(self, epoll, baud):
+        try:
+            fd = os.open(self.path, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+        except OSError as e:
+            self.error = e.strerror
+            return
+        if os.isatty(fd):
+            tty.setraw(fd)
+            attrs = termios.tcgetattr(fd)
+            attrs[4] = attrs[5] = baud
+            termios.tcsetattr(fd, termios.TCSANOW, attrs)
+        self.fd = fd
+        self.partial = b""
+        self.error = ""
+        epoll.register(fd, select.EPOLLIN | select.EPOLLET)
+
+    def close(self, epoll, reason):
+        epoll.unregister(self.fd)
+        os.close(self.fd)
+        self.fd = None
+        self.error = reason
+
+    def roll(self, second):
+        """Moves to the bucket for this second, clearing it if it is stale."""
+        bucket = self.buckets[second % len(self.buckets)]
+        if bucket.second != second:
+            bucket.__init__(second)
+        self.bucket = bucket
+
+    def read(self, epoll, second):
+        """Drains the descriptor, as the registration is edge triggered."""
+        self.roll(second)
+        while True:
+            try:
+                data = os.read(self.fd, READ_SIZE)
+            except BlockingIOError:
+                return
+            except OSError as e:
+                # A pty whose other end has gone reads EIO
+                self.close(epoll, "hung up" if e.errno == errno.EIO else e.strerror)
+                return
+            if not data:
+                self.close(epoll, "hung up")
+                return
+            self.log.write(data)
+            lines = (self.partial + data).split(b"\n")
+            self.partial = lines.pop()
+            for line in lines:
+                self.decode(line.rstrip(b"\r"))
+
+    def decode(self, line):
+        bucket = self.bucket
+        bucket.lines += 1
+        if line.startswith(b"Alt Desired"):
+            match = STATUS.match(line)
+            if not match:
+                bucket.bad += 1
+                return
+            alt_set, alt, yaw_set, yaw, mode = (int(f) for f in match.groups())
+            bucket.status += 1
+            self.mode = mode
+            if mode in FLYING:
+                alt_err = abs(alt_set - alt)
+                yaw_err = abs((yaw_set - yaw + 180) % 360 - 180)
+                bucket.alt_n += 1
+                bucket.alt_sum += alt_err
+                bucket.alt_max = max(bucket.alt_max, alt_err)
+                bucket.yaw_n += 1
+                bucket.yaw_sum += yaw_err
+                bucket.yaw_max = max(bucket.yaw_max, yaw_err)
+        elif line.startswith(b"Diag: "):
+            match = DIAG.match(line)
+            if not match:
+                bucket.bad += 1
+                return
+            bucket.ctrl = int(match.group(1))
+            drops = int(match.group(2))
+            if self.uart_drops is not None:
+                # The count starts again from zero after a reset
+                bucket.drops += drops - self.uart_drops if drops >= self.uart_drops else drops
+            self.uart_drops = drops
+        elif line.startswith(b"Boot: ready"):
+            self.boots += 1
+        elif line and not line.startswith(KNOWN):
+            bucket.bad += 1
+
+    def summary(self, second):
+        """Statistics over the window, up to the second before this one."""
+        window = sorted((b for b in self.buckets if second - self.window <= b.second < second),
+                        key=lambda b: b.second)
+        seconds = self.window
+        lines = sum(b.lines for b in window)
+        status = sum(b.status for b in window)
+        drops = sum(b.drops + b.bad for b in window)
+        ctrl = [b.ctrl for b in window if b.ctrl is not None]
+        alt_n = sum(b.alt_n for b in window)
+        yaw_n = sum(b.yaw_n for b in window)
+        return {
+            "rig": self.name,
+            "state": self.error or "up",
+            "lines": lines / seconds,
+            "status": status / seconds,
+            "ctrl": ctrl[-1] if ctrl else None,
+            "drops": drops,
+            "alt_mean": sum(b.alt_sum for b in window) / alt_n if alt_n else None,
+            "alt_max": max((b.alt_max for b in window if b.alt_n), default=None),
+            "yaw_mean": sum(b.yaw_sum for b in window) / yaw_n if yaw_n else None,
+            "yaw_max": max((b.yaw_max for b in window if b.yaw_n), default=None),
+            "mode": MODE_NAMES.get(self.mode, "-"),
+            "boots": self.boots,
+        }
+
+
+def cell(value, spec):
+    return format(value, spec) if value is not None else "-"
+
+
+def report(rigs, second, window, out):
+    out.write("%s, last %d s\n" % (time.strftime("%H:%M:%S"), window))
+    out.write("%-12s %-8s %8s %8s %6s %6s %16s %16s %-8s %5s\n"
+              % ("rig", "state", "lines/s", "status/s", "ctrl/s", "drops",
+                 "alt err mean/max", "yaw err mean/max", "mode", "boots"))
+    for rig in rigs:
+        s = rig.summary(second)
+        alt = "%s/%s" % (cell(s["alt_mean"], ".1f"), cell(s["alt_max"], "d"))
+        yaw = "%s/%s" % (cell(s["yaw_mean"], ".1f"), cell(s["yaw_max"], "d"))
+        out.write("%-12s %-8s %8.1f %8.1f %6s %6d %16s %16s %-8s %5d\n"
+                  % (s["rig"][:12], s["state"][:8], s["lines"], s["status"], cell(s["ctrl"], "d"),
+                     s["drops"], alt, yaw, s["mode"], s["boots"]))
+    out.write("\n")
+    out.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("rigs", nargs="+", metavar="[NAME=]PATH",
+                        help="serial port or pty of a rig, named after the file if NAME is not given")
+    parser.add_argument("--logdir", default=".", help="directory for the <rig>.log files (default .)")
+    parser.add_argument("--baud", type=int, default=115200, help="serial port rate (default 115200)")
+    parser.add_argument("--window", type=int, default=10, help="seconds of statistics (default 10)")
+    parser.add_argument("--interval", type=float, default=5.0, help="seconds between reports (default 5)")
+    args = parser.parse_args()
+
+    baud = getattr(termios, "B%d" % args.baud, None)
+    if baud is None:
+        sys.exit("unsupported baud rate %d" % args.baud)
+    os.makedirs(args.logdir, exist_ok=True)
+
+    rigs = []
+    for spec in args.rigs:
+        name, _, path = spec.rpartition("=")
+        name = name or os.path.basename(path)
+        if any(rig.name == name for rig in rigs):
+            sys.exit("two rigs named %s" % name)
+        rigs.append(Rig(name, path, args.logdir, args.window))
+
+    epoll = select.epoll()
+    by_fd = {}
+    next_report = time.monotonic()
+    try:
+        while True:
+            now = time.monotonic()
+            if now >= next_report:
+                for rig in rigs:
+                    if rig.fd is None:
+                        rig.open(epoll, baud)
+                        if rig.fd is not None:
+                            by_fd[rig.fd] = rig
+                    rig.log.flush()
+                report(rigs, int(now), args.window, sys.stdout)
+                next_report = now + args.interval
+            for fd, _ in epoll.poll(next_report - now):
+                rig = by_fd[fd]
+                rig.read(epoll, int(time.monotonic()))
+                if rig.fd is None:
+                    del by_fd[fd]
+    except KeyboardInterrupt:
+        pass
+    finally:
+        for rig in rigs:
+            rig.log.close()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+"""Runs the SITL regression checks.
+
+Each check flies a console script from sitl/scripts through the SITL build
+(sitl/sitl.c), as fast as the host allows, with the UART written to a log,
+then tests what the firmware sent. A script's virtual times fix the run, so
+it gives the same log every time. Exits with status 1 if any check fails.
+
+  waypoints   24 quarter-turn waypoints, six turns the same way round;
+              every one reached (plan.c)
+  slew        179 degree yaw steps each way within SLEW_HALF_TURN_MS, and
+              2 degree steps across the wrap the short way (yaw.c)
+  refreverse  the reference slot entered and left by the same edge, then
+              crossed; the yaw frame zeroed on the slot centre, not that
+              edge (yaw.c). Replays scripts/refreverse.csv
+
+    make -C sitl && python3 tools/sitlcheck.py
+    python3 tools/sitlcheck.py waypoints --keep logs
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SITL = os.path.join(ROOT, "sitl", "build", "heli-sitl")
+SCRIPTS = os.path.join(ROOT, "sitl", "scripts")
+
+SLEW_HALF_TURN_MS = 4000     # Worst case yaw step, measured 2.8 to 3.4 s
+SLEW_HALF_TURNS = (1, 3, 4, 6)
+SLEW_WRAP_STEPS = (2, 5)
+SLEW_WRAP_MS = 100
+SLEW_HOLD_ERR_MAX = 10       # Degrees while holding; a turn the long way is far more
+REF_CENTRE_ERR_MAX = 1       # Degrees; the slot edge is 4 from its centre
+
+
+def plan_results(lines):
+    """The P,<i>,... waypoint records and the P,END time, if the plan ended."""
+    results, end = [], None
+    for line in lines:
+        fields = line.split(",")
+        if fields[0] != "P" or len(fields) < 3:
+            continue
+        if fields[1] == "END":
+            end = int(fields[2])
+        elif fields[1].isdigit() and len(fields) == 7:
+            results.append([int(f) for f in fields[1:]])
+    return results, end
+
+
+def check_waypoints(lines):
+    results, end = plan_results(lines)
+    failures = []
+    if len(results) != 24:
+        failures.append("%d of 24 waypoints reported" % len(results))
+    for index, arrive_ms, alt_err, yaw_err, alt_max, yaw_max in results:
+        if arrive_ms < 0:
+            failures.append("waypoint %d not reached, yaw error %d deg" % (index, yaw_err))
+    if end is None:
+        failures.append("plan did not end")
+    return failures
+
+
+def check_slew(lines):
+    results, end = plan_results(lines)
+    failures = []
+    if len(results) != 7 or end is None:
+        return ["%d of 7 steps reported%s" % (len(results), "" if end is not None else ", no end")]
+    for index, arrive_ms, alt_err, yaw_err, alt_max, yaw_max in results:
+        limit = (SLEW_HALF_TURN_MS if index in SLEW_HALF_TURNS
+                 else SLEW_WRAP_MS if index in SLEW_WRAP_STEPS else None)
+        if arrive_ms < 0 or (limit is not None and arrive_ms > limit):
+            failures.append("step %d arrived in %d ms, limit %s" % (index, arrive_ms, limit))
+        if yaw_max > SLEW_HOLD_ERR_MAX:
+            failures.append("step %d held to within %d deg, limit %d"
+                            % (index, yaw_max, SLEW_HOLD_ERR_MAX))
+    return failures
+
+
+def check_refreverse(lines):
+    if not any(line.startswith("Takeoff") for line in lines):
+        return ["reference not found, no takeoff"]
+    status = [line for line in lines if line.startswith("Alt Desired")]
+    yaw = int(status[-1].split(",")[3].split(":")[1])
+    if abs(yaw) > REF_CENTRE_ERR_MAX:
+        return ["held at the slot centre, read %d deg, limit %d" % (yaw, REF_CENTRE_ERR_MAX)]
+    return []
+
+
+# Console script, recorder dump to replay or None, test
+CHECKS = {
+    "waypoints": ("waypoints.txt", None, check_waypoints),
+    "slew": ("slew.txt", None, check_slew),
+    "refreverse": ("refreverse.txt", "refreverse.csv", check_refreverse),
+}
+
+
+def run(name, logdir):
+    script, replay, test = CHECKS[name]
+    log = os.path.join(logdir, name + ".log")
+    args = [SITL, "--fast", "--log", log]
+    if replay:
+        args += ["--replay", os.path.join(SCRIPTS, replay)]
+    with open(os.path.join(SCRIPTS, script)) as console:
+        sim = subprocess.run(args, stdin=console,
+                             stderr=subprocess.PIPE, universal_newlines=True)
+    if sim.returncode != 0:
+        return ["heli-sitl exited with %d: %s" % (sim.returncode, sim.stderr.strip())]
+    with open(log, errors="replace") as f:
+        return test([line.rstrip("\r\n") for line in f])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("checks", nargs="*", metavar="CHECK",
+                        help="checks to run (default all): %s" % ", ".join(CHECKS))
+    parser.add_argument("--keep", metavar="DIR", help="keep the UART logs in DIR")
+    args = parser.parse_args()
+
+    unknown = [name for name in args.checks if name not in CHECKS]
+    if unknown:
+        sys.exit("unknown check %s" % ", ".join(unknown))
+    if not os.path.exists(SITL):
+        sys.exit("%s not built, run make -C sitl" % SITL)
+
+    failed = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        logdir = args.keep or tmp
+        os.makedirs(logdir, exist_ok=True)
+        for name in args.checks or CHECKS:
+            failures = run(name, logdir)
+            print("%-12s %s" % (name, "FAIL" if failures else "ok"))
+            for failure in failures:
+                print("    " + failure)
+            failed += bool(failures)
+    sys.exit(1 if failed else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""Converts an execution trace dump into a Chrome trace JSON timeline.
+
+The firmware (trace.c, TRACE_ENABLED) sends "T,START,<clock Hz>,<shift>,<records>",
+then one "T,<time>,<id>,<end>" line per record and "T,END". Times are the
+cycle counter shifted right by <shift>, in 24 bits. This script pulls those
+lines out of a terminal capture, unwraps the time and writes begin/end
+events that chrome://tracing or https://ui.perfetto.dev can open. Interrupt
+handlers and kernel tasks are shown on separate tracks; a capture with
+several dumps gives one process per dump.
+
+    python3 tools/trace2chrome.py capture.log -o takeoff.json
+"""
+
+import argparse
+import json
+import sys
+
+# Trace ids, in the order of IsrId (isrstats.h) then TraceId (trace.h).
+NAMES = ["YawIntHandler", "YawRefIntHandler", "SysTickIntHandler", "ADCIntHandler",
+         "ModeSWTickIntHandler", "UARTIntHandler", "ButtonIntHandler",
+         "KernelTick", "Controller", "SysTick tasks", "DisplayProject", "UARTSend",
+         "PlanService", "Idle"]
+NUM_ISRS = 7
+TIME_BITS = 24
+
+ISR_TRACK = 1
+KERNEL_TRACK = 2
+
+
+def parse(lines):
+    """Yields (clock_hz, [(cycles, id, end), ...]) for each complete dump."""
+    header = None
+    records = []
+    for line in lines:
+        fields = line.strip().split(",")
+        if len(fields) < 2 or fields[0] != "T":
+            continue
+        if fields[1] == "START":
+            header = (int(fields[2]), int(fields[3]), int(fields[4]))
+            records = []
+        elif fields[1] == "END":
+            if header is None:
+                continue
+            if len(records) != header[2]:
+                print("warning: dump has %d of %d records" % (len(records), header[2]),
+                      file=sys.stderr)
+            yield header[0], unwrap(records, header[1])
+            header = None
+        elif header is not None and len(fields) == 4:
+            records.append((int(fields[1]), int(fields[2]), int(fields[3])))
+
+
+def unwrap(records, shift):
+    """Turns the 24-bit shifted times into cycles since the first record."""
+    out = []
+    offset = 0
+    last = None
+    for stamp, ident, end in records:
+        if last is not None and stamp < last:
+            offset += 1 << TIME_BITS
+        last = stamp
+        out.append(((stamp + offset) << shift, ident, end))
+    if out:
+        start = out[0][0]
+        out = [(cycles - start, ident, end) for cycles, ident, end in out]
+    return out
+
+
+def name_of(ident):
+    return NAMES[ident] if ident < len(NAMES) else "id %d" % ident
+
+
+def events(pid, clock_hz, records):
+    """Chrome trace events for one dump. Begin/end pairs must nest on each
+    track, so an end whose begin came before the capture started is dropped
+    and anything still open at the end is closed there."""
+    stacks = {ISR_TRACK: [], KERNEL_TRACK: []}
+    out = [{"ph": "M", "name": "thread_name", "pid": pid, "tid": ISR_TRACK,
+            "args": {"name": "Interrupts"}},
+           {"ph": "M", "name": "thread_name", "pid": pid, "tid": KERNEL_TRACK,
+            "args": {"name": "Kernel"}}]
+    last_us = 0.0
+    for cycles, ident, end in records:
+        tid = ISR_TRACK if ident < NUM_ISRS else KERNEL_TRACK
+        us = cycles * 1e6 / clock_hz
+        last_us = us
+        stack = stacks[tid]
+        if not end:
+            stack.append(ident)
+            out.append({"ph": "B", "name": name_of(ident), "pid": pid, "tid": tid, "ts": us})
+        elif ident in stack:
+            while stack:
+                open_id = stack.pop()
+                out.append({"ph": "E", "name": name_of(open_id), "pid": pid, "tid": tid, "ts": us})
+                if open_id == ident:
+                    break
+    for tid, stack in stacks.items():
+        while stack:
+            open_id = stack.pop()
+            out.append({"ph": "E", "name": name_of(open_id), "pid": pid, "tid": tid, "ts": last_us})
+    return out
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("log", help="UART capture containing T, lines")
+    parser.add_argument("-o", "--output", default="-", help="JSON file (default stdout)")
+    args = parser.parse_args()
+
+    with open(args.log, errors="replace") as log:
+        dumps = list(parse(log))
+    if not dumps:
+        sys.exit("no complete trace dumps found in %s" % args.log)
+
+    trace = []
+    for pid, (clock_hz, records) in enumerate(dumps, start=1):
+        trace.extend(events(pid, clock_hz, records))
+
+    out = sys.stdout if args.output == "-" else open(args.output, "w")
+    json.dump({"traceEvents": trace, "displayTimeUnit": "ns"}, out)
+    out.write("\n")
+
+
+if __name__ == "__main__":
+    main()
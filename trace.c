@@ -0,0 +1,160 @@
+//*******************************************************************************
+// trace.c
+//
+// Execution trace of the interrupt handlers and kernel tasks. Each handler
+// and task writes a one word record, a cycle timestamp with its id, as it
+// begins and ends. Capture starts at takeoff or on "TRACE START" and stops
+// when the buffer is full or on "TRACE STOP"; the trace is then sent over
+// UART, to be turned into a Chrome trace timeline by tools/trace2chrome.py.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "driverlib/cpu.h"
+#include "utils/ustdlib.h"
+#include "system.h"
+#include "uart.h"
+#include "trace.h"
+
+typedef enum {
+    TRACE_STOPPED = 0,
+    TRACE_RUNNING,
+    TRACE_SENDING
+} TraceState;
+
+//*****************************************************************************
+// Each record is the timestamp >> TRACE_TIME_SHIFT in the top 24 bits, then
+// the id, then 1 for an end or 0 for a begin in bit 0. The 24 bit time
+// wraps every 2^28 cycles (3.3 s at 80 MHz); SysTick is traced every tick,
+// so the host can always unwrap it.
+//*****************************************************************************
+static uint32_t traceBuf[TRACE_BUF_SIZE];
+static uint16_t traceCount = 0;      // Records captured
+static uint16_t traceSent = 0;       // Records sent so far
+static bool traceHeaderSent = false;
+static volatile TraceState traceState = TRACE_STOPPED;
+
+//*****************************************************************************
+// Stores one record. Interrupts are masked while the slot is claimed, as
+// handlers preempt the kernel tasks and each other. A full buffer ends the
+// capture.
+//*****************************************************************************
+RAMFUNC void
+TraceWrite(uint8_t id, bool end, uint32_t timestamp)
+{
+    uint32_t masked = CPUcpsid();
+
+    if (traceState == TRACE_RUNNING)
+    {
+        traceBuf[traceCount++] = ((timestamp >> TRACE_TIME_SHIFT) << 8) | ((uint32_t)id << 1) | end;
+        if (traceCount >= TRACE_BUF_SIZE)
+        {
+            traceState = TRACE_SENDING;
+        }
+    }
+
+    if (!masked)
+    {
+        CPUcpsie();
+    }
+}
+
+//*****************************************************************************
+// Starts a new capture, unless one is being sent.
+//*****************************************************************************
+void
+TraceStart(void)
+{
+    if (traceState == TRACE_SENDING)
+    {
+        return;
+    }
+    traceCount = 0;
+    traceSent = 0;
+    traceHeaderSent = false;
+    traceState = TRACE_RUNNING;
+}
+
+//*****************************************************************************
+// Ends the capture so it is sent by TraceDump.
+//*****************************************************************************
+void
+TraceStop(void)
+{
+    uint32_t masked = CPUcpsid();
+
+    if (traceState == TRACE_RUNNING)
+    {
+        traceState = TRACE_SENDING;
+    }
+    if (!masked)
+    {
+        CPUcpsie();
+    }
+}
+
+//*****************************************************************************
+// Acts on "TRACE START" and "TRACE STOP".
+//*****************************************************************************
+void
+TraceCommand(const char* args)
+{
+    if (ustrncmp(args, "START", 6) == 0)
+    {
+        if (traceState == TRACE_SENDING)
+        {
+            UARTSend("ERR TRACE sending\r\n");
+            return;
+        }
+        TraceStart();
+        UARTSend("OK TRACE START\r\n");
+    }
+    else if (ustrncmp(args, "STOP", 5) == 0)
+    {
+        TraceStop();
+        UARTSend("OK TRACE STOP\r\n");
+    }
+    else
+    {
+        UARTSend("ERR TRACE needs START or STOP\r\n");
+    }
+}
+
+//*****************************************************************************
+// Background task: sends "T,START,<clock Hz>,<shift>,<records>", then one
+// "T,<time>,<id>,<end>" line per record and finally "T,END", one line per
+// call and only when the transmit ring has room for it.
+//*****************************************************************************
+void
+TraceDump(void)
+{
+    char line[40];
+
+    if (traceState != TRACE_SENDING || UARTTxSpace() < sizeof(line))
+    {
+        return;
+    }
+
+    if (!traceHeaderSent)
+    {
+        usnprintf(line, sizeof(line), "T,START,%u,%u,%u\r\n",
+                  SYSTEM_CLOCK_HZ, TRACE_TIME_SHIFT, traceCount);
+        traceHeaderSent = true;
+    }
+    else if (traceSent < traceCount)
+    {
+        uint32_t record = traceBuf[traceSent++];
+        usnprintf(line, sizeof(line), "T,%u,%u,%u\r\n",
+                  record >> 8, (record >> 1) & 0x7F, record & 1);
+    }
+    else
+    {
+        usnprintf(line, sizeof(line), "T,END\r\n");
+        traceState = TRACE_STOPPED;
+    }
+    UARTSend(line);
+}
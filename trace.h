@@ -0,0 +1,77 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+//*******************************************************************************
+// trace.c
+//
+// Execution trace of the interrupt handlers and kernel tasks. Each handler
+// and task writes a one word record, a cycle timestamp with its id, as it
+// begins and ends. Capture starts at takeoff or on "TRACE START" and stops
+// when the buffer is full or on "TRACE STOP"; the trace is then sent over
+// UART, to be turned into a Chrome trace timeline by tools/trace2chrome.py.
+// Handlers are traced from IsrEnter/IsrExit, so ISR_STATS_ENABLED must be
+// set as well.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "system.h"
+#include "isrstats.h"
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+#define TRACE_ENABLED      0        // Set to 1 to trace handlers and tasks
+#define TRACE_BUF_SIZE     2048     // Records held (4 bytes each)
+#define TRACE_TIME_SHIFT   4        // Timestamps kept in units of 16 cycles
+
+// What each record traces. Handlers keep their IsrId; the kernel tasks
+// follow. Keep in step with NAMES in tools/trace2chrome.py.
+typedef enum {
+    TRACE_KERNEL_TICK = NUM_ISRS,   // KernelTick, everything below nests in it
+    TRACE_CONTROLLER,               // PlanStep, ControllerImplementation, SetPWM
+    TRACE_TASKS,                    // SysTick(): buttons, telemetry, diagnostics
+    TRACE_DISPLAY,                  // DisplayProject
+    TRACE_UART_SEND,                // UARTSend
+    TRACE_COMMANDS,                 // PlanService
+    TRACE_IDLE,                     // Asleep in KernelIdle
+    NUM_TRACE_IDS
+} TraceId;
+
+// Hooks placed around the kernel tasks, compiled out unless TRACE_ENABLED
+// is set.
+#if TRACE_ENABLED
+#define TRACE_BEGIN(id)   TraceWrite((id), false, GetTimestamp())
+#define TRACE_END(id)     TraceWrite((id), true, GetTimestamp())
+#else
+#define TRACE_BEGIN(id)
+#define TRACE_END(id)
+#endif
+
+//*****************************************************************************
+// Stores one record while a capture is running. Safe to call from both
+// interrupt and kernel context.
+void TraceWrite(uint8_t id, bool end, uint32_t timestamp);
+
+//*****************************************************************************
+// Starts a new capture, unless one is being sent.
+void TraceStart(void);
+
+//*****************************************************************************
+// Ends the capture so it is sent by TraceDump.
+void TraceStop(void);
+
+//*****************************************************************************
+// Acts on a "TRACE ..." command line, args being the text after "TRACE ".
+void TraceCommand(const char* args);
+
+//*****************************************************************************
+// Background task: sends one record of a finished capture over UART per call,
+// when the transmit ring has room.
+void TraceDump(void);
+
+#endif /* TRACE_H_ */
@@ -15,7 +15,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "inc/hw_memmap.h"
+#include "inc/hw_ints.h"
 #include "driverlib/gpio.h"
+#include "driverlib/interrupt.h"
 #include "driverlib/sysctl.h"
 #include "driverlib/debug.h"
 #include "utils/ustdlib.h"
@@ -27,6 +29,13 @@
 #include "system.h"
 #include "uart.h"
 #include "rotors.h"
+#include "kernel.h"
+#include "events.h"
+#include "watchdog.h"
+#include "isrstats.h"
+#include "trace.h"
+#include "memstats.h"
+#include "snapshot.h"
 
 //*****************************************************************************
 // Global Variables
@@ -34,6 +43,20 @@
 
 static char statusStr[MAX_STR_LEN + 1];    // Serial status string for troubleshooting (UART)
 
+// Transmit ring. UARTSend writes at txHead from the kernel, the interrupt
+// handler reads from txTail; one slot is left empty to tell full from empty.
+static char txBuf[UART_TX_BUF_SIZE];
+static volatile uint16_t txHead = 0;
+static volatile uint16_t txTail = 0;
+volatile uint32_t uartTxDropped = 0;
+
+// Receive ring. The interrupt handler writes at rxHead, UARTReadLine reads
+// from rxTail into the line being assembled.
+static char rxBuf[UART_RX_BUF_SIZE];
+static volatile uint16_t rxHead = 0;
+static volatile uint16_t rxTail = 0;
+volatile uint32_t uartRxDropped = 0;
+
 //*****************************************************************************
 // Intialises UART, allowing communication between the TIVA board and a terminal.
 //*****************************************************************************
@@ -52,26 +75,168 @@ initialiseUSB_UART (void)
     GPIOPinConfigure (GPIO_PA0_U0RX);
     GPIOPinConfigure (GPIO_PA1_U0TX);
 
-    UARTConfigSetExpClk(UART_USB_BASE, SysCtlClockGet(), BAUD_RATE,
+    UARTConfigSetExpClk(UART_USB_BASE, SYSTEM_CLOCK_HZ, BAUD_RATE,
             UART_CONFIG_WLEN_8 | UART_CONFIG_STOP_ONE |
             UART_CONFIG_PAR_NONE);
     UARTFIFOEnable(UART_USB_BASE);
+    UARTFIFOLevelSet(UART_USB_BASE, UART_FIFO_TX1_8, UART_FIFO_RX4_8);
+
+    // Transmit and receive are interrupt driven so the kernel never blocks.
+    // The receive timeout interrupt collects the tail of a short command.
+    UARTIntRegister(UART_USB_BASE, UARTIntHandler);
+    UARTIntEnable(UART_USB_BASE, UART_INT_TX | UART_INT_RX | UART_INT_RT);
     UARTEnable(UART_USB_BASE);
 }
 
+//*****************************************************************************
+// Moves characters from the transmit ring into the UART FIFO until one is
+// empty or the other is full.
+//*****************************************************************************
+RAMFUNC static void
+UARTFillFIFO (void)
+{
+    while ((txTail != txHead) && UARTSpaceAvail(UART_USB_BASE))
+    {
+        UARTCharPutNonBlocking(UART_USB_BASE, txBuf[txTail]);
+        txTail = (txTail + 1) % UART_TX_BUF_SIZE;
+    }
+}
+
+//*****************************************************************************
+// UART interrupt handler. The transmit interrupt fires as the FIFO drains
+// below its trigger level; it is refilled from the ring. Received characters
+// are moved into the receive ring, or dropped and counted if it is full.
+//*****************************************************************************
+RAMFUNC void
+UARTIntHandler (void)
+{
+    ISR_ENTER(ISR_UART);
+    uint32_t status = UARTIntStatus(UART_USB_BASE, true);
+    UARTIntClear(UART_USB_BASE, status);
+
+    while (UARTCharsAvail(UART_USB_BASE))
+    {
+        char c = (char)UARTCharGetNonBlocking(UART_USB_BASE);
+        uint16_t next = (rxHead + 1) % UART_RX_BUF_SIZE;
+        if (next == rxTail)
+        {
+            uartRxDropped++;
+        }
+        else
+        {
+            rxBuf[rxHead] = c;
+            rxHead = next;
+        }
+    }
+
+    UARTFillFIFO();
+    ISR_EXIT(ISR_UART);
+}
+
+//*****************************************************************************
+// Assembles received characters into line. A carriage return or line feed
+// ends the line; empty lines are ignored, and a line longer than
+// UART_LINE_LEN is discarded whole rather than acted on truncated.
+//*****************************************************************************
+bool
+UARTReadLine (char *line)
+{
+    static uint16_t length = 0;
+    static bool overlong = false;
+
+    while (rxTail != rxHead)
+    {
+        char c = rxBuf[rxTail];
+        rxTail = (rxTail + 1) % UART_RX_BUF_SIZE;
+
+        if (c == '\r' || c == '\n')
+        {
+            bool complete = (length > 0) && !overlong;
+            line[length] = '\0';
+            length = 0;
+            overlong = false;
+            if (complete)
+            {
+                return true;
+            }
+        }
+        else if (length < UART_LINE_LEN)
+        {
+            line[length++] = c;
+        }
+        else
+        {
+            overlong = true;
+        }
+    }
+    return false;
+}
+
+//*****************************************************************************
+// Returns the free space in the transmit ring, in characters.
+//*****************************************************************************
+uint16_t
+UARTTxSpace (void)
+{
+    return (txTail + UART_TX_BUF_SIZE - txHead - 1) % UART_TX_BUF_SIZE;
+}
+
 //*****************************************************************************
 // Function to send serial communication from microcontroller to computer.
+// The string is copied into the transmit ring and the FIFO is primed; the
+// UART interrupt sends the rest. The whole string is dropped if it does not
+// fit, so a slow terminal never receives half a line.
 //*****************************************************************************
 void
 UARTSend (char *pucBuffer)
 {
+    uint16_t length = 0;
+
+    TRACE_BEGIN(TRACE_UART_SEND);
+    while (pucBuffer[length])
+    {
+        length++;
+    }
+    if (length > UARTTxSpace())
+    {
+        uartTxDropped++;
+        TRACE_END(TRACE_UART_SEND);
+        return;
+    }
+
     // Loop while there are more characters to send.
     while(*pucBuffer)
     {
-        // Write the next character to the UART Tx FIFO.
-        UARTCharPut(UART_USB_BASE, *pucBuffer);
+        txBuf[txHead] = *pucBuffer;
+        txHead = (txHead + 1) % UART_TX_BUF_SIZE;
         pucBuffer++;
     }
+
+    // The handler must not refill the FIFO at the same time. It is held off
+    // in the NVIC, not the UART, as it also runs when pended with no UART
+    // interrupt raised (IsrProbe); one pended meanwhile runs afterwards.
+    IntDisable(INT_UART0);
+    UARTFillFIFO();
+    IntEnable(INT_UART0);
+    TRACE_END(TRACE_UART_SEND);
+}
+
+//*****************************************************************************
+// Formats the helicopter status line into str (at least MAX_STR_LEN + 1 long).
+// Kept apart from UARTPrint so the formatting cost can be benchmarked.
+//*****************************************************************************
+void
+UARTFormatStatus(char *str, Helicopter* heli)
+{
+    Snapshot snap;
+
+    SnapshotRead(&snap);  // Every field from the same tick
+
+    // Displays all information relating to helicopter altitude, yaw, rotors and mode.
+    usprintf(str, "Alt Desired (%%): %3d, Alt Actual (%%): %3d, Yaw Desired (deg): %4d, Yaw Actual (deg): %4d, M-Rot (%%): %2d.%02d, T-Rot (%%): %2d.%02d, Mode: %d\r\n",
+             snap.altitudeSetpoint, snap.altitude, snap.yawSetpoint,
+             snap.yaw, snap.mainDuty / 100, snap.mainDuty % 100,
+             snap.tailDuty / 100, snap.tailDuty % 100, snap.submode);
 }
 
 //*****************************************************************************
@@ -79,12 +244,97 @@ UARTSend (char *pucBuffer)
 //*****************************************************************************
 void UARTPrint(Helicopter* heli)
 {
-    int32_t yawAngle = GetYawAngleDegrees(heli);  // Outputs yaw in degrees
+    UARTFormatStatus(statusStr, heli);
+    UARTSend(statusStr);
+}
 
-    // Displays all information relating to helicopter altitude, yaw, rotors and mode.
-    usprintf(statusStr, "Alt Desired (%%): %3d, Alt Actual (%%): %3d, Yaw Desired (deg): %4d, Yaw Actual (deg): %4d, M-Rot (%%): %2d, T-Rot (%%): %2d, Mode: %d\r\n",
-             heli->controller->altitudesetpoint, heli->controller->curr_altitude_reading, heli->controller->yaw_increment,
-             yawAngle, heli->mainrotor->ui32Duty, heli->tailrotor->ui32Duty, heli->submode);
+//*****************************************************************************
+// Prints the once a second diagnostics line. CPU load is the share of the
+// last second the kernel was awake, in percent to one decimal place. The
+// controller updates, SetPWM calls and the PWM register writes they caused
+// are given per second. A second line gives the events lost to a full queue,
+// per type, and the deepest the queue has been. A third gives the late
+// ticks, the worst tick to PWM latency this second, the deadline fault and
+// the time boot took to get ready.
+// Then each handler's worst entry latency and duration since boot in
+// cycles, the altitude samples' trigger, rate, window and variance across
+// the window (and so of the window mean), the stack high-water mark, heap
+// and static RAM in bytes (see memstats.h), and last the learned hover duty, the value stored in EEPROM and
+// how many learning transfers there have been.
+//*****************************************************************************
+void UARTPrintDiag(void)
+{
+    static uint32_t lastControllerRuns = 0;
+    static uint32_t lastControllerCycles = 0;
+    static uint32_t lastSetCalls = 0;
+    static uint32_t lastRegWrites = 0;
+    uint16_t load = GetCPULoad();
+    int32_t adcMean;
+    uint32_t adcVariance;
+    MemStats mem;
+    uint32_t runs = controllerRuns - lastControllerRuns;
+    uint32_t avgCycles = runs ? (controllerCycles - lastControllerCycles) / runs : 0;
+
+    usnprintf(statusStr, sizeof(statusStr), "Diag: %d MHz, CPU (%%): %3d.%d, Ctrl (/s): %4d, Ctrl (cyc): %5d avg %5d max, SetPWM (/s): %4d, PWM writes (/s): %4d, UART drops: %d\r\n",
+             CLOCK_PROFILE_MHZ, load / 10, load % 10, runs, avgCycles, controllerCyclesMax,
+             pwmSetCalls - lastSetCalls, pwmRegWrites - lastRegWrites, uartTxDropped);
+    controllerCyclesMax = 0;
+    lastControllerRuns = controllerRuns;
+    lastControllerCycles = controllerCycles;
+    lastSetCalls = pwmSetCalls;
+    lastRegWrites = pwmRegWrites;
+    UARTSend(statusStr);
+
+    usnprintf(statusStr, sizeof(statusStr), "Diag Evt: lost tick %d, yaw %d, ref %d, mode %d, depth max %d/%d\r\n",
+             eventOverflows[EVENT_TICK], eventOverflows[EVENT_YAW_EDGE],
+             eventOverflows[EVENT_YAW_REF], eventOverflows[EVENT_MODE_SWITCH],
+             eventHighWater, EVENT_QUEUE_SIZE);
+    UARTSend(statusStr);
+
+    usnprintf(statusStr, sizeof(statusStr), "Diag Dl: late %d, tick->PWM max (us): %d, fault %d, boot (us): %d\r\n",
+             deadlineMisses, tickLatencyMax / CLOCK_PROFILE_MHZ, deadlineFault, bootReadyUs);
+    tickLatencyMax = 0;
+    UARTSend(statusStr);
+
+    usnprintf(statusStr, sizeof(statusStr), "Diag ISR (cyc lat/dur): yaw %d/%d, ref %d/%d, tick %d/%d, adc %d/%d, sw %d/%d, uart %d/%d, but %d/%d\r\n",
+             isrStats[ISR_YAW].latencyMax, isrStats[ISR_YAW].durationMax,
+             isrStats[ISR_YAW_REF].latencyMax, isrStats[ISR_YAW_REF].durationMax,
+             isrStats[ISR_SYSTICK].latencyMax, isrStats[ISR_SYSTICK].durationMax,
+             isrStats[ISR_ADC].latencyMax, isrStats[ISR_ADC].durationMax,
+             isrStats[ISR_MODE_SW].latencyMax, isrStats[ISR_MODE_SW].durationMax,
+             isrStats[ISR_UART].latencyMax, isrStats[ISR_UART].durationMax,
+             isrStats[ISR_BUTTONS].latencyMax, isrStats[ISR_BUTTONS].durationMax);
+    UARTSend(statusStr);
+
+    BufferStats(BUF_SIZE, &adcMean, &adcVariance);
+    usnprintf(statusStr, sizeof(statusStr), "Diag ADC: %s %d Hz, window %d, var (cnt^2): %d, of mean: %d.%03d\r\n",
+              ADC_PWM_TRIGGER ? "PWM" : "SysTick", ADC_RATE_HZ, BUF_SIZE, adcVariance,
+              adcVariance / BUF_SIZE, (adcVariance % BUF_SIZE) * 1000 / BUF_SIZE);
+    UARTSend(statusStr);
+
+    MemGetStats(&mem);
+#if MEM_STATS_ENABLED
+    if (mem.staticSize)
+    {
+        usnprintf(statusStr, sizeof(statusStr), "Diag Mem: stack %d/%d%s, heap %d/%d, static %d, SRAM free %d\r\n",
+                  mem.stackUsed, mem.stackSize, mem.stackOverflow ? " OVERFLOW" : "",
+                  mem.heapUsed, mem.heapSize, mem.staticSize,
+                  MEM_SRAM_SIZE - mem.staticSize - mem.heapSize - mem.stackSize);
+    }
+    else
+    {
+        // Static size not known (TI linker), nor so what is free
+        usnprintf(statusStr, sizeof(statusStr), "Diag Mem: stack %d/%d%s, heap %d/%d\r\n",
+                  mem.stackUsed, mem.stackSize, mem.stackOverflow ? " OVERFLOW" : "",
+                  mem.heapUsed, mem.heapSize);
+    }
+#else
+    usnprintf(statusStr, sizeof(statusStr), "Diag Mem: heap used %d\r\n", mem.heapUsed);
+#endif
+    UARTSend(statusStr);
 
+    usnprintf(statusStr, sizeof(statusStr), "Diag Hov: duty (%%): %d.%02d, stored %d.%02d, learns %d\r\n",
+              hoverDuty / 100, hoverDuty % 100, hoverDutyStored / 100, hoverDutyStored % 100,
+              hoverLearns);
     UARTSend(statusStr);
 }
@@ -20,15 +20,13 @@
 //*****************************************************************************
 // Constants
 //*****************************************************************************
-#define MAX_STR_LEN 134    // Maximum String Length for serial output
-
-#define NUM_SLOTS       112
-#define TOTAL_DEG       360
-#define TOTAL_STATES    NUM_SLOTS * 4
-#define YAW_DELTA       TOTAL_DEG / (TOTAL_STATES)
+#define MAX_STR_LEN 160    // Maximum String Length for serial output
+#define UART_TX_BUF_SIZE 1024  // Transmit ring, drained by the UART interrupt
+#define UART_RX_BUF_SIZE 256   // Receive ring, filled by the UART interrupt
+#define UART_LINE_LEN    64    // Longest command line, longer lines are discarded
 
 //---USB Serial comms: UART0, Rx:PA0 , Tx:PA1
-#define BAUD_RATE 9600
+#define BAUD_RATE 115200
 #define UART_USB_BASE           UART0_BASE
 #define UART_USB_PERIPH_UART    SYSCTL_PERIPH_UART0
 #define UART_USB_PERIPH_GPIO    SYSCTL_PERIPH_GPIOA
@@ -43,10 +41,41 @@ void initialiseUSB_UART (void);
 
 //*****************************************************************************
 // Function to send serial communication from microcontroller to computer.
+// Queues the string for the UART interrupt and returns without waiting. A
+// string that does not fit in the transmit ring is dropped whole.
 void UARTSend (char *pucBuffer);
 
+//*****************************************************************************
+// Returns the free space in the transmit ring, in characters.
+uint16_t UARTTxSpace (void);
+
+//*****************************************************************************
+// UART interrupt handler, refills the transmit FIFO from the ring and moves
+// received characters into the receive ring.
+void UARTIntHandler (void);
+
+//*****************************************************************************
+// Collects received characters into line (UART_LINE_LEN + 1 long, the same
+// buffer on every call) and returns true once a complete, non-empty line is
+// there. Kernel context only.
+bool UARTReadLine (char *line);
+
+// Status lines dropped because the transmit ring was full, and received
+// characters dropped because the receive ring was.
+extern volatile uint32_t uartTxDropped;
+extern volatile uint32_t uartRxDropped;
+
+//*****************************************************************************
+// Formats the helicopter status line into str (at least MAX_STR_LEN + 1 long).
+void UARTFormatStatus(char *str, Helicopter* heli);
+
 //*****************************************************************************
 // Function to print the sent serial communication by UARTSend.
 void UARTPrint(Helicopter* heli);
 
+//*****************************************************************************
+// Prints the once a second diagnostics line (clock, CPU load, controller rate
+// and cycles, PWM register writes, dropped UART lines).
+void UARTPrintDiag(void);
+
 #endif /* UART_H_ */
@@ -0,0 +1,89 @@
+//*******************************************************************************
+// watchdog.c
+//
+// Hardware watchdog and controller deadline monitor. Every tick the kernel
+// reports how long it took from the SysTick interrupt to the new rotor duties
+// being applied. A tick that meets its deadline services the watchdog; late
+// ticks are counted, and a sustained run of them raises deadlineFault so the
+// kernel can bring the helicopter down under control. If the kernel wedges
+// and stops meeting deadlines altogether, the watchdog resets the processor,
+// which stops the rotors.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "inc/hw_memmap.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/watchdog.h"
+#include "system.h"
+#include "watchdog.h"
+
+volatile uint32_t deadlineMisses = 0;
+volatile uint32_t tickLatencyMax = 0;
+volatile uint8_t deadlineFault = 0;
+
+static uint16_t deadlineScore = 0;
+
+//*****************************************************************************
+// Starts the watchdog with the reset enabled. It is stalled while the
+// debugger halts the core so breakpoints do not reset the board.
+//*****************************************************************************
+void
+initWatchdog(void)
+{
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_WDOG0);
+    while (!SysCtlPeripheralReady(SYSCTL_PERIPH_WDOG0))
+    {
+    }
+
+    if (WatchdogLockState(WATCHDOG0_BASE))
+    {
+        WatchdogUnlock(WATCHDOG0_BASE);
+    }
+    WatchdogReloadSet(WATCHDOG0_BASE, WATCHDOG_RELOAD);
+    WatchdogResetEnable(WATCHDOG0_BASE);
+    WatchdogStallEnable(WATCHDOG0_BASE);
+    WatchdogEnable(WATCHDOG0_BASE);
+    WatchdogLock(WATCHDOG0_BASE);   // Nothing else may reconfigure it
+}
+
+//*****************************************************************************
+// Measures the tick to PWM latency and either services the watchdog or
+// counts a deadline miss. Clearing the watchdog interrupt reloads its
+// counter. The lock blocks writes to every other watchdog register, the
+// interrupt clear included, so it is lifted for the clear and set again.
+//*****************************************************************************
+RAMFUNC void
+DeadlineCheck(uint32_t tickTimestamp)
+{
+    uint32_t latency = GetTimestamp() - tickTimestamp;
+
+    if (latency > tickLatencyMax)
+    {
+        tickLatencyMax = latency;
+    }
+
+    if (latency <= DEADLINE_CYCLES)
+    {
+        WatchdogUnlock(WATCHDOG0_BASE);
+        WatchdogIntClear(WATCHDOG0_BASE);
+        WatchdogLock(WATCHDOG0_BASE);
+        if (deadlineScore > 0)
+        {
+            deadlineScore--;
+        }
+        return;
+    }
+
+    deadlineMisses++;
+    deadlineScore += DEADLINE_LATE_WEIGHT;
+    if (deadlineScore >= DEADLINE_FAULT_SCORE)
+    {
+        deadlineScore = DEADLINE_FAULT_SCORE;
+        deadlineFault = 1;   // Latched until reset
+    }
+}
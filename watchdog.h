@@ -0,0 +1,60 @@
+#ifndef WATCHDOG_H_
+#define WATCHDOG_H_
+
+//*******************************************************************************
+// watchdog.c
+//
+// Hardware watchdog and controller deadline monitor. Every tick the kernel
+// reports how long it took from the SysTick interrupt to the new rotor duties
+// being applied. A tick that meets its deadline services the watchdog; late
+// ticks are counted, and a sustained run of them raises deadlineFault so the
+// kernel can bring the helicopter down under control. If the kernel wedges
+// and stops meeting deadlines altogether, the watchdog resets the processor,
+// which stops the rotors.
+//
+// Author:  R.J Ross, H. Donley
+//
+// Last modified:   18.10.26
+//*******************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "system.h"
+
+//*****************************************************************************
+// Constants
+//*****************************************************************************
+#define WATCHDOG_TIMEOUT_MS     50       // Time without a met deadline before reset (x2, see initWatchdog)
+#define WATCHDOG_RELOAD         ((SYSTEM_CLOCK_HZ / 1000) * WATCHDOG_TIMEOUT_MS)
+
+// A tick is late if its duties are applied more than one tick period after
+// the SysTick interrupt, i.e. after the next tick is already due.
+#define DEADLINE_CYCLES         (SYSTEM_CLOCK_HZ / SYSTICK_RATE_HZ)
+
+// Late ticks add DEADLINE_LATE_WEIGHT to a score that on time ticks take one
+// from. deadlineFault is raised when it reaches DEADLINE_FAULT_SCORE, which
+// is about ten late ticks in a row or a sustained tenth of ticks late. The
+// odd late tick (after an OLED refresh) drains away.
+#define DEADLINE_LATE_WEIGHT    10
+#define DEADLINE_FAULT_SCORE    100
+
+// Late ticks since boot, the worst tick to PWM latency (cycles) since it was
+// last cleared, and the latched fault raised by repeated overruns.
+extern volatile uint32_t deadlineMisses;
+extern volatile uint32_t tickLatencyMax;
+extern volatile uint8_t deadlineFault;
+
+//*****************************************************************************
+// Starts the watchdog. On the Tiva the first timeout raises the (unused)
+// watchdog interrupt and the second resets the processor, so the processor
+// resets after 2 * WATCHDOG_TIMEOUT_MS without a met deadline.
+void initWatchdog(void);
+
+//*****************************************************************************
+// Called once per tick once the controller has run and the duties are
+// applied. tickTimestamp is the time the SysTick interrupt posted the
+// tick. Services the watchdog if the deadline was met, otherwise counts the
+// miss and raises deadlineFault once overruns persist.
+void DeadlineCheck(uint32_t tickTimestamp);
+
+#endif /* WATCHDOG_H_ */
@@ -23,6 +23,10 @@
 #include "utils/ustdlib.h"
 #include "circBufT.h"
 #include "yaw.h"
+#include "system.h"
+#include "recorder.h"
+#include "events.h"
+#include "isrstats.h"
 
 //*****************************************************************************
 // A table is used to adjust the yaw angle (yawAngle) of the helicopter. The
@@ -35,18 +39,34 @@
 static const int8_t adjust_table[] = {0, 1, -1, 0, -1, 0, 0, 1, 1, 0, 0, -1, 0, -1,
                               1, 0};  // Table that is indexed to increment/decrement Yaw (Refer to README) (Constant).
 
-//Interrupt flags for yaw related function
-volatile uint8_t YawIntFlag = false;
+// Raised by the kernel once the centre of the reference has been measured.
 volatile uint8_t YawRefFlag = 0;
 
+int32_t yawRefCentre = 0;
+int32_t yawRefOffset = 0;
+bool yawRefKnown = false;
+
+static int32_t refEdgeCount = 0;     // Count at the unpaired entry edge
+static int8_t refEdgeDirection = 0;  // Way the yaw was turning at that entry
+static bool refEdgePending = false;
+static int8_t yawLastStep = 0;       // Last count change, +1 or -1
+
 //*****************************************************************************
-// Manages the interrupt handler for the reference yaw, triggers YawRefFlag
-// when the central position is found.
+// Manages the interrupt handler for the reference yaw, posts EVENT_YAW_REF
+// with the PC4 level when the central position is found.
 //*****************************************************************************
-void YawRefIntHandler(void)
+RAMFUNC void YawRefIntHandler(void)
 {
-    YawRefFlag = 1;
-    GPIOIntClear(GPIO_PORTC_BASE, GPIO_INT_PIN_4);
+    ISR_ENTER(ISR_YAW_REF);
+    uint32_t status = GPIOIntStatus(GPIO_PORTC_BASE, true);
+    if (status & GPIO_INT_PIN_4)   // Not set for a latency probe
+    {
+        uint8_t level = (GPIOPinRead(GPIO_PORTC_BASE, GPIO_PIN_4) != 0);
+        RECORD(REC_YAW_REF, level);
+        EventPost(EVENT_YAW_REF, level);
+    }
+    GPIOIntClear(GPIO_PORTC_BASE, status);
+    ISR_EXIT(ISR_YAW_REF);
 }
 
 //*****************************************************************************
@@ -106,36 +126,139 @@ initYawPeripherals(Helicopter* heli)
 }
 
 //*****************************************************************************
-// Interrupt Handler for Yaw Input Signals. Reads Quadrecture Decoder and
-// adjusts Yaw Angle accordingly using table (WRITE ABOUT TABLE IN DOCUMENTATION).
+// Interrupt Handler for Yaw Input Signals. Reads the Quadrecture Decoder at
+// the edge and posts the state as EVENT_YAW_EDGE; the kernel adjusts the Yaw
+// Angle from it using the table.
 //*****************************************************************************
-void
+RAMFUNC void
 YawIntHandler(void)
 {
-    YawIntFlag = 1;
-    GPIOIntClear(GPIO_PORTB_BASE, GPIO_INT_PIN_0);
-    GPIOIntClear(GPIO_PORTB_BASE, GPIO_INT_PIN_1);
+    ISR_ENTER(ISR_YAW);
+    uint32_t status = GPIOIntStatus(GPIO_PORTB_BASE, true);
+    if (status & (GPIO_INT_PIN_0 | GPIO_INT_PIN_1))   // Not set for a latency probe
+    {
+        uint8_t state = ReadQuadrectureDecoder();
+        RECORD(REC_QUAD, state);
+        EventPost(EVENT_YAW_EDGE, state);
+    }
+    GPIOIntClear(GPIO_PORTB_BASE, status);
+    ISR_EXIT(ISR_YAW);
 }
 
 //*****************************************************************************
-// See 'adjust_table' note above. This function reads the quadrature decoder
-// output and changes our current and previous yaw readings from the result.
+// See 'adjust_table' note above. This function takes the quadrature decoder
+// output captured by the ISR and changes our current and previous yaw
+// readings from the result.
 //*****************************************************************************
-void
-ExecuteYawInt(Helicopter* heli)
+RAMFUNC void
+ExecuteYawInt(Helicopter* heli, int32_t currentRead)
 {
-    int32_t currentRead = ReadQuadrectureDecoder();
     int32_t select = (currentRead << 2 | heli->controller->prev_yaw_reading);
-    heli->controller->curr_yawangle_reading += adjust_table[select];
-    heli->controller->curr_yawangle_reading = heli->controller->curr_yawangle_reading % 448;
+    heli->controller->curr_yawangle_reading += adjust_table[select];   // Unwrapped
     heli->controller->prev_yaw_reading = currentRead;
+    if (adjust_table[select])
+    {
+        yawLastStep = adjust_table[select];
+    }
 }
 
 //*****************************************************************************
-// Gets the actual Yaw Angle Value for rotors.c
+// Pairs reference edges into slot centres. Only an entry (PC4 going to
+// YAW_REF_ENTRY_LEVEL) is latched, and only an exit crossed the same way
+// round, on the far side within YAW_REF_MAX_WIDTH, completes it. A turn back
+// inside the slot leaves by the edge it came in at, so the pending entry is
+// dropped rather than giving a centre on that edge; a second entry replaces
+// the first. Each crossing also refreshes yawRefOffset, so a search after a
+// flight starts from where the reference was last seen rather than where it
+// was first found.
+//*****************************************************************************
+void
+YawRefEdge(Helicopter* heli, uint8_t level)
+{
+    int32_t count = heli->controller->curr_yawangle_reading;
+    int32_t width = count - refEdgeCount;
+
+    if (level == YAW_REF_ENTRY_LEVEL)
+    {
+        refEdgeCount = count;
+        refEdgeDirection = yawLastStep;
+        refEdgePending = true;
+        return;
+    }
+    if (refEdgePending && yawLastStep == refEdgeDirection
+        && width * refEdgeDirection > 0 && width * refEdgeDirection <= YAW_REF_MAX_WIDTH)
+    {
+        yawRefCentre = refEdgeCount + width / 2;
+        if (yawRefKnown)
+        {
+            yawRefOffset = YawWrap(yawRefCentre);
+        }
+        YawRefFlag = 1;
+    }
+    refEdgePending = false;
+}
+
+//*****************************************************************************
+// Gets the actual Yaw Angle Value for rotors.c, wrapped for display.
 //*****************************************************************************
 int16_t
 GetYawAngleDegrees(Helicopter* heli)
 {
-    return (((heli->controller->curr_yawangle_reading + 672) % 448 - 224) * YAW_DELTA);
+    return YawCountsToDegrees(YawWrap(heli->controller->curr_yawangle_reading));
+}
+
+//*****************************************************************************
+// C's % keeps the sign of the dividend, so the remainder is brought into
+// 0 to TOTAL_STATES - 1 before being centred on zero.
+//*****************************************************************************
+RAMFUNC int32_t
+YawWrap(int32_t counts)
+{
+    int32_t wrapped = (counts + HALF_TOTAL_STATES) % TOTAL_STATES;
+
+    if (wrapped < 0)
+    {
+        wrapped += TOTAL_STATES;
+    }
+    return wrapped - HALF_TOTAL_STATES;
+}
+
+//*****************************************************************************
+// The difference is taken before wrapping, so it stays correct however far
+// the unwrapped reading has wound (short of int32 overflow).
+//*****************************************************************************
+RAMFUNC int32_t
+YawError(int32_t target, int32_t reading)
+{
+    return YawWrap(target - reading);
+}
+
+int32_t
+YawDegreesToCounts(int32_t degrees)
+{
+    int32_t scaled = degrees * TOTAL_STATES;
+
+    return (scaled >= 0) ? (scaled + TOTAL_DEG / 2) / TOTAL_DEG
+                         : -((-scaled + TOTAL_DEG / 2) / TOTAL_DEG);
+}
+
+int32_t
+YawCountsToDegrees(int32_t counts)
+{
+    int32_t scaled = counts * TOTAL_DEG;
+
+    return (scaled >= 0) ? (scaled + TOTAL_STATES / 2) / TOTAL_STATES
+                         : -((-scaled + TOTAL_STATES / 2) / TOTAL_STATES);
+}
+
+int32_t
+YawWrapDegrees(int32_t degrees)
+{
+    int32_t wrapped = (degrees + TOTAL_DEG / 2) % TOTAL_DEG;
+
+    if (wrapped < 0)
+    {
+        wrapped += TOTAL_DEG;
+    }
+    return wrapped - TOTAL_DEG / 2;
 }
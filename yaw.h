@@ -23,24 +23,41 @@
 // Constants
 //*****************************************************************************
 #define YAW_ANGLE_START_POSITION       0
+// Conversion parameters for states to degrees (yaw). The yaw reading is an
+// unwrapped count of quadrature states from the reference (it keeps counting
+// past a full turn); it is only wrapped for display and when taking errors.
 #define NUM_SLOTS       112
 #define TOTAL_DEG       360
-#define TOTAL_STATES    NUM_SLOTS * 4
-#define HALF_TOTAL_STATES    NUM_SLOTS * 2
-#define YAW_DELTA       TOTAL_DEG / (TOTAL_STATES)
+#define TOTAL_STATES    (NUM_SLOTS * 4)
+#define HALF_TOTAL_STATES    (NUM_SLOTS * 2)
 
 #define REF_SIGNAL      true
 
-//Interrupt flags for yaw related function
-extern volatile uint8_t YawIntFlag;
+// Two reference edges this close (counts) are taken as the two sides of the
+// index slot; further apart they are separate passes.
+#define YAW_REF_MAX_WIDTH   20
+#define YAW_REF_ENTRY_LEVEL 0        // PC4 level with the slot in front of the sensor
+
+// Raised by the kernel once both edges of the reference have been crossed
+// and yawRefCentre measured, cleared by LocatePivot.
 extern volatile uint8_t YawRefFlag;
 
+// Count at the centre of the reference slot when it was last crossed, in
+// the yaw frame current at the time.
+extern int32_t yawRefCentre;
+
+// Where the reference is expected, as a wrapped count in the current frame,
+// and whether that is known (false until it is first found after a cold
+// start).
+extern int32_t yawRefOffset;
+extern bool yawRefKnown;
+
 //*****************************************************************************
 // Initialization of the reference yaw interrupt
 void initRefYaw(void);
 
 //*****************************************************************************
-// Manages the interrupt handler for the reference yaw, triggers YawRefFlag
+// Manages the interrupt handler for the reference yaw, posts EVENT_YAW_REF
 void YawRefIntHandler(void);
 
 //*****************************************************************************
@@ -53,16 +70,44 @@ int32_t ReadQuadrectureDecoder (void);
 void initYawPeripherals(Helicopter* heli);
 
 //*****************************************************************************
-// Interrupt Handler for Yaw Input Signals. Changes flag value
+// Interrupt Handler for Yaw Input Signals. Posts EVENT_YAW_EDGE with the
+// decoder state.
 void YawIntHandler(void);
 
 //*****************************************************************************
-// Interrupt Handler for Yaw Input Signals. Reads Quadrecture Decoder and
-// adjusts Helicopter 'heli' Yaw Angle accordingly to table
-void ExecuteYawInt(Helicopter* heli);
+// Takes a Quadrecture Decoder state captured by YawIntHandler and adjusts
+// Helicopter 'heli' Yaw Angle accordingly to table
+void ExecuteYawInt(Helicopter* heli, int32_t currentRead);
 
 //*****************************************************************************
-// Gets the current Yaw Angle Value for Main.
+// Takes one edge of the reference (kernel context, from EVENT_YAW_REF) with
+// the PC4 level after it. The quadrature edges are queued in order with it,
+// so the yaw reading is the count at this edge. An exit paired with the
+// entry before it, crossed the same way, gives the centre of the slot,
+// raising YawRefFlag.
+void YawRefEdge(Helicopter* heli, uint8_t level);
+
+//*****************************************************************************
+// Gets the current Yaw Angle Value for Main, wrapped to -180 to 179 degrees.
 int16_t GetYawAngleDegrees(Helicopter* heli);
 
+//*****************************************************************************
+// Wraps a yaw count (or difference of counts) to -HALF_TOTAL_STATES to
+// HALF_TOTAL_STATES - 1.
+int32_t YawWrap(int32_t counts);
+
+//*****************************************************************************
+// Returns the shortest signed distance, in counts, from reading to target:
+// never more than half a turn either way, whatever either has wound up to.
+int32_t YawError(int32_t target, int32_t reading);
+
+//*****************************************************************************
+// Converts between degrees and yaw counts, rounding to the nearest.
+int32_t YawDegreesToCounts(int32_t degrees);
+int32_t YawCountsToDegrees(int32_t counts);
+
+//*****************************************************************************
+// Wraps an angle to -180 to 179 degrees.
+int32_t YawWrapDegrees(int32_t degrees);
+
 #endif // YAW_H